@@ -0,0 +1,191 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares memory use and iteration speed of GridMap against the
+// previous layout (one heap allocation per cell / vertex, stored in an
+// std::unordered_map), on a grid file produced by gridgen.
+
+#include <string>
+#include <chrono>
+#include <memory>
+#include <iostream>
+#include <unordered_map>
+
+#include <tclap/CmdLine.h>
+
+#include <ibmisc/netcdf.hpp>
+#include <icebin/Grid.hpp>
+
+using namespace ibmisc;
+using namespace icebin;
+
+struct ParseArgs {
+    std::string fname;    // INPUT file
+    std::string vname;    // Name of grid in input file
+    int nrep;
+
+    ParseArgs(int argc, char **argv);
+};
+
+ParseArgs::ParseArgs(int argc, char **argv)
+{
+    try {
+        TCLAP::CmdLine cmd("Compare memory use and iteration speed of grid storage", ' ', "<no-version>");
+
+        TCLAP::UnlabeledValueArg<std::string> fname_a("input",
+            "Name of IceBin grid file (or overlap file)",
+            true, "", "grid file", cmd);
+
+        TCLAP::ValueArg<std::string> vname_a("v", "vname",
+            "Name of grid variable in the file",
+            false, "grid", "variable name", cmd);
+
+        TCLAP::ValueArg<int> nrep_a("n", "nrep",
+            "Number of times to iterate through the grid",
+            false, 10, "repetitions", cmd);
+
+        cmd.parse( argc, argv );
+
+        fname = fname_a.getValue();
+        vname = vname_a.getValue();
+        nrep = nrep_a.getValue();
+    } catch (TCLAP::ArgException &e) { // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(1);
+    }
+}
+
+// ----------------------------------------------------------
+/** Storage layout used by GridMap before it was arena-backed. */
+template<class CellT>
+using LegacyMapT = std::unordered_map<long, std::unique_ptr<CellT>>;
+
+/** Approximate size of a (glibc) malloc() block holding n bytes */
+static size_t malloc_size(size_t n)
+    { return std::max<size_t>(32, (n + 8 + 15) & ~(size_t)15); }
+
+template<class CellT>
+static size_t legacy_memory_bytes(LegacyMapT<CellT> const &map)
+{
+    // Hash node = next pointer + (key, value)
+    size_t const node_size = sizeof(void *)
+        + sizeof(typename LegacyMapT<CellT>::value_type);
+
+    return map.size() * (malloc_size(node_size) + malloc_size(sizeof(CellT)))
+        + map.bucket_count() * sizeof(void *);
+}
+
+static size_t legacy_vertex_list_bytes(LegacyMapT<Cell> const &cells)
+{
+    size_t ret = 0;
+    for (auto ii=cells.begin(); ii != cells.end(); ++ii)
+        ret += malloc_size(ii->second->size() * sizeof(Vertex *));
+    return ret;
+}
+
+/** Time (seconds) to do something nrep times */
+template<class FnT>
+static double time_it(int nrep, FnT const &fn)
+{
+    auto t0(std::chrono::steady_clock::now());
+    for (int i=0; i<nrep; ++i) fn();
+    auto t1(std::chrono::steady_clock::now());
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    ParseArgs args(argc,argv);
+
+    // ------------ Read the grid (into GridMap)
+    Grid grid;
+    {NcIO ncio(args.fname, 'r');
+        grid.ncio(ncio, args.vname);
+    }
+
+    // ------------ Copy it into the legacy layout
+    LegacyMapT<Vertex> lvertices;
+    for (auto vertex=grid.vertices.begin(); vertex != grid.vertices.end(); ++vertex) {
+        lvertices.insert(std::make_pair(vertex->index,
+            std::unique_ptr<Vertex>(new Vertex(*vertex))));
+    }
+    LegacyMapT<Cell> lcells;
+    for (auto cell=grid.cells.begin(); cell != grid.cells.end(); ++cell) {
+        std::vector<Vertex *> vertices;
+        for (auto vertex=cell->begin(); vertex != cell->end(); ++vertex)
+            vertices.push_back(&*lvertices.at(vertex->index));
+        std::unique_ptr<Cell> lcell(new Cell(std::move(vertices)));
+        lcell->index = cell->index;
+        lcell->i = cell->i;
+        lcell->j = cell->j;
+        lcell->k = cell->k;
+        lcell->native_area = cell->native_area;
+        lcells.insert(std::make_pair(lcell->index, std::move(lcell)));
+    }
+
+    // ------------ Memory
+    size_t const arena_bytes =
+        grid.vertices.memory_bytes() + grid.cells.memory_bytes();
+    size_t const legacy_bytes =
+        legacy_memory_bytes(lvertices) + legacy_memory_bytes(lcells)
+        + legacy_vertex_list_bytes(lcells);
+
+    // ------------ Iteration: visit every vertex of every cell
+    double sum_arena = 0;
+    double const t_arena = time_it(args.nrep, [&]() {
+        for (auto cell=grid.cells.begin(); cell != grid.cells.end(); ++cell) {
+            for (auto vertex=cell->begin(); vertex != cell->end(); ++vertex)
+                sum_arena += vertex->x + vertex->y;
+        }
+    });
+
+    double sum_legacy = 0;
+    double const t_legacy = time_it(args.nrep, [&]() {
+        for (auto ii=lcells.begin(); ii != lcells.end(); ++ii) {
+            Cell const &cell(*ii->second);
+            for (auto vertex=cell.begin(); vertex != cell.end(); ++vertex)
+                sum_legacy += vertex->x + vertex->y;
+        }
+    });
+
+    // ------------ Lookup by index
+    long nlookup = 0;
+    double const t_arena_at = time_it(args.nrep, [&]() {
+        for (auto ii=lcells.begin(); ii != lcells.end(); ++ii)
+            nlookup += grid.cells.at(ii->first)->size();
+    });
+    double const t_legacy_at = time_it(args.nrep, [&]() {
+        for (auto ii=lcells.begin(); ii != lcells.end(); ++ii)
+            nlookup += lcells.at(ii->first)->size();
+    });
+
+    // ------------ Report
+    double const ncells = grid.cells.nrealized();
+    double const MB = 1024.*1024.;
+    printf("%s:%s: %ld cells, %ld vertices\n",
+        args.fname.c_str(), args.vname.c_str(),
+        (long)grid.cells.nrealized(), (long)grid.vertices.nrealized());
+    printf("                      arena      legacy\n");
+    printf("memory (MB)      %10.2f  %10.2f\n",
+        arena_bytes / MB, legacy_bytes / MB);
+    printf("iterate (ns/cell)%10.2f  %10.2f\n",
+        1e9 * t_arena / (args.nrep * ncells), 1e9 * t_legacy / (args.nrep * ncells));
+    printf("at() (ns/cell)   %10.2f  %10.2f\n",
+        1e9 * t_arena_at / (args.nrep * ncells), 1e9 * t_legacy_at / (args.nrep * ncells));
+    printf("(checksums: %g %g %ld)\n", sum_arena, sum_legacy, nlookup);
+}
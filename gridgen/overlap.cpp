@@ -37,6 +37,7 @@ struct ParseArgs {
     std::string fnameA;
     std::string fnameI;
     std::string fname_exgrid;    // OUT: Name of overlap file to write
+    ExchangeGridParams params;
 
     ParseArgs(int argc, char **argv);
 };
@@ -67,6 +68,17 @@ ParseArgs::ParseArgs(int argc, char **argv)
             "Name of IceBin overlap file to write",
             false, "", "overlap grid file", cmd);
 
+        TCLAP::ValueArg<int> nthreads_a("j", "threads",
+            "Number of threads to use (0 = one per core)",
+            false, 0, "threads", cmd);
+
+        TCLAP::SwitchArg exact_a("x", "exact",
+            "Compute all overlaps with the exact (CGAL) kernel", cmd, false);
+
+        TCLAP::ValueArg<int> validate_a("", "validate",
+            "Check about one in N fast overlaps against the exact kernel, "
+            "and report the maximum area discrepancy",
+            false, 0, "N", cmd);
 
         // Parse the argv array.
         cmd.parse( argc, argv );
@@ -74,6 +86,9 @@ ParseArgs::ParseArgs(int argc, char **argv)
         fnameA = fnameA_a.getValue();
         fnameI = fnameI_a.getValue();
         fname_exgrid = fname_exgrid_a.getValue();
+        params.nthreads = nthreads_a.getValue();
+        params.fast_clip = !exact_a.getValue();
+        params.validate_every = validate_a.getValue();
     } catch (TCLAP::ArgException &e) { // catch any exceptions
         std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
         exit(1);
@@ -100,7 +115,7 @@ int main(int argc, char **argv)
     printf("Done reading gridI\n");
 
     printf("--------------- Overlapping\n");
-    Grid exgrid(make_exchange_grid(&gridA, &gridI));
+    Grid exgrid(make_exchange_grid(&gridA, &gridI, "", args.params));
     sort_renumber_vertices(exgrid);
 
     printf("--------------- Writing out\n");
@@ -25,6 +25,12 @@ Regular earth has
 
 #include <string>
 #include <iostream>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -40,6 +46,7 @@ Regular earth has
 #include <ibmisc/iostream.hpp>
 #include <spsparse/eigen.hpp>
 #include <spsparse/SparseSet.hpp>
+#include <ibmisc/linear/compressed.hpp>
 
 //#include <icebin/Grid.hpp>
 //#include <icebin/AbbrGrid.hpp>
@@ -128,6 +135,10 @@ struct ParseArgs {
     int chunk_no=-1;
     std::array<std::array<int,2>,2> chunk_range;    // {{x0,y0},{x1,y1}}
 
+    // In-process scheduling of chunks (instead of writing a Makefile)
+    int nthreads = 0;        // 0 = write Makefile; >0 = run chunks on this many threads
+    bool checkpoint = true;  // Save combined state after each chunk, to resume a crashed run
+
     // Generate matrices for "mismatched" or standard regridding?
     GCMGridOption gcm_grid_option = GCMGridOption::mismatched;
 
@@ -229,6 +240,16 @@ ParseArgs::ParseArgs(int argc, char **argv)
             "Runs on ice over a segmenet of fgiceO (not for end-user use)",
             false, "", "O cell range", cmd);
 
+        TCLAP::ValueArg<int> nthreads_a("j", "threads",
+            "Run chunks in-process on this many threads and combine them"
+            " directly into the output file (0 = write a Makefile instead)."
+            "  NOTE: Each thread needs memory for a full chunk.",
+            false, 0, "threads", cmd);
+
+        TCLAP::SwitchArg nocheckpoint_a("", "no-checkpoint",
+            "With --threads: do not checkpoint finished chunks",
+            cmd, false);
+
 
         // Not needed for spherical grids
         // TCLAP::SwitchArg correctA_a("c", "correct",
@@ -262,6 +283,9 @@ ParseArgs::ParseArgs(int argc, char **argv)
 
         matrix_names = split<std::string>(matrix_names_a.getValue(), ",");
 
+        nthreads = nthreads_a.getValue();
+        checkpoint = !nocheckpoint_a.getValue();
+
         std::string srunchunk(runchunk_a.getValue());
         if (srunchunk == "") {
             run_chunk = false;
@@ -462,8 +486,34 @@ void check_negative(linear::Weighted_Eigen const &mat, std::string const &name)
 
 }
 // -------------------------------------------------
+/** NetCDF/HDF5 is not thread-safe.  When chunks are run in-process,
+all input is read before the worker threads start; this serializes
+the checkpoint files they write. */
+static std::mutex netcdf_mutex;
+
+/** Fractional ocean mask (based purely on ice extent), read from the
+TOPOO file.  Needed for mismatched regridding. */
+struct FOcean {
+    blitz::Array<double,2> foceanO;     // called FOCEAN in make_topoo
+    blitz::Array<double,2> foceanfO;    // called FOCEANF in make_topoo
+
+    FOcean(FileLocator const &files, ParseArgs const &args);
+};
+
+FOcean::FOcean(FileLocator const &files, ParseArgs const &args)
+    : foceanO(args.hspecO.jm, args.hspecO.im),
+    foceanfO(args.hspecO.jm, args.hspecO.im)
+{
+    auto fname(files.locate(args.topoo_fname));
+
+    printf("---- Reading FOCEAN: %s\n", fname.c_str());
+    NcIO ncio(fname, 'r');
+    ncio_blitz(ncio, foceanO, "FOCEAN", "double", {});
+    ncio_blitz(ncio, foceanfO, "FOCEANF", "double", {});
+}
+
 std::unique_ptr<GCMRegridder> new_gcmA_mismatched(
-    FileLocator const &files, ParseArgs const &args, blitz::Array<double,2> const &elevmaskI)
+    FOcean const &focean, ParseArgs const &args, blitz::Array<double,2> const &elevmaskI)
 {
     auto const &hspecO(args.hspecO);
     auto const &hspecI(args.hspecI);
@@ -485,33 +535,125 @@ std::unique_ptr<GCMRegridder> new_gcmA_mismatched(
 
     HntrSpec const &hspecA(cast_GridSpec_LonLat(*gcmA->agridA->spec).hntr);
 
-    // Load the fractional ocean mask (based purely on ice extent)
-    {auto fname(files.locate(args.topoo_fname));
+    // Set the fractional ocean mask
+    gcmA->foceanOp = reshape1(focean.foceanfO);  // COPY: FOCEANF
+    gcmA->foceanOm = reshape1(focean.foceanO);   // COPY: FOCEAN
 
-        blitz::Array<double,2> foceanO(hspecO.jm, hspecO.im);    // called FOCEAN in make_topoo
-        blitz::Array<double,2> foceanfO(hspecO.jm, hspecO.im);    // called FOCEANF in make_topoo
+    return std::unique_ptr<GCMRegridder>(gcmA.release());
+}
 
-        printf("---- Reading FOCEAN: %s\n", fname.c_str());
-        NcIO ncio(fname, 'r');
-        ncio_blitz(ncio, foceanO, "FOCEAN", "double", {});
-        ncio_blitz(ncio, foceanfO, "FOCEANF", "double", {});
 
 
-        gcmA->foceanOp = reshape1(foceanfO);  // COPY: FOCEANF 
-        gcmA->foceanOm = reshape1(foceanO);   // COPY: FOCEAN
-    }
+// -------------------------------------------------
+/** Sparse-indexed pieces of one BvA matrix, as produced by one or
+more chunks.  Duplicate entries are summed when read, just as in
+combine_global_ec. */
+struct MatrixPieces {
+    std::array<long,2> shape {{0,0}};
+    std::vector<int> ix0, ix1;        // M (sparse indexing)
+    std::vector<double> values;
+    std::vector<int> wM_ix;
+    std::vector<double> wM;
+    std::vector<int> Mw_ix;
+    std::vector<double> Mw;
+
+    void append(MatrixPieces const &other);
+    void ncio(NcIO &ncio, std::string const &vname);
+};
 
-    return std::unique_ptr<GCMRegridder>(gcmA.release());
+template<class T>
+static void append_vector(std::vector<T> &dest, std::vector<T> const &src)
+    { dest.insert(dest.end(), src.begin(), src.end()); }
+
+void MatrixPieces::append(MatrixPieces const &other)
+{
+    shape = other.shape;
+    append_vector(ix0, other.ix0);
+    append_vector(ix1, other.ix1);
+    append_vector(values, other.values);
+    append_vector(wM_ix, other.wM_ix);
+    append_vector(wM, other.wM);
+    append_vector(Mw_ix, other.Mw_ix);
+    append_vector(Mw, other.Mw);
 }
 
+void MatrixPieces::ncio(NcIO &ncio, std::string const &vname)
+{
+    auto info_v = get_or_add_var(ncio, vname + ".info", "int", {});
+    get_or_put_att(info_v, ncio.rw, "shape", "int64", &shape[0], 2);
+
+    auto M_dims(get_or_add_dims(ncio, values, {vname + ".M.nnz"}));
+    ncio_vector(ncio, ix0, true, vname + ".M.ix0", "int", M_dims);
+    ncio_vector(ncio, ix1, true, vname + ".M.ix1", "int", M_dims);
+    ncio_vector(ncio, values, true, vname + ".M.values", "double", M_dims);
+
+    auto wM_dims(get_or_add_dims(ncio, wM, {vname + ".wM.nnz"}));
+    ncio_vector(ncio, wM_ix, true, vname + ".wM.indices", "int", wM_dims);
+    ncio_vector(ncio, wM, true, vname + ".wM.values", "double", wM_dims);
+
+    auto Mw_dims(get_or_add_dims(ncio, Mw, {vname + ".Mw.nnz"}));
+    ncio_vector(ncio, Mw_ix, true, vname + ".Mw.indices", "int", Mw_dims);
+    ncio_vector(ncio, Mw, true, vname + ".Mw.values", "double", Mw_dims);
+}
+
+/** A dimension of the generated matrices, with the shape of the
+grid it indexes. */
+struct DimInfo {
+    SparseSet<long,int> dim;
+    std::vector<int> shape;
+    std::string description;
+
+    void ncio(NcIO &ncio, std::string const &vname);
+};
+
+void DimInfo::ncio(NcIO &ncio, std::string const &vname)
+{
+    NcVar ncv(dim.ncio(ncio, vname));
+    get_or_put_att(ncv, ncio.rw, "shape", "int", shape);
+    get_or_put_att(ncv, ncio.rw, "description", description);
+}
+
+/** Matrices computed for one chunk, kept in memory rather than
+written to a per-chunk NetCDF file. */
+struct ChunkResult {
+    global_ec::Metadata meta;
+    std::map<std::string, MatrixPieces> matrices;
+    std::map<std::string, DimInfo> dims;    // dimA, dimE, dimI, dimI2 (or dimO...)
+
+    void add(std::string const &BvA, linear::Weighted_Eigen const &mat,
+        SparseSet<long,int> const &dimB, SparseSet<long,int> const &dimA);
+};
 
+void ChunkResult::add(std::string const &BvA, linear::Weighted_Eigen const &mat,
+    SparseSet<long,int> const &dimB, SparseSet<long,int> const &dimA)
+{
+    MatrixPieces &pieces(matrices[BvA]);
+    pieces.shape = {dimB.sparse_extent(), dimA.sparse_extent()};
+
+    for (auto ii(begin(*mat.M)); ii != end(*mat.M); ++ii) {
+        pieces.ix0.push_back(dimB.to_sparse(ii->index(0)));
+        pieces.ix1.push_back(dimA.to_sparse(ii->index(1)));
+        pieces.values.push_back(ii->value());
+    }
+    for (int i=0; i<mat.wM.extent(0); ++i) {
+        pieces.wM_ix.push_back(dimB.to_sparse(i));
+        pieces.wM.push_back(mat.wM(i));
+    }
+    for (int i=0; i<mat.Mw.extent(0); ++i) {
+        pieces.Mw_ix.push_back(dimA.to_sparse(i));
+        pieces.Mw.push_back(mat.Mw(i));
+    }
+}
 
 /**
 @param matrix_names Names of matrices to generate (or all, if it's empty)
+@param stream If set, matrices are added here instead of being written to
+    the chunk's NetCDF file.
 */
 void global_ec_section(GCMRegridder &gcmA, ParseArgs &args,
     blitz::Array<double,2> const &elevmaskI, HntrSpec &hspecI2,
-    std::vector<std::string> const &matrix_names)
+    std::vector<std::string> const &matrix_names,
+    ChunkResult *stream = nullptr)
 {
 
     std::unique_ptr<RegridMatrices_Dynamic> rm(gcmA.regrid_matrices(0, reshape1(elevmaskI)));
@@ -536,8 +678,7 @@ void global_ec_section(GCMRegridder &gcmA, ParseArgs &args,
         *gcmA.ice_regridders()[0]->agridI.spec).hntr);
 
 
-    {NcIO ncio(ofname, 'w', "nc4", nocompress);
-        global_ec::Metadata meta;
+    {global_ec::Metadata meta;
         meta.eq_rad = args.eq_rad;
         meta.gcm_grid_option = args.gcm_grid_option;
         meta.hspecA = hspecA;
@@ -553,9 +694,15 @@ void global_ec_section(GCMRegridder &gcmA, ParseArgs &args,
         meta.hcdefs = gcmA._hcdefs;
         for (size_t i=0; i<meta.hcdefs.size(); ++i)
             meta.underice_hc.push_back(UI_GLOBALICE);
-        printf("---- Saving metadata\n");
-        meta.ncio(ncio);
-        ncio.close();   // Ensure meta lasts longer than ncio
+
+        if (stream) {
+            stream->meta = meta;
+        } else {
+            NcIO ncio(ofname, 'w', "nc4", nocompress);
+            printf("---- Saving metadata\n");
+            meta.ncio(ncio);
+            ncio.close();   // Ensure meta lasts longer than ncio
+        }
     }
 
     std::set<string> matrix_names_set = std::set<std::string>(matrix_names.begin(), matrix_names.end());
@@ -564,127 +711,207 @@ void global_ec_section(GCMRegridder &gcmA, ParseArgs &args,
     std::string const &Achar (args.gcm_grid_option == GCMGridOption::ocean ? "O" : "A");
 
     if (matrix_names_set.find("AvI") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating AvI\n");
         auto mat(rm->matrix_d("AvI", {&dimA, &dimI}, params));
         check_negative(*mat, "AvI");
-        mat->ncio(ncio, Achar+"vI", {"dim"+Achar, "dimI"});
-        ncio.flush();
+        if (stream) stream->add(Achar+"vI", *mat, dimA, dimI);
+        else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, Achar+"vI", {"dim"+Achar, "dimI"});
+            ncio.flush();
+        }
     }
 
     if (matrix_names_set.find("EvI") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating EvI\n");
         auto mat(rm->matrix_d("EvI", {&dimE, &dimI}, params));
         check_negative(*mat, "EvI");
-        mat->ncio(ncio, "EvI", {"dimE", "dimI"});
-        ncio.flush();
+        if (stream) stream->add("EvI", *mat, dimE, dimI);
+        else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, "EvI", {"dimE", "dimI"});
+            ncio.flush();
+        }
     }
 
     if (matrix_names_set.find("IvE") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating IvE\n");
         auto mat(rm->matrix_d("IvE", {&dimI, &dimE}, params));
         check_negative(*mat, "IvE");
-        mat->ncio(ncio, "IvE", {"dimI", "dimE"});
-        ncio.flush();
+        if (stream) {
+            stream->add("IvE", *mat, dimI, dimE);
 
-        // Save smaller / more wieldly display version of the matrix
-        auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimE, params));
-        mat.release();
-        mat2.ncio(ncio, "I2vE", {"dimI2", "dimE"});
-        ncio.flush();
+            // Smaller / more wieldly display version of the matrix
+            auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimE, params));
+            mat.reset();
+            stream->add("I2vE", mat2, dimI2, dimE);
+        } else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, "IvE", {"dimI", "dimE"});
+            ncio.flush();
+
+            // Save smaller / more wieldly display version of the matrix
+            auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimE, params));
+            mat.release();
+            mat2.ncio(ncio, "I2vE", {"dimI2", "dimE"});
+            ncio.flush();
+        }
     }
 
     if (matrix_names_set.find("IvA") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating IvA\n");
         std::unique_ptr<ibmisc::linear::Weighted_Eigen> mat(
             rm->matrix_d("IvA", {&dimI, &dimA}, params));
         check_negative(*mat, "IvA");
-        mat->ncio(ncio, "Iv"+Achar, {"dimI", "dim"+Achar});
-        ncio.flush();
+        if (stream) {
+            stream->add("Iv"+Achar, *mat, dimI, dimA);
 
-        // Save smaller / more wieldly display version of the matrix
-        auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimA, params));
-        mat.release();
-        mat2.ncio(ncio, "I2v"+Achar, {"dimI2", "dim"+Achar});
-        ncio.flush();
+            // Smaller / more wieldly display version of the matrix
+            auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimA, params));
+            mat.reset();
+            stream->add("I2v"+Achar, mat2, dimI2, dimA);
+        } else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, "Iv"+Achar, {"dimI", "dim"+Achar});
+            ncio.flush();
+
+            // Save smaller / more wieldly display version of the matrix
+            auto mat2(make_I2vX(*mat, args, reshape1(elevmaskI), dimI2, dimI, dimA, params));
+            mat.release();
+            mat2.ncio(ncio, "I2v"+Achar, {"dimI2", "dim"+Achar});
+            ncio.flush();
+        }
     }
 
     if (matrix_names_set.find("AvE") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating AvE\n");
         auto mat(rm->matrix_d("AvE", {&dimA, &dimE}, params));
         check_negative(*mat, "AvE");
-        mat->ncio(ncio, Achar+"vE", {"dim"+Achar, "dimE"});
-        ncio.flush();
+        if (stream) stream->add(Achar+"vE", *mat, dimA, dimE);
+        else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, Achar+"vE", {"dim"+Achar, "dimE"});
+            ncio.flush();
+        }
     }
 
     if (matrix_names_set.find("EvA") != matrix_names_set.end()) {
-        NcIO ncio(ofname, 'a', "nc4", nocompress);
         printf("---- Generating EvA\n");
         auto mat(rm->matrix_d("EvA", {&dimE, &dimA}, params));
         check_negative(*mat, "EvA");
-        mat->ncio(ncio, "Ev"+Achar, {"dimE", "dim"+Achar});
-        ncio.flush();
+        if (stream) stream->add("Ev"+Achar, *mat, dimE, dimA);
+        else {
+            NcIO ncio(ofname, 'a', "nc4", nocompress);
+            mat->ncio(ncio, "Ev"+Achar, {"dimE", "dim"+Achar});
+            ncio.flush();
+        }
     }
 
     // Store the dimensions
-    printf("---- Storing Dimensions\n");
-    {NcIO ncio(ofname, 'a', "nc4", nocompress);
-        NcVar ncv;
-
-        ncv = dimA.ncio(ncio, "dim"+Achar);
-        get_or_put_att(ncv, 'w', "shape", 
-            &std::vector<int>{hspecA.jm, hspecA.im}[0], 2);
-        ncv.putAtt("description", "GCM ('Atmosphere' or 'Ocean') Grid");
-
-        ncv = dimE.ncio(ncio, "dimE");
-        get_or_put_att(ncv, 'w', "shape", 
-            &std::vector<int>{(int)gcmA.nhc(), hspecA.jm, hspecA.im}[0], 3);
-        ncv.putAtt("description", "Elevation Grid");
-
-        ncv = dimI.ncio(ncio, "dimI");
-        get_or_put_att(ncv, 'w', "shape", 
-            &std::vector<int>{hspecI.jm, hspecI.im}[0], 2);
-        ncv.putAtt("description", "Fine-scale ('Ice') Grid");
-
-        ncv = dimI2.ncio(ncio, "dimI2");
-        get_or_put_att(ncv, 'w', "shape", 
-            &std::vector<int>{args.hspecI2.jm, args.hspecI2.im}[0], 2);
-        ncv.putAtt("description", "Recuction of Fine-scale Grid, for easy plotting");
-
+    std::map<std::string, DimInfo> dims;
+    dims["dim"+Achar] = DimInfo{std::move(dimA),
+        {hspecA.jm, hspecA.im},
+        "GCM ('Atmosphere' or 'Ocean') Grid"};
+    dims["dimE"] = DimInfo{std::move(dimE),
+        {(int)gcmA.nhc(), hspecA.jm, hspecA.im},
+        "Elevation Grid"};
+    dims["dimI"] = DimInfo{std::move(dimI),
+        {hspecI.jm, hspecI.im},
+        "Fine-scale ('Ice') Grid"};
+    dims["dimI2"] = DimInfo{std::move(dimI2),
+        {args.hspecI2.jm, args.hspecI2.im},
+        "Recuction of Fine-scale Grid, for easy plotting"};
+
+    if (stream) {
+        stream->dims = std::move(dims);
+    } else {
+        printf("---- Storing Dimensions\n");
+        NcIO ncio(ofname, 'a', "nc4", nocompress);
+        for (auto &ii : dims) ii.second.ncio(ncio, ii.first);
         ncio.flush();
     }
 
     printf("Done!\n");
 }
 
-void global_ec_section(FileLocator const &files, ParseArgs &args, blitz::Array<double,2> const &elevmaskI)
+/** @param focean Only used (and required) for mismatched grids */
+void global_ec_section(FOcean const *focean, ParseArgs &args,
+    blitz::Array<double,2> const &elevmaskI, ChunkResult *stream = nullptr)
 {
     switch(args.gcm_grid_option.index()) {
         case GCMGridOption::mismatched : {
             // Mismatched grids on Atmosphere grid
-            auto gcmA(new_gcmA_mismatched(files, args, elevmaskI));
-            global_ec_section(*gcmA, args, elevmaskI, args.hspecI2, args.matrix_names);
+            auto gcmA(new_gcmA_mismatched(*focean, args, elevmaskI));
+            global_ec_section(*gcmA, args, elevmaskI, args.hspecI2, args.matrix_names, stream);
         } break;
         case GCMGridOption::atmosphere : {
             // Simple matrices on Atmosphere grid
             HntrSpec const hspecA(make_hntrA(args.hspecO));
             auto gcmA(new_gcmA_standard(hspecA, "Atmosphere", args, elevmaskI));
-            global_ec_section(*gcmA, args, elevmaskI, args.hspecI2, args.matrix_names);
+            global_ec_section(*gcmA, args, elevmaskI, args.hspecI2, args.matrix_names, stream);
         } break;
         case GCMGridOption::ocean : {
             // Simple matrices on Ocean grid
             auto gcmO(new_gcmA_standard(args.hspecO, "Ocean", args, elevmaskI));
-            global_ec_section(*gcmO, args, elevmaskI, args.hspecI2, args.matrix_names);
+            global_ec_section(*gcmO, args, elevmaskI, args.hspecI2, args.matrix_names, stream);
         } break;
     }
 }
 
 
 
+/** Selects the ice in args.chunk_range of the O grid.
+@return elevmaskI for the chunk (NaN where no ice, or outside the chunk) */
+blitz::Array<double,2> chunk_elevmaskI(
+    ParseArgs const &args,
+    blitz::Array<double,2> const &fgiceO,
+    blitz::Array<int16_t,2> const &fgiceI,
+    blitz::Array<int16_t,2> const &elevI)
+{
+    auto &hspecI(args.hspecI);
+    auto &hspecO(args.hspecO);
+    int const mult_i = hspecI.im / hspecO.im;
+    int const mult_j = hspecI.jm / hspecO.jm;
+
+    // Choose the ice to process on this chunk
+    blitz::Array<double,2> elevmaskI(hspecI.jm, hspecI.im);
+    elevmaskI = NaN;
+
+    // Upper bound
+    int const jO1 = args.chunk_range[1][0];
+    int const iO1 = args.chunk_range[1][1];
+    int const ijO1 = jO1 * hspecO.im + iO1;
+
+    // Set up elevmaskI for the specified range of O grid cells
+    int iO = args.chunk_range[0][1];    // Where we start scanning in fgiceO
+    int jO = args.chunk_range[0][0];
+    int ijO = jO * hspecO.im + iO;
+printf("Range: [%d %d] - [%d %d]\n", jO, iO, jO1, iO1);
+    printf("BEGIN O(%d, %d)\n", jO, iO);
+    for (; ; ++jO) {
+        for (; iO < hspecO.im; ++iO, ++ijO) {
+            if (ijO >= ijO1) goto endscan;    // Double break
+
+            if (fgiceO(jO, iO) != 0) {
+                // Add these I grid cells to elevmaskI
+                for (int jI=jO*mult_j; jI<(jO+1)*mult_j; ++jI) {
+                for (int iI=iO*mult_i; iI<(iO+1)*mult_i; ++iI) {
+                    if (fgiceI(jI,iI)) {
+                        elevmaskI(jI,iI) = elevI(jI,iI);
+                    }
+                }}
+            }
+        }
+        iO = 0;
+    }
+endscan: ;
+    printf("END O(%d, %d)\n", jO, iO);
+
+    return elevmaskI;
+}
+
+
+
 void write_chunk_makefile(
     std::string const &ofname,
     std::vector<string> const &arg_strings,
@@ -732,6 +959,271 @@ void write_chunk_makefile(
 
 
 
+// ==========================================================
+/** Accumulates chunks computed in-process into the final combined
+matrices (what combine_global_ec does from the per-chunk files).
+Each finished chunk is checkpointed to its own file, so a crashed
+run can pick up where it left off. */
+class ChunkCombiner {
+    std::mutex mutex;
+    std::string const ckpt_fname;    // "" = no checkpointing
+    std::vector<std::array<int,5>> const &chunks;
+    std::vector<int> chunks_done;    // 0/1 for each chunk
+    bool have_meta = false;
+    ChunkResult total;
+
+    /** Checkpoint file for one chunk */
+    std::string ckpt_chunk_fname(int chunkno) const
+        { return strprintf("%s-%02d", ckpt_fname.c_str(), chunkno); }
+
+    void ncio_checkpoint(NcIO &ncio, std::string const &fname,
+        int chunkno, ChunkResult &chunk);
+
+    /** Merges a chunk into total; caller must hold mutex. */
+    void merge(int chunkno, ChunkResult &&chunk);
+public:
+    ChunkCombiner(std::string const &_ckpt_fname,
+        std::vector<std::array<int,5>> const &_chunks);
+
+    bool is_done(int chunkno) const
+        { return chunks_done[chunkno]; }
+
+    /** Checkpoints and merges a finished chunk; thread-safe. */
+    void add(int chunkno, ChunkResult &&chunk);
+
+    /** Writes the combined matrices, in the format of combine_global_ec,
+    followed by their dimensions. */
+    void write(std::string const &ofname);
+
+    /** Removes the checkpoint files (once the output is written) */
+    void remove_checkpoints();
+};
+
+ChunkCombiner::ChunkCombiner(std::string const &_ckpt_fname,
+    std::vector<std::array<int,5>> const &_chunks)
+: ckpt_fname(_ckpt_fname), chunks(_chunks), chunks_done(_chunks.size(), 0)
+{
+    if (ckpt_fname == "") return;
+
+    for (auto const &chunk : chunks) {
+        std::string const fname(ckpt_chunk_fname(chunk[0]));
+        if (!boost::filesystem::exists(fname)) continue;
+
+        printf("---- Resuming chunk %d from checkpoint %s\n", chunk[0], fname.c_str());
+        ChunkResult result;
+        {NcIO ncio(fname, 'r');
+            ncio_checkpoint(ncio, fname, chunk[0], result);
+        }
+        merge(chunk[0], std::move(result));
+    }
+}
+
+void ChunkCombiner::ncio_checkpoint(NcIO &ncio, std::string const &fname,
+    int chunkno, ChunkResult &chunk)
+{
+    // A checkpoint is only good for the same chunk
+    std::vector<int> const chunk_flat(chunks[chunkno].begin(), chunks[chunkno].end());
+    std::vector<int> chunk_nc(chunk_flat);
+    ncio_vector(ncio, chunk_nc, true, "chunk", "int",
+        get_or_add_dims(ncio, chunk_nc, {"chunk.n"}));
+
+    auto info_v = get_or_add_var(ncio, "checkpoint.info", "int", {});
+    std::string snames, sdims;
+    for (auto &ii : chunk.matrices) {
+        if (snames.size() > 0) snames += ",";
+        snames += ii.first;
+    }
+    for (auto &ii : chunk.dims) {
+        if (sdims.size() > 0) sdims += ",";
+        sdims += ii.first;
+    }
+    get_or_put_att(info_v, ncio.rw, "matrices", snames);
+    get_or_put_att(info_v, ncio.rw, "dims", sdims);
+
+    chunk.meta.ncio(ncio);
+
+    if (ncio.rw == 'r') {
+        ncio.close();    // Execute the reads
+        if (chunk_nc != chunk_flat) (*icebin_error)(-1,
+            "Checkpoint %s was made with different chunks; remove it to start over",
+            fname.c_str());
+
+        NcIO ncio2(fname, 'r');
+        if (snames != "") for (auto const &name : split<std::string>(snames, ","))
+            chunk.matrices[name].ncio(ncio2, name);
+        if (sdims != "") for (auto const &name : split<std::string>(sdims, ","))
+            chunk.dims[name].ncio(ncio2, name);
+    } else {
+        for (auto &ii : chunk.matrices) ii.second.ncio(ncio, ii.first);
+        for (auto &ii : chunk.dims) ii.second.ncio(ncio, ii.first);
+        ncio.flush();    // Execute the writes while chunk_nc still exists
+    }
+}
+
+void ChunkCombiner::merge(int chunkno, ChunkResult &&chunk)
+{
+    if (!have_meta) {
+        total.meta = chunk.meta;
+        have_meta = true;
+    }
+    for (auto &ii : chunk.matrices) total.matrices[ii.first].append(ii.second);
+    for (auto &ii : chunk.dims) {
+        DimInfo const &src(ii.second);
+        auto jj(total.dims.find(ii.first));
+        if (jj == total.dims.end()) {
+            jj = total.dims.insert(std::make_pair(ii.first, DimInfo())).first;
+            jj->second.dim.set_sparse_extent(src.dim.sparse_extent());
+            jj->second.shape = src.shape;
+            jj->second.description = src.description;
+        }
+        for (int i=0; i<src.dim.dense_extent(); ++i)
+            jj->second.dim.add_dense(src.dim.to_sparse(i));
+    }
+    chunk.matrices.clear();
+    chunk.dims.clear();
+    chunks_done[chunkno] = 1;
+}
+
+void ChunkCombiner::add(int chunkno, ChunkResult &&chunk)
+{
+    // Checkpoint just this chunk, without holding the combiner lock.
+    // Write to a temporary file and rename, so a crash while
+    // checkpointing leaves no partial checkpoint behind.
+    if (ckpt_fname != "") {
+        std::string const fname(ckpt_chunk_fname(chunkno));
+        std::string const tmp_fname(fname + ".tmp");
+        printf("---- Checkpointing chunk %d to %s\n", chunkno, fname.c_str());
+        {std::lock_guard<std::mutex> nc_lock(netcdf_mutex);
+            NcIO ncio(tmp_fname, 'w', "nc4");
+            ncio_checkpoint(ncio, tmp_fname, chunkno, chunk);
+            ncio.close();
+        }
+        boost::filesystem::rename(tmp_fname, fname);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    merge(chunkno, std::move(chunk));
+}
+
+void ChunkCombiner::write(std::string const &ofname)
+{
+    char ofmode = 'w';
+    for (auto &ii : total.matrices) {
+        std::string const &BvA(ii.first);
+        MatrixPieces const &pieces(ii.second);
+        printf("---- Writing %s to %s (nnz=%ld)\n",
+            BvA.c_str(), ofname.c_str(), (long)pieces.values.size());
+
+        linear::Weighted_Compressed ret;
+        {auto wM(ret.weights[0].accum());
+        auto M(ret.M.accum());
+        auto Mw(ret.weights[1].accum());
+
+            M.set_shape(pieces.shape);
+            wM.set_shape({pieces.shape[0]});
+            Mw.set_shape({pieces.shape[1]});
+
+            for (size_t i=0; i<pieces.wM.size(); ++i)
+                wM.add({pieces.wM_ix[i]}, pieces.wM[i]);
+            for (size_t i=0; i<pieces.values.size(); ++i)
+                M.add({pieces.ix0[i], pieces.ix1[i]}, pieces.values[i]);
+            for (size_t i=0; i<pieces.Mw.size(); ++i)
+                Mw.add({pieces.Mw_ix[i]}, pieces.Mw[i]);
+        }    // Finish off accumulators
+
+        {NcIO ncio(ofname, ofmode);
+            total.meta.ncio(ncio);
+            ret.ncio(ncio, BvA);
+        }
+        ofmode = 'a';
+    }
+
+    // Dimensions: every grid cell used by any chunk.
+    // Sorted, so the output does not depend on the order chunks finished.
+    for (auto &ii : total.dims) {
+        DimInfo const &src(ii.second);
+        printf("---- Writing %s to %s (n=%ld)\n",
+            ii.first.c_str(), ofname.c_str(), (long)src.dim.dense_extent());
+
+        std::vector<long> sparse;
+        sparse.reserve(src.dim.dense_extent());
+        for (int i=0; i<src.dim.dense_extent(); ++i) sparse.push_back(src.dim.to_sparse(i));
+        std::sort(sparse.begin(), sparse.end());
+
+        DimInfo dim;
+        dim.dim.set_sparse_extent(src.dim.sparse_extent());
+        for (long const iS : sparse) dim.dim.add_dense(iS);
+        dim.shape = src.shape;
+        dim.description = src.description;
+
+        NcIO ncio(ofname, ofmode);
+        dim.ncio(ncio, ii.first);
+        ofmode = 'a';
+    }
+}
+
+void ChunkCombiner::remove_checkpoints()
+{
+    if (ckpt_fname == "") return;
+    for (auto const &chunk : chunks)
+        boost::filesystem::remove(ckpt_chunk_fname(chunk[0]));
+}
+
+/** Runs all chunks on a pool of threads in this process, combining
+them as they finish; replaces the Makefile + combine_global_ec. */
+void run_chunks_inproc(
+    FOcean const *focean,
+    ParseArgs const &args,
+    blitz::Array<double,2> const &fgiceO,
+    blitz::Array<int16_t,2> const &fgiceI,
+    blitz::Array<int16_t,2> const &elevI,
+    std::vector<std::array<int,5>> const &chunks)
+{
+    std::string const ckpt_fname(args.checkpoint ? args.ofname + ".ckpt" : "");
+    ChunkCombiner combiner(ckpt_fname, chunks);
+
+    std::vector<int> todo;
+    for (auto const &chunk : chunks)
+        if (!combiner.is_done(chunk[0])) todo.push_back(chunk[0]);
+    printf("---- Running %ld of %ld chunks on %d threads\n",
+        (long)todo.size(), (long)chunks.size(), args.nthreads);
+
+    int const nthreads = std::max(1, std::min(args.nthreads, (int)todo.size()));
+    std::atomic<size_t> next(0);
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::vector<std::thread> threads;
+    for (int t=0; t<nthreads; ++t) {
+        threads.push_back(std::thread([&,t]() {
+            try {
+                for (size_t k; (k = next++) < todo.size(); ) {
+                    auto const &chunk(chunks[todo[k]]);
+
+                    ParseArgs cargs(args);
+                    cargs.run_chunk = true;
+                    cargs.chunk_no = chunk[0];
+                    cargs.chunk_range[0] = {chunk[1], chunk[2]};
+                    cargs.chunk_range[1] = {chunk[3], chunk[4]};
+
+                    ChunkResult result;
+                    {auto elevmaskI(chunk_elevmaskI(cargs, fgiceO, fgiceI, elevI));
+                        global_ec_section(focean, cargs, elevmaskI, &result);
+                    }
+                    combiner.add(chunk[0], std::move(result));
+                }
+            } catch(...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &th : threads) th.join();
+    for (auto &err : errors) if (err) std::rethrow_exception(err);
+
+    combiner.write(args.ofname);
+    combiner.remove_checkpoints();
+}
+
+
+
 int main(int argc, char **argv)
 {
     everytrace_init();
@@ -817,48 +1309,15 @@ int main(int argc, char **argv)
 
     if (args.run_chunk) {
         // ============== Run just one chunk
-
-        // Choose the ice to process on this chunk
-        blitz::Array<double,2> elevmaskI(hspecI.jm, hspecI.im);
-        elevmaskI = NaN;
-
-        // Upper bound
-        int const jO1 = args.chunk_range[1][0];
-        int const iO1 = args.chunk_range[1][1];
-        int const ijO1 = jO1 * hspecO.im + iO1;
-
-        // Set up elevmaskI for the specified range of O grid cells
-        int iO = args.chunk_range[0][1];    // Where we start scanning in fgiceO
-        int jO = args.chunk_range[0][0];
-        int ijO = jO * hspecO.im + iO;
-//printf("elevmaskI: iO=%d, jO=%d, ijO=%d\n", iO, jO, ijO);
-printf("Range: [%d %d] - [%d %d]\n", jO, iO, jO1, iO1);
-        printf("BEGIN O(%d, %d)\n", jO, iO);
-        for (; ; ++jO) {
-            for (; iO < hspecO.im; ++iO, ++ijO) {
-                if (ijO >= ijO1) goto endscan;    // Double break
-
-                if (fgiceO(jO, iO) != 0) {
-//printf("fgiceO(%d,%d)\n", jO, iO);
-                    // Add these I grid cells to elevmaskI
-                    for (int jI=jO*mult_j; jI<(jO+1)*mult_j; ++jI) {
-                    for (int iI=iO*mult_i; iI<(iO+1)*mult_i; ++iI) {
-//printf("elevmaskI(%d,%d) = %d %d\n", jI, iI, fgiceI(jI,iI), elevI(jI,iI));
-                        if (fgiceI(jI,iI)) {
-                            elevmaskI(jI,iI) = elevI(jI,iI);
-                        }
-                    }}
-                }
-            }
-            iO = 0;
-        }
-    endscan: ;
-        printf("END O(%d, %d)\n", jO, iO);
+        auto elevmaskI(chunk_elevmaskI(args, fgiceO, fgiceI, elevI));
         fgiceI.free();
         elevI.free();
 
         // Process the chunk!
-        global_ec_section(files, args, elevmaskI);
+        std::unique_ptr<FOcean> focean;
+        if (args.gcm_grid_option.index() == GCMGridOption::mismatched)
+            focean.reset(new FOcean(files, args));
+        global_ec_section(focean.get(), args, elevmaskI);
     } else {
         // ================== Create chunks to run
 
@@ -893,8 +1352,17 @@ printf("Range: [%d %d] - [%d %d]\n", jO, iO, jO1, iO1);
         }
 
 
-        // Create a makefile
-        write_chunk_makefile(args.ofname, arg_strings, args, chunks);
+        if (args.nthreads > 0) {
+            // Run the chunks here, and combine them as they finish.
+            // Read all input before starting threads.
+            std::unique_ptr<FOcean> focean;
+            if (args.gcm_grid_option.index() == GCMGridOption::mismatched)
+                focean.reset(new FOcean(files, args));
+            run_chunks_inproc(focean.get(), args, fgiceO, fgiceI, elevI, chunks);
+        } else {
+            // Create a makefile
+            write_chunk_makefile(args.ofname, arg_strings, args, chunks);
+        }
     }
 
     return 0;
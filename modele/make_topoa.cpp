@@ -134,8 +134,9 @@ int main(int argc, char **argv)
     Indexing &indexingHCO(indexingHC);
     Indexing indexingHCA({"A", "HC"}, {0,0}, {hspecA.size(), indexingHCO[1].extent}, {1,0});
 
-    // Create the AvO regridder (but not matrix)
+    // Create the AvO and OvA regridders
     Hntr hntr_AvO(17.17, hspecA, hspecO);
+    Hntr hntr_AOvAA(17.17, hspecO, hspecA);
 
 
     // Read input file, and allocate output arrays, ready to save to output file.
@@ -191,7 +192,7 @@ int main(int argc, char **argv)
     auto wAOp(sum(*EOpvAOp, 1, '+'));
     linear::Weighted_Tuple AAmvEAm(_compute_AAmvEAm(
         true, args.eq_rad,    // scale=true
-        hspecO, hspecA, indexingHCO, indexingHCA,
+        hntr_AOvAA, indexingHCO, indexingHCA,
         reshape1(foceanOp), reshape1(foceanOm),   // These don't change over course of a run
         *EOpvAOp, dimEOp, dimAOp, wAOp));
 
@@ -202,7 +203,7 @@ int main(int argc, char **argv)
     std::vector<std::string> errors(make_topoA(
         foceanOm, flakeOm, fgrndOm, fgiceOm, zatmoOm, zlakeOm,
         zicetopOm, zland_minOm, zland_maxOm, mergemaskOm,
-        hspecO, hspecA, indexingHCA, hcdefs, underice_hc,
+        hntr_AvO, indexingHCA, hcdefs, underice_hc,
         AAmvEAm,
         foceanA, flakeA, fgrndA, fgiceA, zatmoA, hlakeA,
         zicetopA, zland_minA, zland_maxA, mergemaskA,
@@ -1,6 +1,26 @@
-/** One-way coupler driver */
-
+/** One-way coupler driver, and coupling benchmark.
+
+Replays GCM output through GCMCoupler_ModelE (as ModelE would call it)
+for a number of coupling timesteps, without ModelE.  Reports the wall
+time of each phase of the coupler (see icebin/profile.hpp) and peak
+RSS, per coupling timestep, to a CSV or JSON file.
+
+Run in a ModelE run directory: reads config/icebin.nc, TOPO and
+log/constants.nc.  Use IceCoupler::Type::DISMAL in config/icebin.nc to
+benchmark without PISM. */
+
+#include <mpi.h>        // Intel MPI wants to be first
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <tclap/CmdLine.h>
 #include <icebin/modele/GCMCoupler_ModelE.hpp>
+#include <icebin/profile.hpp>
+#include <icebin/error.hpp>
 #include <ibmisc/bundle.hpp>
 #include <everytrace.h>
 
@@ -8,10 +28,95 @@ using namespace icebin;
 using namespace icebin::modele;
 using namespace ibmisc;
 
-// Name of constants file written by ModelE
-std::string const constants_fname = "log/constants.nc";
-std::string const TOPO_fname = "TOPO";
-std::string const forcing_fname = "gcm-out-19500305.nc";
+// =============================================================================
+struct ParseArgs {
+    std::string forcing_fname;
+    std::string forcing_mode;    // file, loop or synthetic
+    std::string constants_fname;
+    std::string topo_fname;
+    std::string out_fname;
+    int nsteps;
+    int warmup;
+    int repeat;
+    double dtsrc;
+    int couple_every;
+    int yeari;
+
+    ParseArgs(int argc, char **argv);
+};
+
+ParseArgs::ParseArgs(int argc, char **argv)
+{
+    try {
+        TCLAP::CmdLine cmd("Replays GCM output through the IceBin coupler, timing each phase", ' ', "<no-version>");
+
+        TCLAP::ValueArg<std::string> forcing_a("f", "forcing",
+            "GCM output to replay (eg written by icebin_logging), one record per coupling timestep",
+            false, "gcm-out-19500305.nc", "forcing file", cmd);
+
+        TCLAP::ValueArg<std::string> forcing_mode_a("m", "mode",
+            "file: one forcing record per timestep; loop: cycle through the forcing records; synthetic: no forcing file",
+            false, "loop", "file|loop|synthetic", cmd);
+
+        TCLAP::ValueArg<std::string> constants_a("c", "constants",
+            "Constants written by ModelE",
+            false, "log/constants.nc", "constants file", cmd);
+
+        TCLAP::ValueArg<std::string> topo_a("t", "topo",
+            "TOPO file for the GCM",
+            false, "TOPO", "TOPO file", cmd);
+
+        TCLAP::ValueArg<std::string> out_a("o", "output",
+            "OUT: Timings; JSON if it ends in .json, otherwise CSV",
+            false, "oneway-timings.csv", "output file", cmd);
+
+        TCLAP::ValueArg<int> nsteps_a("n", "nsteps",
+            "Number of coupling timesteps to time",
+            false, 100, "int", cmd);
+
+        TCLAP::ValueArg<int> warmup_a("w", "warmup",
+            "Number of coupling timesteps to run (untimed) before timing",
+            false, 2, "int", cmd);
+
+        TCLAP::ValueArg<int> repeat_a("r", "repeat",
+            "Number of times to replay the nsteps timesteps",
+            false, 1, "int", cmd);
+
+        TCLAP::ValueArg<double> dtsrc_a("d", "dtsrc",
+            "Length of a GCM timestep [s]",
+            false, 1800., "seconds", cmd);
+
+        TCLAP::ValueArg<int> couple_every_a("e", "couple_every",
+            "Number of GCM timesteps per coupling timestep",
+            false, 48, "int", cmd);
+
+        TCLAP::ValueArg<int> yeari_a("y", "year",
+            "Year the simulation starts",
+            false, 1950, "int", cmd);
+
+        cmd.parse( argc, argv );
+
+        forcing_fname = forcing_a.getValue();
+        forcing_mode = forcing_mode_a.getValue();
+        constants_fname = constants_a.getValue();
+        topo_fname = topo_a.getValue();
+        out_fname = out_a.getValue();
+        nsteps = nsteps_a.getValue();
+        warmup = warmup_a.getValue();
+        repeat = repeat_a.getValue();
+        dtsrc = dtsrc_a.getValue();
+        couple_every = couple_every_a.getValue();
+        yeari = yeari_a.getValue();
+    } catch (TCLAP::ArgException &e) { // catch any exceptions
+        std::cerr << "error: " << e.error() << " for arg " << e.argId() << std::endl;
+        exit(1);
+    }
+
+    if (forcing_mode != "file" && forcing_mode != "loop" && forcing_mode != "synthetic") {
+        std::cerr << "error: unknown forcing mode " << forcing_mode << std::endl;
+        exit(1);
+    }
+}
 
 // =============================================================================
 struct GCMOutputBundles {
@@ -140,6 +245,7 @@ GCMInputBundles gcm_inputs_bundles()
 }
 
 // =============================================================================
+/** TOPO fields, passed to the coupler as its ATOPO and ETOPO inputs */
 struct GlobalBundles {
     ibmisc::ArrayBundle<double,3> Ed;
     ibmisc::ArrayBundle<int,3> Ei;
@@ -167,10 +273,6 @@ GlobalBundles global_bundles()
         "description", "Fraction of Atmosphere grid cell that is ocean."
     });
     bundles.Ad.add("flake", {
-        "units", "1",
-        "description", "Fraction of Atmosphere grid cell that is ocean."
-    });
-    bundles.Ad.add("focean", {
         "units", "1",
         "description", "Fraction of Atmosphere grid cell that is lake."
     });
@@ -191,75 +293,119 @@ GlobalBundles global_bundles()
 }
 
 // =============================================================================
+/** Phases of the coupler reported by the benchmark, in the order
+they happen (see profile::Timer in the coupler) */
+static std::vector<std::string> const phases {
+    "densify", "construct_ice_ivalsI", "run_timestep", "regrid_matrices",
+    "AvI_EvI", "E1vE0c", "update_topo", "split_by_domain"};
+
+/** Timings of one coupling timestep (max over MPI ranks) */
+struct StepTimes {
+    int rep;
+    int step;
+    double time_s;          // Simulation time
+    double wall_s;          // Wall time of gcmce_couple_native()
+    std::vector<double> phase_s;    // Wall time in each of phases
+    // Part of phase_s spent in a background thread, overlapping other
+    // phases (coupling_lag > 0); so phase_s may sum to more than wall_s.
+    std::vector<double> concurrent_s;
+    long peak_rss_kb;
+};
+
+/** Registers each variable in a bundle with the coupler.
+@param add Called as add(name, units, description, initial, arr_f) */
+template<int RANK, class AddFn>
+static void add_bundle(ArrayBundle<double,RANK> &bundle, AddFn const &add)
+{
+    for (size_t i=0; i<bundle.index.size(); ++i) {
+        typename ArrayBundle<double,RANK>::Data &meta(bundle.data[i]);
+        std::map<std::string, std::string> attr(meta.meta.make_attr_map());
+
+        std::string const &name(meta.meta.name);
+        std::string const &units(attr.at("units"));
+        std::string const &description(attr.at("description"));
+        auto initial_ii(attr.find("initial"));
+        bool initial = (initial_ii == attr.end() ? true : atoi(initial_ii->second.c_str()));
+
+        auto arr_f(f90array(meta.arr));
+        add(name, units, description, initial, arr_f);
+    }
+}
 
 struct Oneway {
+    ParseArgs const &args;
+    MPI_Comm comm;
+    int world_size;
+    int world_rank;
+
+    ModelEParams rdparams;    // gcmce keeps a pointer to this
     std::unique_ptr<GCMCoupler_ModelE> gcmce;
 
     int const im = 144;
     int const jm = 90;
     int nhc_gcm;
 
-    Oneway(int argc, char **argv);
+    // Arrays shared with the coupler (Fortran order, as in ModelE)
+    GCMOutputBundles outputs;
+    GCMInputBundles inputs;
+    GlobalBundles globals;
+    blitz::Array<double,3> underice_d;
 
-};
+    // Number of records in the forcing file
+    int nforcing = 0;
 
+    std::vector<StepTimes> times;
 
+    Oneway(ParseArgs const &_args);
 
-Oneway::Oneway(int argc, char **argv)
-{
-    // Initialize the MPI environment
-    MPI_Init(&argc, &argv);
+    /** Sets the GCM outputs for a coupling timestep
+    @param step Index of the (timed) coupling timestep */
+    void set_forcing(int step);
 
-    // Get the communicator
-    MPI_Comm comm = MPI_COMM_WORLD;
+    /** Runs and times one coupling timestep */
+    StepTimes couple(int itime);
 
-    // Get the number of processes
-    int world_size;
-    MPI_Comm_size(comm, &world_size);
+    /** Runs the benchmark */
+    void run();
 
-    // Get the rank of the process
-    int world_rank;
+    void write_csv(std::string const &fname) const;
+    void write_json(std::string const &fname) const;
+};
+
+
+Oneway::Oneway(ParseArgs const &_args) : args(_args),
+    outputs(gcm_outputs_bundles()),
+    inputs(gcm_inputs_bundles()),
+    globals(global_bundles())
+{
+    comm = MPI_COMM_WORLD;
+    MPI_Comm_size(comm, &world_size);
     MPI_Comm_rank(comm, &world_rank);
 
-    // Get the name of the processor
-    char processor_name[MPI_MAX_PROCESSOR_NAME];
-    int name_len;
-    MPI_Get_processor_name(processor_name, &name_len);
- 
-    // Print a hello world message
-    printf("Hello world from processor %s, rank %d"
-        " out of %d processors\n",
-        processor_name, world_rank, world_size);
- 
-    // -----------------------------------
-
-    // Initialize.  Put the entire domain in root, to make our driver job easier.
+    // Cold start; no restart files
+    rdparams.istart = 2;
+
+    // Split the domain into bands of latitude, as ModelE does.
+    // Arrays are allocated (and read) for the whole domain on every rank;
+    // each rank only couples its own band.
     // NOTE: gcmce_new() reads from ./config/icebin.nc
-    gcmce.reset(world_rank == 0 ?
-        gcmce_new(
-            ModelEParams(),    // Dummy for now
-            im, jm,
-            1, im, 1, jm,        // The entire domain is in root
-            MPI_Comm_c2f(comm),
-            0)
-        :
-        gcmce_new(
-            ModelEParams(),    // Dummy for now
-            im, jm,
-            1, 0, 1, 0,        // No part of the domain is in non-root
-            MPI_Comm_c2f(comm),
-            0)
-    );
+    int const j0 = (world_rank * jm) / world_size + 1;
+    int const j1 = ((world_rank+1) * jm) / world_size;
+    gcmce.reset(gcmce_new(
+        rdparams,
+        im, jm,
+        1, im, j0, j1,
+        MPI_Comm_c2f(comm),
+        0));
 
     // Figure out how many elevation classes we need.
-    int nhc_gcm;
     int icebin_base_hc;
     int nhc_ice;
     gcmce_hc_params(&*gcmce, nhc_gcm, icebin_base_hc, nhc_ice);
 
     // Read constants from NetCDF file written during ModelE run
     // (in lieu of calling gcmce_set_constant())
-    {NcIO ncio(constants_fname, 'r');
+    {NcIO ncio(args.constants_fname, 'r');
         gcmce->gcm_constants.read_nc(ncio.nc, "");
     }
 
@@ -268,79 +414,58 @@ Oneway::Oneway(int argc, char **argv)
     //
     // Allocate arrays used to communicate with coupler
     // And register them with IceBin Coupler
-    GCMOutputBundles outputs(gcm_outputs_bundles());
+    GCMCoupler_ModelE *self = &*gcmce;
+
     outputs.E.allocate(
         {im,jm,nhc_gcm},
         {"im","jm","nhc_gcm"},
         true, blitz::fortranArray);
-    for (size_t i=0; i<outputs.E.index.size(); ++i) {
-        ArrayBundle<double,3>::Data &meta(outputs.E.data[i]);
-//        std::map<std::string, std::string> attr(meta.meta.attr.begin(), meta.meta.attr.end());
-        std::map<std::string, std::string> attr(meta.meta.make_attr_map());
-
-        std::string const &name(meta.meta.name);
-        std::string const &units(attr.at("units"));
-        std::string const &description(attr.at("description"));
-        auto initial_ii(attr.find("initial"));
-        bool initial = (initial_ii == attr.end() ? true : atoi(initial_ii->second.c_str()));
-
-        auto arr_f(f90array(meta.arr));
-        gcmce_add_gcm_inpute(&*gcmce, arr_f,
+    add_bundle(outputs.E, [self](std::string const &name,
+        std::string const &units, std::string const &description,
+        bool initial, F90Array<double,3> &arr_f)
+    {
+        gcmce_add_gcm_outpute(self, arr_f,
             name.c_str(), name.size(),
             units.c_str(), units.size(),
-            initial,
+            "", 0, 1.0, 0.0,
             description.c_str(), description.size());
-    }
+    });
 
-    GCMInputBundles inputs(gcm_inputs_bundles());
     inputs.A.allocate(
         {im, jm},
         {"im","jm"},
         true, blitz::fortranArray);
-    for (size_t i=0; i<inputs.A.index.size(); ++i) {
-        ArrayBundle<double,2>::Data &meta(inputs.A.data[i]);
-        std::map<std::string, std::string> attr(meta.meta.make_attr_map());
-
-        std::string const &name(meta.meta.name);
-        std::string const &units(attr.at("units"));
-        std::string const &description(attr.at("description"));
-        auto initial_ii(attr.find("initial"));
-        bool initial = (initial_ii == attr.end() ? true : atoi(initial_ii->second.c_str()));
-
-        auto arr_f(f90array(meta.arr));
-        gcmce_add_gcm_inputa(&*gcmce, arr_f,
+    add_bundle(inputs.A, [self](std::string const &name,
+        std::string const &units, std::string const &description,
+        bool initial, F90Array<double,2> &arr_f)
+    {
+        gcmce_add_gcm_inputa(self, (int)IndexAE::A, arr_f,
             name.c_str(), name.size(),
             units.c_str(), units.size(),
+            "", 0, 1.0, 0.0,
             initial,
             description.c_str(), description.size());
-    }
+    });
 
     inputs.E.allocate(
         {im,jm, nhc_gcm},
         {"im","jm","nhc_gcm"},
         true, blitz::fortranArray);
-    for (size_t i=0; i<inputs.E.index.size(); ++i) {
-        ArrayBundle<double,3>::Data &meta(inputs.E.data[i]);
-        std::map<std::string, std::string> attr(meta.meta.make_attr_map());
-
-        std::string const &name(meta.meta.name);
-        std::string const &units(attr.at("units"));
-        std::string const &description(attr.at("description"));
-        auto initial_ii(attr.find("initial"));
-        bool initial = (initial_ii == attr.end() ? true : atoi(initial_ii->second.c_str()));
-
-        auto arr_f(f90array(meta.arr));
-        gcmce_add_gcm_inpute(&*gcmce, arr_f,
+    add_bundle(inputs.E, [self](std::string const &name,
+        std::string const &units, std::string const &description,
+        bool initial, F90Array<double,3> &arr_f)
+    {
+        gcmce_add_gcm_inpute(self, (int)IndexAE::E, arr_f,
             name.c_str(), name.size(),
             units.c_str(), units.size(),
+            "", 0, 1.0, 0.0,
             initial,
             description.c_str(), description.size());
-    }
+    });
 
     // ----------------------------------------------------------------
-    // gcmce_reference_globals()
-
-    GlobalBundles globals;
+    // TOPO fields: initial values from the TOPO file; updated by the
+    // coupler (update_topo()) after that.
     globals.Ed.allocate(
         {im,jm, nhc_gcm},
         {"im","jm","nhc_gcm"},
@@ -357,46 +482,252 @@ Oneway::Oneway(int argc, char **argv)
         true,
         blitz::fortranArray);
 
-    gcmce_reference_globals(&*gcmce,
-        f90array(globals.Ed.array("fhc")),
-        f90array(globals.Ei.array("underice")),
-        f90array(globals.Ed.array("elevE")),
-        f90array(globals.Ad.array("focean")),
-        f90array(globals.Ad.array("flake")),
-        f90array(globals.Ad.array("fgrnd")),
-        f90array(globals.Ad.array("fgice")),
-        f90array(globals.Ad.array("zatmo"))
-    );
-
-    // -----------------------------------------------------------------
-    // Read TOPO file into GlobalBundles
-    {NcIO ncio(TOPO_fname, 'r');
+    {NcIO ncio(args.topo_fname, 'r');
         globals.Ed.ncio(ncio, {}, "", "double");
         globals.Ei.ncio(ncio, {}, "", "int");
         globals.Ad.ncio(ncio, {}, "", "double");
     }
 
+    // The coupler wants underice as a double
+    underice_d.reference(blitz::Array<double,3>(
+        blitz::shape(im,jm,nhc_gcm), blitz::fortranArray));
+    underice_d = blitz::cast<double>(globals.Ei.array("underice"));
+
+    add_bundle(globals.Ad, [self](std::string const &name,
+        std::string const &units, std::string const &description,
+        bool initial, F90Array<double,2> &arr_f)
+    {
+        gcmce_add_gcm_inputa(self, (int)IndexAE::ATOPO, arr_f,
+            name.c_str(), name.size(),
+            units.c_str(), units.size(),
+            "", 0, 1.0, 0.0,
+            true,
+            description.c_str(), description.size());
+    });
+    add_bundle(globals.Ed, [self](std::string const &name,
+        std::string const &units, std::string const &description,
+        bool initial, F90Array<double,3> &arr_f)
+    {
+        gcmce_add_gcm_inpute(self, (int)IndexAE::ETOPO, arr_f,
+            name.c_str(), name.size(),
+            units.c_str(), units.size(),
+            "", 0, 1.0, 0.0,
+            true,
+            description.c_str(), description.size());
+    });
+    {
+        auto arr_f(f90array(underice_d));
+        std::string const name("underice_d");
+        std::string const units("1");
+        std::string const description("underice, as double");
+        gcmce_add_gcm_inpute(self, (int)IndexAE::ETOPO, arr_f,
+            name.c_str(), name.size(),
+            units.c_str(), units.size(),
+            "", 0, 1.0, 0.0,
+            true,
+            description.c_str(), description.size());
+    }
 
     // -----------------------------------------------------------------
-    // Read a single forcing to use over and over again...
+    // Size of the forcing
+    if (args.forcing_mode != "synthetic") {
+        NcIO ncio(args.forcing_fname, 'r');
+        nforcing = ncio.nc->getVar(outputs.E.data[0].meta.name).getDim(0).getSize();
+        if (args.forcing_mode == "file" && nforcing < args.warmup + args.nsteps) (*icebin_error)(-1,
+            "Forcing file %s has %d records, need %d (use --mode loop?)",
+            args.forcing_fname.c_str(), nforcing, args.warmup + args.nsteps);
+    }
+}
+
+void Oneway::set_forcing(int step)
+{
+    if (args.forcing_mode == "synthetic") {
+        // Deterministic SMB: a seasonal cycle, shifted by location
+        double const phase0 = 2. * M_PI * step / 365.;
+        blitz::Array<double,3> &massxfer(outputs.E.array("massxfer"));
+        blitz::Array<double,3> &enthxfer(outputs.E.array("enthxfer"));
+        for (int i=massxfer.lbound(0); i<=massxfer.ubound(0); ++i) {
+        for (int j=massxfer.lbound(1); j<=massxfer.ubound(1); ++j) {
+        for (int k=massxfer.lbound(2); k<=massxfer.ubound(2); ++k) {
+            double const phase = phase0 + 0.1*i + 0.2*j + 0.5*k;
+            massxfer(i,j,k) = 1e-5 * (1. + std::sin(phase));    // [kg m-2 s-1]
+            enthxfer(i,j,k) = massxfer(i,j,k) * -3.5e5;         // [W m-2]
+        }}}
+        return;
+    }
 
-    int itime=0;
-    {NcIO ncio(forcing_fname, 'r');
+    // Warm-up uses the first records; every replay reads the records after them
+    int const itime = (step + args.warmup) % nforcing;
+    {NcIO ncio(args.forcing_fname, 'r');
         outputs.E.ncio_partial(
             ncio, {}, "", "double",
             {}, {itime, 0, 0, 0}, {3,2,1});
     }
+}
+
+StepTimes Oneway::couple(int itime)
+{
+    StepTimes ret;
+    ret.time_s = itime * args.dtsrc;
+
+    auto const phases0(profile::profiler.snapshot());
+    MPI_Barrier(comm);
+    auto const t0(std::chrono::steady_clock::now());
+
+    int *E1vE0c_indices;
+    double *E1vE0c_values;
+    int E1vE0c_nele;
+    gcmce_couple_native(&*gcmce, itime, true,
+        &E1vE0c_indices, &E1vE0c_values, &E1vE0c_nele);
+
+    double const wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - t0).count();
+    auto phases1(profile::profiler.snapshot());
+
+    // Local timings (total, then concurrent), followed by peak RSS
+    std::vector<double> local;
+    local.push_back(wall_s);
+    for (auto const &phase : phases) {
+        auto ii0(phases0.find(phase));
+        local.push_back(phases1[phase].total_s
+            - (ii0 == phases0.end() ? 0. : ii0->second.total_s));
+    }
+    for (auto const &phase : phases) {
+        auto ii0(phases0.find(phase));
+        local.push_back(phases1[phase].concurrent_s
+            - (ii0 == phases0.end() ? 0. : ii0->second.concurrent_s));
+    }
+    local.push_back(profile::peak_rss_kb());
+
+    // Max over all ranks
+    std::vector<double> global(local.size());
+    MPI_Reduce(&local[0], &global[0], local.size(), MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    ret.wall_s = global[0];
+    ret.phase_s.assign(global.begin()+1, global.begin()+1+phases.size());
+    ret.concurrent_s.assign(global.begin()+1+phases.size(), global.begin()+1+2*phases.size());
+    ret.peak_rss_kb = global.back();
+    return ret;
+}
+
+void Oneway::run()
+{
+    int itime = 0;
+    gcmce_model_start(&*gcmce, true, args.yeari, itime, args.dtsrc);
+
+    profile::profiler.enabled = true;
+
+    // ---------- Warm-up (not recorded)
+    for (int step=-args.warmup; step<0; ++step) {
+        set_forcing(step);
+        itime += args.couple_every;
+        couple(itime);
+    }
+
+    // ---------- Timed replays
+    for (int rep=0; rep<args.repeat; ++rep) {
+        for (int step=0; step<args.nsteps; ++step) {
+            set_forcing(step);
+            itime += args.couple_every;
+            StepTimes st(couple(itime));
+            st.rep = rep;
+            st.step = step;
+            if (world_rank == 0) {
+                printf("oneway: rep=%d step=%d wall=%gs peak_rss=%ldkB\n",
+                    rep, step, st.wall_s, st.peak_rss_kb);
+                times.push_back(std::move(st));
+            }
+        }
+    }
 
+    if (world_rank == 0) {
+        std::string const &fname(args.out_fname);
+        bool const json = (fname.size() >= 5 && fname.substr(fname.size()-5) == ".json");
+        if (json) write_json(fname);
+        else write_csv(fname);
+        printf("oneway: Wrote timings of %ld coupling timesteps to %s\n",
+            times.size(), fname.c_str());
+    }
+}
 
-    // Set up a single domain
-    GCMCoupler_ModelE *gcmc;
+void Oneway::write_csv(std::string const &fname) const
+{
+    FILE *fout = fopen(fname.c_str(), "w");
+    if (!fout) (*icebin_error)(-1, "Cannot open %s for writing", fname.c_str());
+
+    fprintf(fout, "rep,step,time_s,wall_s");
+    for (auto const &phase : phases) fprintf(fout, ",%s_s", phase.c_str());
+    for (auto const &phase : phases) fprintf(fout, ",%s_concurrent_s", phase.c_str());
+    fprintf(fout, ",peak_rss_kb\n");
+
+    for (StepTimes const &st : times) {
+        fprintf(fout, "%d,%d,%.17g,%.17g", st.rep, st.step, st.time_s, st.wall_s);
+        for (double t : st.phase_s) fprintf(fout, ",%.17g", t);
+        for (double t : st.concurrent_s) fprintf(fout, ",%.17g", t);
+        fprintf(fout, ",%ld\n", st.peak_rss_kb);
+    }
+    fclose(fout);
+}
 
+void Oneway::write_json(std::string const &fname) const
+{
+    FILE *fout = fopen(fname.c_str(), "w");
+    if (!fout) (*icebin_error)(-1, "Cannot open %s for writing", fname.c_str());
+
+    fprintf(fout, "{\n");
+    fprintf(fout, "  \"forcing_mode\": \"%s\",\n", args.forcing_mode.c_str());
+    fprintf(fout, "  \"nsteps\": %d,\n  \"warmup\": %d,\n  \"repeat\": %d,\n",
+        args.nsteps, args.warmup, args.repeat);
+    fprintf(fout, "  \"mpi_ranks\": %d,\n", world_size);
+    fprintf(fout, "  \"coupling_lag\": %d,\n", gcmce->coupling_lag);
+
+    // Summary of each phase over all timed steps.
+    // concurrent_s overlaps other phases, and is not part of wall time.
+    fprintf(fout, "  \"summary\": {\n");
+    for (size_t k=0; k <= phases.size(); ++k) {
+        std::string const name(k == 0 ? "wall" : phases[k-1]);
+        double total = 0, max = 0, concurrent = 0;
+        for (StepTimes const &st : times) {
+            double const t = (k == 0 ? st.wall_s : st.phase_s[k-1]);
+            total += t;
+            max = std::max(max, t);
+            if (k > 0) concurrent += st.concurrent_s[k-1];
+        }
+        fprintf(fout, "    \"%s\": {\"total_s\": %.17g, \"mean_s\": %.17g, \"max_s\": %.17g, \"concurrent_s\": %.17g}%s\n",
+            name.c_str(), total, times.size() == 0 ? 0. : total / times.size(), max, concurrent,
+            k < phases.size() ? "," : "");
+    }
+    fprintf(fout, "  },\n");
+    fprintf(fout, "  \"peak_rss_kb\": %ld,\n",
+        times.size() == 0 ? 0L : times.back().peak_rss_kb);
+
+    // Every step
+    fprintf(fout, "  \"steps\": [\n");
+    for (size_t i=0; i<times.size(); ++i) {
+        StepTimes const &st(times[i]);
+        fprintf(fout, "    {\"rep\": %d, \"step\": %d, \"time_s\": %.17g, \"wall_s\": %.17g",
+            st.rep, st.step, st.time_s, st.wall_s);
+        for (size_t k=0; k<phases.size(); ++k)
+            fprintf(fout, ", \"%s_s\": %.17g", phases[k].c_str(), st.phase_s[k]);
+        for (size_t k=0; k<phases.size(); ++k)
+            fprintf(fout, ", \"%s_concurrent_s\": %.17g", phases[k].c_str(), st.concurrent_s[k]);
+        fprintf(fout, ", \"peak_rss_kb\": %ld}%s\n",
+            st.peak_rss_kb, i+1 < times.size() ? "," : "");
+    }
+    fprintf(fout, "  ]\n}\n");
+    fclose(fout);
 }
 
 
 int main(int argc, char **argv)
 {
     everytrace_init();
-    Oneway ow(argc, argv);
-}
+    ParseArgs args(argc, argv);
 
+    MPI_Init(&argc, &argv);
+    {
+        Oneway ow(args);
+        ow.run();
+    }
+    MPI_Finalize();
+}
@@ -1,5 +1,6 @@
 #include <icebin/AbbrGrid.hpp>
 #include <icebin/Grid.hpp>
+#include <icebin/snapshot.hpp>
 #include <ibmisc/netcdf.hpp>
 
 using namespace ibmisc;
@@ -20,14 +21,25 @@ ExchangeGrid::ExchangeGrid(Grid const &g)
     }
 }
 
-void ExchangeGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname)
+void ExchangeGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap)
 {
+    if (snap) {
+        snapshot(*snap, vname);
+        return;
+    }
+
     ncio_vector(ncio, indices, true, vname + ".indices", "int",
         get_or_add_dims(ncio, indices, {vname + ".nindices"}));
     ncio_vector(ncio, overlaps, true, vname + ".overlaps", "double",
         get_or_add_dims(ncio, overlaps, {vname + ".noverlaps"}));
 }
 
+void ExchangeGrid::snapshot(SnapshotIO &snap, std::string const &vname)
+{
+    snap.vector(indices, vname + ".indices");
+    snap.vector(overlaps, vname + ".overlaps");
+}
+
 
 /** Filters overlaps based on the destination (BvA = B = index[0]) grid. */
 void ExchangeGrid::filter_cellsB(std::function<bool(long)> const &keep_B_fn)
@@ -164,7 +176,7 @@ void AbbrGrid::filter_cells(std::function<bool(long)> const &keep_fn)
 }
 
 
-void AbbrGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname)
+void AbbrGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap)
 {
     ncio_grid_spec(ncio, spec, vname);
 
@@ -176,6 +188,12 @@ void AbbrGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname)
 
     indexing.ncio(ncio, vname + ".indexing");
 
+    // Bulk arrays come from the snapshot instead
+    if (snap) {
+        snapshot(*snap, vname);
+        return;
+    }
+
     // Store dim; retrieve dimension from it
     dim.ncio(ncio, vname + ".dim");
 
@@ -193,6 +211,14 @@ void AbbrGrid::ncio(ibmisc::NcIO &ncio, std::string const &vname)
 
 }
 
+void AbbrGrid::snapshot(SnapshotIO &snap, std::string const &vname)
+{
+    snap.sparse_set(dim, vname + ".dim");
+    snap.blitz(ijk, vname + ".ijk");
+    snap.blitz(native_area, vname + ".native_area");
+    snap.blitz(centroid_xy, vname + ".centroid_xy");
+}
+
 // ==============================================================================
 // We only need to define these because blitz::Array does not follow STL conventions
 // and is not movable.
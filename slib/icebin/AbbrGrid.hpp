@@ -36,6 +36,7 @@
 namespace icebin {
 
 class Grid;
+class SnapshotIO;
 
 class ExchangeGrid {
     // Sparse indexing needed by IceRegridder::init()
@@ -77,7 +78,9 @@ public:
     double native_area(int id) const
         { return overlaps[id]; }
 
-    void ncio(ibmisc::NcIO &ncio, std::string const &vname);
+    /** @param snap If set, indices/overlaps are read/written there instead. */
+    void ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap = nullptr);
+    void snapshot(SnapshotIO &snap, std::string const &vname);
 
     /** NOTE: This will result in ExchangeGrid cells being renumbered,
     resulting in different numbering schemes for different processors.
@@ -108,7 +111,10 @@ struct AbbrGrid {
     // Only set if coordinates == GridCoordinates::XY
     blitz::Array<double,2> centroid_xy;    // centroid(index, xy)
 
-    virtual void ncio(ibmisc::NcIO &ncio, std::string const &vname);
+    /** @param snap If set, dim and the per-cell arrays are read/written
+        there instead; metadata still goes through ncio. */
+    virtual void ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap = nullptr);
+    void snapshot(SnapshotIO &snap, std::string const &vname);
 
     AbbrGrid() {}
     explicit AbbrGrid(Grid const &g);
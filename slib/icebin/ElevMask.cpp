@@ -94,5 +94,21 @@ blitz::Array<double,1> &emI_ice)
     }
 }
 
+std::vector<long> diff_elevmask(
+    blitz::Array<double,1> const &emI0,
+    blitz::Array<double,1> const &emI1)
+{
+    if (emI0.extent(0) != emI1.extent(0)) (*icebin_error)(-1,
+        "elevmaskI extents differ: %d vs %d", emI0.extent(0), emI1.extent(0));
+
+    std::vector<long> changed;
+    for (int iI=0; iI<emI1.extent(0); ++iI) {
+        bool const nan0 = std::isnan(emI0(iI));
+        bool const nan1 = std::isnan(emI1(iI));
+        if ((nan0 != nan1) || (!nan0 && emI0(iI) != emI1(iI)))
+            changed.push_back(iI);
+    }
+    return changed;
+}
 
 }    // namespace
@@ -2,6 +2,7 @@
 #define ICEBIN_ELEVMASK_HPP
 
 #include <memory>
+#include <vector>
 #include <blitz/array.h>
 #include <ibmisc/netcdf.hpp>
 
@@ -23,5 +24,14 @@ std::string const &xfname,
 blitz::Array<double,1> &emI_land,
 blitz::Array<double,1> &emI_ice);
 
+/** Lists the ice grid cells whose elevmaskI differs between two
+versions of it.  Masked-out cells (NaN) compare equal to each other.
+@param emI0 Old elevmaskI
+@param emI1 New elevmaskI
+@return Indices (iI) of changed cells, in increasing order */
+std::vector<long> diff_elevmask(
+    blitz::Array<double,1> const &emI0,
+    blitz::Array<double,1> const &emI1);
+
 }    // namespace
 #endif    // guard
@@ -18,6 +18,8 @@
 
 #include <mpi.h>        // Intel MPI wants to be first
 #include <functional>
+#include <algorithm>
+#include <type_traits>
 #include <boost/format.hpp>
 #include <boost/algorithm/string.hpp>
 #include <ibmisc/netcdf.hpp>
@@ -29,6 +31,8 @@
 #include <icebin/GCMRegridder.hpp>
 #include <icebin/contracts/contracts.hpp>
 #include <icebin/e1ve0.hpp>
+#include <icebin/snapshot.hpp>
+#include <icebin/profile.hpp>
 #include <spsparse/netcdf.hpp>
 
 #ifdef USE_PISM
@@ -120,6 +124,21 @@ void GCMCoupler::_ncread(
     get_or_put_att(config_info, ncio_config.rw, "output_dir", output_dir);
     get_or_put_att(config_info, ncio_config.rw, "use_smb", &use_smb, 1);
 
+    // (OPTIONAL) Binary snapshot of the grid file's bulk arrays
+    std::string grid_snapshot;
+    {auto atts(config_info.getAtts());
+        if (atts.find("grid_snapshot") != atts.end())
+            get_or_put_att(config_info, ncio_config.rw, "grid_snapshot", grid_snapshot);
+        if (atts.find("distribute_sheets") != atts.end())
+            get_or_put_att(config_info, ncio_config.rw, "distribute_sheets", &distribute_sheets, 1);
+        if (atts.find("coupling_lag") != atts.end())
+            get_or_put_att(config_info, ncio_config.rw, "coupling_lag", &coupling_lag, 1);
+    }
+    if (coupling_lag < 0 || coupling_lag > 1) (*icebin_error)(-1,
+        "coupling_lag=%d must be 0 or 1", coupling_lag);
+    if (coupling_lag > 0 && distribute_sheets) (*icebin_error)(-1,
+        "coupling_lag is not supported with distribute_sheets");
+
     printf("BEGIN GCMCoupler::ncread(%s)\n", grid_fname.c_str()); fflush(stdout);
 
 //    bool rw_full = am_i_root();
@@ -129,7 +148,23 @@ void GCMCoupler::_ncread(
     {
         std::unique_ptr<GCMRegridder_Standard> gcmr(new GCMRegridder_Standard());
         NcIO ncio_grid(grid_fname, NcFile::read);
-        gcmr->ncio(ncio_grid, vname);
+        if (grid_snapshot != "" && SnapshotIO::is_current(grid_snapshot, grid_fname)) {
+            printf("Reading grid snapshot %s\n", grid_snapshot.c_str());
+            SnapshotIO snap(grid_snapshot, 'r');
+            gcmr->ncio_snapshot(ncio_grid, vname, &snap);
+            ncio_grid.close();
+        } else {
+            gcmr->ncio(ncio_grid, vname);
+            ncio_grid.close();    // Complete the reads before snapshotting
+
+            // Write snapshot for next time
+            if (grid_snapshot != "" && am_i_root()) {
+                printf("Writing grid snapshot %s\n", grid_snapshot.c_str());
+                SnapshotIO snap(grid_snapshot, 'w', grid_fname);
+                gcmr->snapshot(snap, vname);
+                snap.close();
+            }
+        }
         static_move(gcm_regridder, gcmr);    // Move gcm_regridder <- gcm
     }
 
@@ -144,7 +179,6 @@ void GCMCoupler::_ncread(
     }
 
     // Compute static info about combined exchange grids
-    size_t const nsheet = gcm_regridder->ice_regridders().size();
     ice_couplers.clear();
     basesX = std::vector<long>{0};  // Base of first exchange grid is 0
     areaX.clear();
@@ -161,9 +195,41 @@ void GCMCoupler::_ncread(
         }
     }
 
+    init_sheet_roots();
+
     printf("END GCMCoupler::ncread(%s)\n", grid_fname.c_str()); fflush(stdout);
 }
 
+void GCMCoupler::init_sheet_roots()
+{
+    // Assign each ice sheet to the MPI rank that will regrid it
+    // (round-robin over the ranks after gcm_root)
+    size_t const nsheet = gcm_regridder->ice_regridders().size();
+    int const nrank = gcm_params.world.size();
+    sheet_roots.clear();
+    sheet_comms.clear();
+    for (size_t sheetix=0; sheetix < nsheet; ++sheetix) {
+        int const sheet_root = (distribute_sheets && nrank > 1 ?
+            (gcm_params.gcm_root + 1 + sheetix % (nrank-1)) % nrank
+            : gcm_params.gcm_root);
+        sheet_roots.push_back(sheet_root);
+
+        // Collective over gcm_comm; null communicator on all other ranks
+        if (!distribute_sheets) {
+            sheet_comms.push_back(boost::mpi::communicator(
+                MPI_COMM_NULL, boost::mpi::comm_attach));
+            continue;
+        }
+        bool const member = (sheet_root != gcm_params.gcm_root) &&
+            (am_i_root() || gcm_params.gcm_rank == sheet_root);
+        sheet_comms.push_back(gcm_params.world.split(
+            member ? 0 : MPI_UNDEFINED,
+            am_i_root() ? 0 : 1));
+    }
+    if (distribute_sheets) printf("GCMCoupler::init_sheet_roots(): distribute_sheets, sheet_roots[0]=%d\n",
+        nsheet > 0 ? sheet_roots[0] : -1);
+}
+
 
 
 void GCMCoupler::model_start(
@@ -206,8 +272,9 @@ printf("BEGIN ncwrite_dense_VectorMultivec(nnz=%ld)\n", vecs->index.size());
 
     // im,jm,ihc  0-based
     long nE = indexing->extent();
+    unsigned int nvar = vecs->nvar;
     blitz::Array<double,1> scaleE(nE);
-    blitz::Array<double,1> denseE(nE);    // All dims
+    blitz::Array<double,2> denseE(nvar, nE);    // All dims
 
     // NetCDF needs dimensions in stride-descending order
     std::vector<size_t> startp;
@@ -220,18 +287,18 @@ printf("BEGIN ncwrite_dense_VectorMultivec(nnz=%ld)\n", vecs->index.size());
     }
 
     vecs->to_dense_scale(scaleE);
+    vecs->to_dense_all(scaleE, nan, denseE);
 
     // Go through each variable...
-    unsigned int nvar = vecs->nvar;
     for (unsigned int ivar=0; ivar < nvar; ++ivar) {
-        vecs->to_dense(ivar, scaleE, nan, denseE);
+        blitz::Array<double,1> denseE_i(denseE(ivar, blitz::Range::all()));
 
         // Convert to NC units for output file
-        denseE *= (*contract)[ivar].nc_factor(*ut_system);
+        denseE_i *= (*contract)[ivar].nc_factor(*ut_system);
 
         // Store in the netCDF variable
         NcVar ncvar(nc->getVar(vname_base + (*contract)[ivar].name));
-        ncvar.putVar(startp, countp, denseE.data());
+        ncvar.putVar(startp, countp, denseE_i.data());
     }
 
 printf("END ncwrite_dense_VectorMultivec()\n");
@@ -398,6 +465,95 @@ printf("END GCMCoupler::ncio_gcm_output(%s)\n", vname_base.c_str());
 }
 // ------------------------------------------------------------
 // ------------------------------------------------------------
+/** Converts the indices of an Eigen sparse matrix through the
+dense->sparse maps of its dimensions, rewriting the compressed index
+arrays directly (no triplets).  Outer vectors, and entries within each
+one, are only re-sorted if the respective map is not monotone.
+@param transforms Each must be ID or TO_SPARSE
+@return The remapped matrix, of shape extent */
+template<class DimsT>
+static std::unique_ptr<EigenSparseMatrixT> remap_eigen(
+    EigenSparseMatrixT const &_M,
+    std::array<SparsifyTransform,2> const &transforms,
+    DimsT const &dims,            // Dense->sparse map for each dimension
+    std::array<int,2> const &extent)
+{
+    typedef typename std::decay<decltype(*_M.innerIndexPtr())>::type StorageIndexT;
+
+    // Read compressed arrays (copy only if not already compressed)
+    std::unique_ptr<EigenSparseMatrixT> Mc;
+    EigenSparseMatrixT const *M = &_M;
+    if (!M->isCompressed()) {
+        Mc.reset(new EigenSparseMatrixT(_M));
+        Mc->makeCompressed();
+        M = &*Mc;
+    }
+
+    int const odim = (EigenSparseMatrixT::IsRowMajor ? 0 : 1);
+    int const idim = 1 - odim;
+
+    // Maps for each dimension, in dense indexing
+    auto make_map = [&](int dim, long n, bool &monotone) {
+        std::vector<StorageIndexT> map(n);
+        monotone = true;
+        for (long i=0; i<n; ++i) {
+            long const j = (transforms[dim] == SparsifyTransform::ID ? i : dims[dim]->to_sparse(i));
+            if (j >= extent[dim]) (*icebin_error)(-1,
+                "Index %ld out of range [0,%d) in dimension %d", j, extent[dim], dim);
+            map[i] = j;
+            if (i > 0 && map[i] <= map[i-1]) monotone = false;
+        }
+        return map;
+    };
+    bool omono, imono;
+    std::vector<StorageIndexT> const omap(make_map(odim, M->outerSize(), omono));
+    std::vector<StorageIndexT> const imap(make_map(idim, M->innerSize(), imono));
+
+    StorageIndexT const *outer0 = M->outerIndexPtr();
+    StorageIndexT const *inner0 = M->innerIndexPtr();
+    double const *val0 = M->valuePtr();
+
+    std::unique_ptr<EigenSparseMatrixT> R(new EigenSparseMatrixT(extent[0], extent[1]));
+    R->resizeNonZeros(M->nonZeros());
+    StorageIndexT *outer = R->outerIndexPtr();
+    StorageIndexT *inner = R->innerIndexPtr();
+    double *val = R->valuePtr();
+
+    // New outer index: each outer vector keeps its size
+    long const nouter = R->outerSize();
+    std::fill(outer, outer+nouter+1, 0);
+    for (long d=0; d<M->outerSize(); ++d) outer[omap[d]+1] = outer0[d+1] - outer0[d];
+    for (long s=0; s<nouter; ++s) outer[s+1] += outer[s];
+
+    // Move each outer vector to its new place
+    // (when omono, this is a straight copy of the data arrays)
+    std::vector<std::pair<StorageIndexT,double>> block;
+    for (long d=0; d<M->outerSize(); ++d) {
+        StorageIndexT const b0 = outer0[d];
+        StorageIndexT const n = outer0[d+1] - b0;
+        StorageIndexT const b = outer[omap[d]];
+        if (imono) {
+            for (StorageIndexT k=0; k<n; ++k) {
+                inner[b+k] = imap[inner0[b0+k]];
+                val[b+k] = val0[b0+k];
+            }
+        } else {
+            block.clear();
+            for (StorageIndexT k=0; k<n; ++k)
+                block.push_back(std::make_pair(imap[inner0[b0+k]], val0[b0+k]));
+            std::sort(block.begin(), block.end(),
+                [](std::pair<StorageIndexT,double> const &x, std::pair<StorageIndexT,double> const &y)
+                { return x.first < y.first; });
+            for (StorageIndexT k=0; k<n; ++k) {
+                inner[b+k] = block[k].first;
+                val[b+k] = block[k].second;
+            }
+        }
+    }
+
+    return R;
+}
+
 // TODO: Add to ibmisc linear/eigen.hpp
 /** Converts a linear::Weighted_Eigen to sparse indexing
 @param dims set to E.dims to sparsify all dimensions; or set one to nullptr if no sparsify needed there. */
@@ -412,7 +568,12 @@ std::unique_ptr<linear::Weighted_Eigen> sparsify(
         new linear::Weighted_Eigen(E.dims, E.conservative));
 
     // Sparsify the matrix
-    {
+    bool const direct =
+        (transforms[0] == SparsifyTransform::ID || transforms[0] == SparsifyTransform::TO_SPARSE) &&
+        (transforms[1] == SparsifyTransform::ID || transforms[1] == SparsifyTransform::TO_SPARSE);
+    if (direct) {
+        S->M = remap_eigen(*E.M, transforms, E.dims, extent);
+    } else {
         TupleListT<2> SM_t;    // Matrix in sparse indexing, tuples
         spcopy(
             accum::sparsify(transforms, accum::in_index_type<int>(), E.dims,
@@ -458,6 +619,8 @@ bool run_ice)    // if false, only initialize
     timespan = std::array<double,2>{timespan[1], time_s};
 
 printf("BEGIN GCMCoupler::couple(time_s=%g, run_ice=%d)\n", time_s, run_ice);
+    if (distribute_sheets) return couple_distributed(time_s, gcm_ovalsE, run_ice);
+
     // ------------------------ Most MPI Nodes
     if (!gcm_params.am_i_root()) {
         GCMInput out({0,0,0,0});
@@ -507,6 +670,7 @@ printf("AA2\n");
 
         // --------- Compute E1vE0
         if (run_ice) {
+            profile::Timer timer("E1vE0c");
             out.E1vE0c = e1ve0::compute_E1vE0c(
                 XuE1s, XuE0s,
                 gcm_regridder->nE(), areaX);
@@ -518,6 +682,86 @@ printf("AA2\n");
 
 }
 // ------------------------------------------------------------
+GCMInput GCMCoupler::couple_distributed(
+double time_s,        // Simulation time [s]
+VectorMultivec const &gcm_ovalsE,
+bool run_ice)    // if false, only initialize
+{
+    // gcm_ovalsE is only complete on gcm_root if logging
+    if (gcm_params.am_i_root() && gcm_params.icebin_logging) {
+        std::string fname = "gcm-out-" + this->sdate(time_s) + ".nc";
+        NcIO ncio(fname, 'w');
+        ncio_gcm_output(ncio, gcm_ovalsE, timespan,
+            time_unit, "");
+        ncio();
+    }
+
+    // ---------- Initialize output: A,E,Atopo,Etopo
+    std::vector<int> nvars;
+    for (auto &gcmi : gcm_inputs) nvars.push_back(gcmi.size());
+    GCMInput out(nvars);
+
+    // ---------- Run all the ice models (collective over gcm_comm)
+    // Done first, so the sheet roots can regrid concurrently below.
+    for (size_t sheetix=0; sheetix < ice_couplers.size(); ++sheetix) {
+        ice_couplers[sheetix]->run_icemodel(timespan, gcm_ovalsE, run_ice);
+    }
+
+    // ---------- Regrid the ice sheets this rank is responsible for
+    XuE0s.resize(ice_couplers.size());
+    for (size_t sheetix=0; sheetix < ice_couplers.size(); ++sheetix) {
+        if (!am_i_sheet_root(sheetix)) continue;
+
+        auto &ice_coupler(ice_couplers[sheetix]);    // IceCoupler
+        IceRegridder const *ice_regridder = ice_coupler->ice_regridder;
+
+        IceCoupler::CoupleOut iout(ice_coupler->regrid_ice_ovalsI(
+            timespan, out.gcm_ivalss_s));
+        ice_coupler->write_regrids(time_s);
+        std::unique_ptr<linear::Weighted_Eigen> XuE1(sparsify(*iout.XuE,
+            std::array<SparsifyTransform,2>{
+                SparsifyTransform::ID,
+                SparsifyTransform::TO_SPARSE},
+            std::array<int,2>{ice_regridder->nX(), -1}));
+
+        // --------- This sheet's (unscaled) part of E1vE0
+        if (run_ice) {
+            profile::Timer timer("E1vE0c");
+            long const nE = gcm_regridder->nE();
+            out.E1vE0c.set_shape(std::array<long,2>{nE, nE});
+            e1ve0::add_E1vE0c_unscaled(out.E1vE0c, out.wE1,
+                *XuE1, *XuE0s[sheetix]);
+        }
+        XuE0s[sheetix] = std::move(XuE1);    // save state between timesteps
+    }
+
+    return out;
+}
+// ------------------------------------------------------------
+GCMInput merge_by_domain(std::vector<GCMInput> const &ins)
+{
+    GCMInput out(ins[0].nvar());
+
+    for (int iAE=0; iAE != (int)IndexAE::COUNT; ++iAE) {
+        std::vector<VectorMultivec> pieces;
+        for (auto &in : ins) pieces.push_back(in.gcm_ivalss_s[iAE]);
+        out.gcm_ivalss_s[iAE] = concatenate(pieces);
+    }
+
+    // (E1vE0 is not set the first time around; in that case, shape = (-1,-1)
+    for (auto &in : ins) {
+        if (in.E1vE0c.shape()[0] == -1) continue;
+        out.E1vE0c.set_shape(in.E1vE0c.shape());
+        for (auto &tp : in.E1vE0c.tuples) out.E1vE0c.add(tp.index(), tp.value());
+        for (auto &tp : in.wE1.tuples) out.wE1.add(tp.index(), tp.value());
+    }
+    if (out.E1vE0c.shape()[0] != -1) {
+        e1ve0::scale_E1vE0c(out.E1vE0c, out.wE1);
+        out.wE1.clear();
+    }
+
+    return out;
+}
 // ======================================================================
 
 }       // namespace
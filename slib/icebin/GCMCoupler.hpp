@@ -66,6 +66,14 @@ struct GCMInput {
     // NOTE: Actual regrid matrix = I + E1vE0c
     spsparse::TupleList<int,double,2> E1vE0c;
 
+    /** Only used when GCMCoupler::distribute_sheets: E1vE0c is kept
+    UNSCALED while partial outputs travel between MPI ranks, and wE1
+    holds the weights needed to scale it (see e1ve0::scale_E1vE0c()) */
+    spsparse::TupleList<int,double,1> wE1;
+
+    // Needed by boost::mpi::all_to_all() and gather()
+    GCMInput() {}
+
     /** @param nvar Array specifying number of variables for each segment (A,E,ATOPO,ETOPO). */
     GCMInput(std::vector<int> const &nvar);
     /** @return Number of variables for each segment. */
@@ -74,6 +82,7 @@ struct GCMInput {
     void clear() {
         gcm_ivalss_s.clear();
         E1vE0c.clear();
+        wE1.clear();
     }
 
     template<class ArchiveT>
@@ -81,8 +90,16 @@ struct GCMInput {
     {
         ar & gcm_ivalss_s;
         ar & E1vE0c;
+        ar & wE1;
     }
 };
+/** Merges the pieces of one MPI domain's output, as produced on many
+ranks by GCMCoupler::couple() with distribute_sheets (the reverse of
+split_by_domain() in GCMCoupler_ModelE).  Concatenates gcm_ivalss_s,
+and scales the (unscaled) E1vE0c by the merged wE1.
+@return wE1 is empty; E1vE0c is scaled, with shape (-1,-1) if no
+    piece had one. */
+extern GCMInput merge_by_domain(std::vector<GCMInput> const &ins);
 // =============================================================================
 /** A segment of elevation classes (see add_fhc.py) */
 struct HCSegmentData {
@@ -211,6 +228,35 @@ public:
     /** XuE matrices from last timestep, used to compute E1vE0 */
     std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> XuE0s;
 
+    /** (OPTIONAL) If set, regrid each ice sheet on its own MPI rank
+    (sheet_roots), rather than all of them on gcm_root.  Outputs are
+    then assembled per MPI domain, without passing through gcm_root. */
+    bool distribute_sheets = false;
+
+    /** MPI rank (in gcm_comm) that regrids each ice sheet.  All
+    gcm_root unless distribute_sheets. */
+    std::vector<int> sheet_roots;
+
+    /** Per ice sheet: communicator joining gcm_root (the ice model's
+    root, rank 0) and sheet_roots[sheetix] (rank 1).  Only valid on
+    those two ranks, and only if they are different. */
+    std::vector<boost::mpi::communicator> sheet_comms;
+
+    /** (OPTIONAL) Lagged coupling, in coupling timesteps (0 or 1).
+    If 1, each ice sheet's output from the previous coupling timestep
+    is regridded (on a separate thread) while the ice model runs the
+    current one; and the GCM receives ice outputs one coupling
+    timestep late. */
+    int coupling_lag = 0;
+
+    bool am_i_sheet_root(size_t sheetix) const
+        { return gcm_params.gcm_rank == sheet_roots[sheetix]; }
+
+    /** Sets sheet_roots and sheet_comms from distribute_sheets, for
+    the ice sheets in gcm_regridder.  Collective over gcm_comm.
+    Called from ncread(). */
+    void init_sheet_roots();
+
     // Fields we read from the config file...
 
     GCMCoupler(Type _type, GCMParams &&_params);
@@ -236,6 +282,16 @@ public:
         bool run_ice);    // if false, only initialize
 
 protected:
+    /** couple() when distribute_sheets is set.  All ice models are
+    run first, then each sheet is regridded on its sheet root.
+    @param gcm_ovalsE Must be complete on each sheet root.
+    @return This rank's part of the output; E1vE0c is UNSCALED
+        (see GCMInput::wE1) */
+    GCMInput couple_distributed(
+        double time_s,
+        VectorMultivec const &gcm_ovalsE,
+        bool run_ice);
+
     virtual void _ncread(
         ibmisc::NcIO &ncio_config,
         std::string const &vname);
@@ -20,6 +20,7 @@
 #include <spsparse/netcdf.hpp>
 #include <icebin/GCMRegridder.hpp>
 #include <icebin/Grid.hpp>
+#include <icebin/snapshot.hpp>
 
 using namespace std;
 using namespace netCDF;
@@ -101,7 +102,7 @@ void GCMRegridder_Standard::clear()
     ice_regridders().clear();
 }
 // -------------------------------------------------------------
-void GCMRegridder_Standard::ncio(NcIO &ncio, std::string const &vname)
+void GCMRegridder_Standard::ncio_snapshot(NcIO &ncio, std::string const &vname, SnapshotIO *snap)
 {
     auto info_v = get_or_add_var(ncio, vname + ".info", "int", {});
 
@@ -115,8 +116,11 @@ void GCMRegridder_Standard::ncio(NcIO &ncio, std::string const &vname)
         agridA = &*mem_agridA;
     }
 
+    // Arrays read from the snapshot point into its mapping
+    if (snap && snap->rw == 'r') snapshot_mem = snap->mem();
+
     // Read/Write gridA and other global stuff
-    agridA->ncio(ncio, vname + ".agridA");
+    agridA->ncio(ncio, vname + ".agridA", snap);
     indexingHC.ncio(ncio, vname + ".indexingHC");
     indexingE.ncio(ncio, vname + ".indexingE");
     ncio_vector(ncio, _hcdefs, true, vname + ".hcdefs", "double",
@@ -141,13 +145,23 @@ void GCMRegridder_Standard::ncio(NcIO &ncio, std::string const &vname)
         }
     }
     for (auto ice_regridder=ice_regridders().begin(); ice_regridder != ice_regridders().end(); ++ice_regridder) {
-        (*ice_regridder)->ncio(ncio, vname + "." + (*ice_regridder)->name());
+        (*ice_regridder)->ncio(ncio, vname + "." + (*ice_regridder)->name(), snap);
     }
 
 
     indexingE = derive_indexingE(agridA->indexing, indexingHC);
 
 }
+
+void GCMRegridder_Standard::snapshot(SnapshotIO &snap, std::string const &vname)
+{
+    if (snap.rw == 'r') snapshot_mem = snap.mem();
+
+    agridA->snapshot(snap, vname + ".agridA");
+    for (auto ice_regridder=ice_regridders().begin(); ice_regridder != ice_regridders().end(); ++ice_regridder) {
+        (*ice_regridder)->snapshot(snap, vname + "." + (*ice_regridder)->name());
+    }
+}
 // -------------------------------------------------------------
 
 
@@ -29,6 +29,7 @@
 #include <ibmisc/linear/tuple.hpp>
 
 #include <icebin/IceRegridder.hpp>
+#include <icebin/mapped_file.hpp>
 #include <icebin/RegridMatrices.hpp>
 #include <icebin/RegridMatrices_Dynamic.hpp>
 
@@ -326,6 +327,10 @@ class GCMRegridder_Standard : public GCMRegridder
 
 public:
 
+    /** Keeps a snapshot mapping alive while agridA and the ice
+        regridders' arrays point into it (see ncio(..., snap)) */
+    std::shared_ptr<MappedFile> snapshot_mem;
+
     /** Constructs a blank GCMRegridder.  Typically one will use
         ncio() afterwards to read from a file. */
     GCMRegridder_Standard();
@@ -378,6 +383,17 @@ public:
         blitz::Array<double,1> const &elevmaskI,
         RegridParams const &params) const;
 
+    /** Same, but the Ur matrices only visit exchange grid cells that
+    overlap the ice grid cells cellsI (sparse indexing), which is much
+    cheaper when there are few of them.  elevmaskI should be masked
+    out (NaN) outside of cellsI, to give consistent results.
+    @param cellsI If nullptr, visit all cells. */
+    std::unique_ptr<RegridMatrices_Dynamic> regrid_matrices(
+        int sheet_index,
+        blitz::Array<double,1> const &elevmaskI,
+        std::vector<long> const *cellsI,
+        RegridParams const &params = RegridParams()) const;
+
     /** Removes unnecessary cells from the A grid
     @param keepA(iA):
         Function returns true for cells we wish to keep. */
@@ -394,7 +410,17 @@ public:
     > const_iterator;
 
     // -----------------------------------------
-    void ncio(ibmisc::NcIO &ncio, std::string const &vname);
+    void ncio(ibmisc::NcIO &ncio, std::string const &vname)
+        { ncio_snapshot(ncio, vname, nullptr); }
+
+    /** Like ncio(), but bulk arrays (grid dims, cell areas, exchange
+    grids) are read from / written to snap instead of the NetCDF file.
+    On read, they point into snap's mapping. */
+    void ncio_snapshot(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap);
+
+    /** Writes (or reads) just the bulk arrays; used to create a snapshot
+    from a GCMRegridder already loaded with ncio(). */
+    void snapshot(SnapshotIO &snap, std::string const &vname);
 
 };  // class GCMRegridder_Standard
 // ===========================================================
@@ -110,10 +110,55 @@ Grid::Grid(
 : name(_name), spec(std::move(_spec)),
 coordinates(_coordinates), sproj(_sproj), parameterization(_parameterization),
 indexing(std::move(_indexing)), vertices(std::move(_vertices)), cells(std::move(_cells))
-{}
+{
+    vertices.finalize();
+    cells.finalize();
+}
+
+
+
+
+// ------------------------------------------------------------
+const size_t VertexRefPool::block_size;
+
+Vertex **VertexRefPool::alloc(size_t n)
+{
+    if (nused + n > nlast) {
+        nlast = std::max(block_size, n);
+        blocks.push_back(std::unique_ptr<Vertex *[]>(new Vertex *[nlast]));
+        nused = 0;
+        _capacity += nlast;
+    }
+    Vertex **ret = &blocks.back()[nused];
+    nused += n;
+    return ret;
+}
 
+void VertexRefPool::clear()
+{
+    blocks.clear();
+    nlast = 0;
+    nused = 0;
+    _capacity = 0;
+}
 
+void pack_vertices(Cell &cell, VertexRefPool &pool,
+    VertexRemap const *remap)
+{
+    size_t const n = cell.size();
+    if (n == 0) return;
+    Vertex **vpacked = pool.alloc(n);
+    if (remap) {
+        for (size_t i=0; i<n; ++i) vpacked[i] = remap->at(cell.vbegin()[i]);
+    } else {
+        std::copy(cell.vbegin(), cell.vbegin() + n, vpacked);
+    }
 
+    cell._vertices = std::vector<Vertex *>();    // Free memory
+    cell._vpacked = vpacked;
+    cell._npacked = n;
+}
+// ------------------------------------------------------------
 
 size_t Grid::ndata() const
 {
@@ -352,6 +397,7 @@ std::string const &vname)
             // Add the cell to the grid
             cells.add(std::move(cell));
         }
+        cells.finalize();
     }
 }
 
@@ -528,6 +574,18 @@ printf("BEGIN filter_cells(%s) %p\n", name.c_str(), this);
         }
     }
 
+    // Reclaim memory of erased items.  Vertices move; so re-point
+    // the cells' vertex lists to the new ones.
+    std::vector<Vertex const *> old_vertices;
+    old_vertices.reserve(vertices.nrealized());
+    for (auto &vertex : vertices) old_vertices.push_back(&vertex);
+    vertices.compact();
+    VertexRemap remap;
+    remap.reserve(old_vertices.size());
+    auto old_vertex(old_vertices.begin());
+    for (auto &vertex : vertices) remap[*old_vertex++] = &vertex;
+    cells.compact(&remap);
+
     printf("END filter_cells(%s) %p\n", name.c_str(), this);
 }
 // ---------------------------------------------------------
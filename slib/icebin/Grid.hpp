@@ -19,6 +19,10 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <memory>
+#include <algorithm>
+#include <iterator>
 #include <unordered_map>
 #include <functional>
 
@@ -60,6 +64,38 @@ struct Vertex : public Point {
         { return index < rhs.index; }
 };
 
+// ----------------------------------------------------
+
+/** Storage for the vertex lists of the Cells in a GridMap<Cell>, in
+CSR style: the vertices of each cell are contiguous.  Storage is
+allocated in large blocks, which are never moved. */
+class VertexRefPool {
+    static const size_t block_size = 1 << 16;
+    std::vector<std::unique_ptr<Vertex *[]>> blocks;
+    size_t nlast = 0;    // Size of last block
+    size_t nused = 0;    // Number used in last block
+    size_t _capacity = 0;
+
+public:
+    /** Allocates space for n vertex references */
+    Vertex **alloc(size_t n);
+
+    void clear();
+
+    size_t capacity() const { return _capacity; }
+};
+
+/** Maps old to new vertex addresses, when vertices are moved */
+typedef std::unordered_map<Vertex const *, Vertex *> VertexRemap;
+
+/** Moves a Cell's vertex list into a GridMap's VertexRefPool.
+(Nothing to do for Vertex).
+@param remap If set, also re-points the vertex list through it. */
+inline void pack_vertices(Vertex &vertex, VertexRefPool &pool,
+    VertexRemap const *remap = nullptr) {}
+void pack_vertices(Cell &cell, VertexRefPool &pool,
+    VertexRemap const *remap = nullptr);
+
 // ----------------------------------------------------
 /** Iterate through with:
 <pre>Cell cell;
@@ -68,8 +104,29 @@ for (auto ii=cell.begin(); ii != cell.end(); ++ii) {
 }</pre>
 */
 class Cell {
+    friend void pack_vertices(Cell &cell, VertexRefPool &pool,
+        VertexRemap const *remap);
+
     std::vector<Vertex *> _vertices;
 
+    /** Set once the Cell has been added to a GridMap: the vertex list
+    is then stored in the GridMap's VertexRefPool, and _vertices is
+    empty. */
+    Vertex **_vpacked = nullptr;
+    int _npacked = 0;
+
+    Vertex * const *vbegin() const
+        { return _vpacked ? _vpacked : _vertices.data(); }
+
+    /** Moves the vertex list back into _vertices, so it may be changed. */
+    void unpack()
+    {
+        if (!_vpacked) return;
+        _vertices.assign(_vpacked, _vpacked + _npacked);
+        _vpacked = nullptr;
+        _npacked = 0;
+    }
+
 public:
 
     /** For L0 formulations (constant value per grid cell):
@@ -98,26 +155,26 @@ public:
     For grids with 2-D indexing, tells the i and j index of the cell (0-based). */
     int i, j, k;
 
-    size_t size() const { return _vertices.size(); }
+    size_t size() const { return _vpacked ? _npacked : _vertices.size(); }
 
-    typedef ibmisc::DerefRandomAccessIter<Vertex, std::vector<Vertex *>::iterator> iterator;
-    typedef ibmisc::DerefRandomAccessIter<const Vertex, std::vector<Vertex *>::const_iterator> const_iterator;
+    typedef ibmisc::DerefRandomAccessIter<Vertex, Vertex * const *> iterator;
+    typedef ibmisc::DerefRandomAccessIter<const Vertex, Vertex * const *> const_iterator;
 
     iterator begin(int ix = 0)
-        { return iterator(_vertices.begin() + ix); }
+        { return iterator(vbegin() + ix); }
     iterator end(int ix = 0)
-        { return iterator(_vertices.end() + ix); }
+        { return iterator(vbegin() + size() + ix); }
     const_iterator cbegin(int ix = 0) const
-        { return const_iterator(_vertices.cbegin() + ix); }
+        { return const_iterator(vbegin() + ix); }
     const_iterator cend(int ix = 0) const
-        { return const_iterator(_vertices.cend() + ix); }
+        { return const_iterator(vbegin() + size() + ix); }
     const_iterator begin(int ix = 0) const
-        { return const_iterator(_vertices.cbegin() + ix); }
+        { return const_iterator(vbegin() + ix); }
     const_iterator end(int ix = 0) const
-        { return const_iterator(_vertices.cend() + ix); }
+        { return const_iterator(vbegin() + size() + ix); }
 
-    void reserve(size_t n) { _vertices.reserve(n); }
-    void add_vertex(Vertex *vertex) { _vertices.push_back(vertex); }
+    void reserve(size_t n) { unpack(); _vertices.reserve(n); }
+    void add_vertex(Vertex *vertex) { unpack(); _vertices.push_back(vertex); }
 
     double proj_area(ibmisc::Proj_LL2XY const *proj) const;   // OPTIONAL
 
@@ -128,16 +185,40 @@ class Grid;
 
 class GridGen {};  // Tagging class
 
-/** Specialized dict-like structure used for cells and vertices in a grid. */
+/** Specialized dict-like structure used for cells and vertices in a grid.
+
+Items are stored by value in an arena (std::deque), so they are
+contiguous in memory and never move once added; vertex lists of Cells
+are packed into a VertexRefPool.  Items are looked up by index through
+a vector, sorted on the first lookup after any out-of-order add().
+Erased items are only marked as such; their memory is reclaimed by
+compact(), or when the GridMap is cleared or destroyed. */
 template<class CellT>
 class GridMap {
     friend class Grid;
 protected:
-    typedef std::unordered_map<long, std::unique_ptr<CellT>> MapT;
-    MapT _cells;
+    std::deque<CellT> _arena;
+    std::vector<char> _live;    // _live[i] is set unless _arena[i] was erased
+    // (cell.index, i in _arena); sorted unless !_index_sorted
+    mutable std::vector<std::pair<long,size_t>> _index;
+    mutable bool _index_sorted = true;
+    VertexRefPool _vpool;
+    size_t _nlive = 0;
+
     long _nfull = -1;
     long _max_realized_index = -1;
 
+    struct CmpIndex {
+        bool operator()(std::pair<long,size_t> const &a, long b) const
+            { return a.first < b; }
+    };
+
+    /** @return Position of index in _arena; or -1 if not there */
+    long find(long index) const;
+
+    /** Sorts _index (if needed), dropping erased items */
+    void sort_index() const;
+
 public:
     GridMap(long nfull) : _nfull(nfull) {}
     GridMap() : _nfull(-1) {}
@@ -154,31 +235,61 @@ public:
 
 public:
 
-    typedef ibmisc::DerefSecondIter<long, CellT, typename MapT::iterator> iterator;
-    typedef ibmisc::DerefSecondIter<long, const CellT, typename MapT::const_iterator> const_iterator;
+    /** Iterates through (non-erased) items, in the order they were added. */
+    template<class ValT, class GridMapT>
+    class iterator_base : public std::iterator<std::forward_iterator_tag, ValT> {
+        friend class GridMap;
+        GridMapT *gmap;
+        size_t ix;    // Position in gmap->_arena
+
+        void skip_dead()
+        {
+            while (ix < gmap->_arena.size() && !gmap->_live[ix]) ++ix;
+        }
+    public:
+        iterator_base(GridMapT *_gmap, size_t _ix) : gmap(_gmap), ix(_ix)
+            { skip_dead(); }
+
+        ValT &operator*() const { return gmap->_arena[ix]; }
+        ValT *operator->() const { return &gmap->_arena[ix]; }
+
+        iterator_base &operator++()
+        {
+            ++ix;
+            skip_dead();
+            return *this;
+        }
+
+        bool operator==(iterator_base const &other) const
+            { return ix == other.ix; }
+        bool operator!=(iterator_base const &other) const
+            { return ix != other.ix; }
+    };
+
+    typedef iterator_base<CellT, GridMap<CellT>> iterator;
+    typedef iterator_base<const CellT, const GridMap<CellT>> const_iterator;
 
 
     iterator begin()
-        { return iterator(_cells.begin()); }
+        { return iterator(this, 0); }
     iterator end()
-        { return iterator(_cells.end()); }
+        { return iterator(this, _arena.size()); }
     const_iterator cbegin() const
-        { return const_iterator(_cells.cbegin()); }
+        { return const_iterator(this, 0); }
     const_iterator cend() const
-        { return const_iterator(_cells.cend()); }
+        { return const_iterator(this, _arena.size()); }
     const_iterator begin() const
-        { return const_iterator(_cells.cbegin()); }
+        { return cbegin(); }
     const_iterator end() const
-        { return const_iterator(_cells.cend()); }
+        { return cend(); }
 
-    iterator erase(iterator const &ii)
-        { return iterator(_cells.erase(ii.wrapped)); }
+    iterator erase(iterator const &ii);
 
-    void clear() { _cells.clear(); }
+    void clear();
 
-    CellT *at(long index) { return &*_cells.at(index); }
-    CellT const *at(long index) const { return &*_cells.at(index); }
-    size_t nrealized() const { return _cells.size(); }
+    CellT *at(long index);
+    CellT const *at(long index) const;
+    size_t nrealized() const { return _nlive; }
     size_t nfull() const { return _nfull >=0 ? _nfull : _max_realized_index+1; }
 
     /** Adds a cell and owns it. */
@@ -189,6 +300,19 @@ public:
     This is for use with Cython, which doesn't like RValue references. */
     CellT *add_claim(CellT *cell);
 
+    /** Sorts the index after out-of-order add()s, and checks for
+    repeated indices.  Otherwise done on the first lookup; so call
+    this before sharing the GridMap between threads. */
+    void finalize() const { sort_index(); }
+
+    /** Moves the non-erased items into new storage, reclaiming the
+    memory of erased items.  Invalidates pointers to items.
+    @param remap Re-points Cells' vertex lists through this. */
+    void compact(VertexRemap const *remap = nullptr);
+
+    /** Approximate memory used by this GridMap (bytes) */
+    size_t memory_bytes() const;
+
 private :
     struct CmpPointers {
         bool operator()(CellT const *a, CellT const *b) { return *a < *b; }
@@ -205,31 +329,88 @@ template<class CellT>
 std::vector<CellT const *> GridMap<CellT>::sorted() const
 {
     // Make a vector of pointers
+    // (_index is sorted by index)
+    sort_index();
     std::vector<CellT const *> ret;
-    for (auto ii = begin(); ii != end(); ++ii) ret.push_back(&*ii);
-
-    // Sort the vector      
-    std::sort(ret.begin(), ret.end(), CmpPointers());
+    ret.reserve(_nlive);
+    for (auto ii = _index.begin(); ii != _index.end(); ++ii) {
+        if (_live[ii->second]) ret.push_back(&_arena[ii->second]);
+    }
 
     return ret;
 }   
 
+template<class CellT>
+void GridMap<CellT>::sort_index() const
+{
+    if (_index_sorted) return;
+
+    // Sorts by index, then by position in _arena
+    std::sort(_index.begin(), _index.end());
+    size_t j = 0;
+    for (auto &ii : _index) {
+        if (!_live[ii.second]) continue;
+        if (j > 0 && _index[j-1].first == ii.first) (*icebin_error)(-1,
+            "Error adding repeat cell/vertex index=%ld.  "
+            "Cells and Vertices must have unique indices.", ii.first);
+        _index[j++] = ii;
+    }
+    _index.resize(j);
+    _index_sorted = true;
+}
+
+template<class CellT>
+long GridMap<CellT>::find(long index) const
+{
+    sort_index();
+    auto ii(std::lower_bound(_index.begin(), _index.end(), index, CmpIndex()));
+    if (ii == _index.end() || ii->first != index || !_live[ii->second]) return -1;
+    return ii->second;
+}
+
+template<class CellT>
+CellT *GridMap<CellT>::at(long index)
+{
+    long ix = find(index);
+    if (ix < 0) (*icebin_error)(-1,
+        "No cell/vertex with index=%ld", index);
+    return &_arena[ix];
+}
+
+template<class CellT>
+CellT const *GridMap<CellT>::at(long index) const
+{
+    long ix = find(index);
+    if (ix < 0) (*icebin_error)(-1,
+        "No cell/vertex with index=%ld", index);
+    return &_arena[ix];
+}
+
 template<class CellT>
 CellT *GridMap<CellT>::add(CellT &&cell)
 {
     // If we never specify our indices, things will "just work"
-    if (cell.index < 0) cell.index = _cells.size();
+    if (cell.index < 0) cell.index = _nlive;
+
+    // Usually cells are added in order, and _index stays sorted.
+    // Otherwise, sort it once on the next lookup (or finalize()).
+    if (!_index.empty() && _index.back().first >= cell.index) {
+        auto const &back(_index.back());
+        if (back.first == cell.index && _live[back.second]) (*icebin_error)(-1,
+            "Error adding repeat cell/vertex index=%ld.  "
+            "Cells and Vertices must have unique indices.", cell.index);
+        _index_sorted = false;
+    }
     _max_realized_index = std::max(_max_realized_index, cell.index);
 
-    std::unique_ptr<CellT> ptr(new CellT(std::move(cell)));
-    auto ret = _cells.insert(std::make_pair(cell.index, std::move(ptr)));
-    CellT *valp = ret.first->second.get();
-    bool inserted = ret.second;
+    size_t const ix = _arena.size();
+    _arena.push_back(std::move(cell));
+    _live.push_back(1);
+    ++_nlive;
+    CellT *valp = &_arena.back();
+    pack_vertices(*valp, _vpool);
 
-    if (!inserted) {        // Key already existed
-        (*icebin_error)(-1, "Error adding repeat cell/vertex index=%d.  "
-            "Cells and Vertices must have unique indices.", cell.index);
-    }
+    _index.push_back(std::make_pair(valp->index, ix));
     return valp;
 }
 
@@ -241,6 +422,58 @@ CellT *GridMap<CellT>::add_claim(CellT *cell)
     return add(std::move(*pcell));
 }
 
+template<class CellT>
+typename GridMap<CellT>::iterator GridMap<CellT>::erase(iterator const &ii)
+{
+    _live[ii.ix] = 0;
+    --_nlive;
+    return iterator(this, ii.ix+1);
+}
+
+template<class CellT>
+void GridMap<CellT>::clear()
+{
+    _arena.clear();
+    _live.clear();
+    _index.clear();
+    _index_sorted = true;
+    _vpool.clear();
+    _nlive = 0;
+}
+
+template<class CellT>
+void GridMap<CellT>::compact(VertexRemap const *remap)
+{
+    // Vertex lists are copied out of the old _vpool; so keep it until done
+    std::deque<CellT> arena;
+    VertexRefPool vpool;
+    _index.clear();
+    _index.reserve(_nlive);
+    for (size_t i=0; i<_arena.size(); ++i) {
+        if (!_live[i]) continue;
+        arena.push_back(std::move(_arena[i]));
+        pack_vertices(arena.back(), vpool, remap);
+        _index.push_back(std::make_pair(arena.back().index, arena.size()-1));
+    }
+    _index.shrink_to_fit();
+    _index_sorted = false;
+
+    std::swap(_arena, arena);
+    std::swap(_vpool, vpool);
+    _live.assign(_arena.size(), 1);
+    _live.shrink_to_fit();
+    sort_index();
+}
+
+template<class CellT>
+size_t GridMap<CellT>::memory_bytes() const
+{
+    return _arena.size() * sizeof(CellT)
+        + _live.capacity()
+        + _index.capacity() * sizeof(std::pair<long,size_t>)
+        + _vpool.capacity() * sizeof(Vertex *);
+}
+
 
 
 // -------------------------------------------------------------------
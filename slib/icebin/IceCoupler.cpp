@@ -18,6 +18,9 @@
 
 #include <mpi.h>        // Intel MPI wants to be first
 #include <type_traits>
+#include <thread>
+#include <exception>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 
 #include <spsparse/blitz.hpp>
@@ -28,10 +31,14 @@
 #include <ibmisc/string.hpp>    // string_printf()
 #include <icebin/GCMCoupler.hpp>
 #include <icebin/GCMRegridder.hpp>
+#include <icebin/ElevMask.hpp>
 #include <icebin/contracts/contracts.hpp>
+#include <icebin/profile.hpp>
+#include <icebin/fused_regrid.hpp>
 #include <spsparse/eigen.hpp>
 #include <spsparse/blitz.hpp>
 
+#include <icebin/dismal/IceCoupler_DISMAL.hpp>
 #ifdef USE_PISM
 #include <icebin/pism/IceCoupler_PISM.hpp>
 #endif
@@ -58,11 +65,9 @@ std::unique_ptr<IceCoupler> new_ice_coupler(
     IceCoupler::Params params(_gcm_coupler->make_ice_coupler_params(sheet_name));
     std::unique_ptr<IceCoupler> self;
     switch(type.index()) {
-#if 0
         case IceCoupler::Type::DISMAL :
-            self.reset(new IceCoupler_DISMAL);
+            self.reset(new dismal::IceCoupler_DISMAL(params));
         break;
-#endif
 #ifdef USE_PISM
         case IceCoupler::Type::PISM :
             self.reset(new gpism::IceCoupler_PISM(params));
@@ -109,6 +114,22 @@ void IceCoupler::ncread(ibmisc::NcIO &ncio_config, std::string const &vname_shee
     // General args passed to the ice sheet, regardless of which ice model is being used
     NcVar info_var(ncio_config.nc->getVar(vname_sheet + ".info"));
     get_or_put_att<NcVar,double>(info_var, 'r', "sigma", "double", &sigma[0], 3);
+
+    // (OPTIONAL) When to dump regrid matrices for debugging
+    {auto atts(info_var.getAtts());
+        if (atts.find("regrids_dump") != atts.end())
+            get_or_put_att_enum(info_var, 'r', "regrids_dump", regrids_dump);
+        if (atts.find("regrids_every") != atts.end())
+            get_or_put_att<NcVar,int>(info_var, 'r', "regrids_every", "int", &regrids_every, 1);
+
+        // (OPTIONAL) Fraction of cells that may change before regrid_cache is recomputed
+        if (atts.find("max_patch_fraction") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "max_patch_fraction", "double", &max_patch_fraction, 1);
+    }
+    if (regrids_every < 1) (*icebin_error)(-1,
+        "regrids_every=%d must be at least 1", regrids_every);
+    if (max_patch_fraction < 0 || max_patch_fraction > 1) (*icebin_error)(-1,
+        "max_patch_fraction=%g must be in [0,1]", max_patch_fraction);
 }
 
 /** Read/write for IceBin restart file */
@@ -127,6 +148,16 @@ void IceCoupler::ncio_icebin_rsf(ibmisc::NcIO &ncio)
 
 IceCoupler::~IceCoupler() {}
 
+int IceCoupler::sheet_index() const
+    { return gcm_coupler->gcm_regridder->ice_regridders().index.at(name()); }
+
+bool IceCoupler::am_i_icemodel_root() const
+{
+    return (runs_on_sheet_root() ?
+        gcm_coupler->am_i_sheet_root(sheet_index())
+        : gcm_coupler->am_i_root());
+}
+
 // ==============================================================
 void IceCoupler::model_start(
     bool cold_start,
@@ -134,7 +165,7 @@ void IceCoupler::model_start(
     double time_start_s)
 {
     // Set up writers
-    if (gcm_coupler->am_i_root()) {
+    if (am_i_icemodel_root()) {
         for (int io=0; io<2; ++io) {    // INPUT / OUTPUT
             auto fname(
                 boost::filesystem::path(output_dir) /
@@ -207,7 +238,6 @@ double dt,
 ibmisc::TmpAlloc &tmp)
 {
 printf("BEGIN construct_ice_ivalsI(dt=%g)\n", dt);
-    auto nE0(gcm_ovalsE0.extent(0));
 
     // ------------- Form ice_ivalsI
     // Assuming column-major matrices...
@@ -220,28 +250,17 @@ printf("BEGIN construct_ice_ivalsI(dt=%g)\n", dt);
     // |k| = # variables in ice_input
     // |l| = # variables in gcm_output
 
-    auto &ice_ivalsI_e(tmp.make<EigenDenseMatrixT>());    // Memory for ice_ivalsI
-
     // Get the sparse matrix to convert GCM output variables to ice model inputs
     // This will be transposed: M(input, output).  b is a row-vector here.
     auto icei_v_gcmo_T(var_trans_inE.apply_scalars(scalars, 'T'));    // Mxb
 //  print_var_trans(icei_v_gcmo_T, var_trans_inE, 'T');
 
-    // Switch from row-major (Blitz++) to col-major (Eigen) indexing
-    Eigen::Map<EigenDenseMatrixT> const gcm_ovalsE0_e(
-        const_cast<double *>(gcm_ovalsE0.data()),
-        gcm_ovalsE0.extent(1), gcm_ovalsE0.extent(0));
-
-    // Ice inputs calculated as the result of a matrix multiplication
-    // ice_ivalsI_e is |i| x |k|
-    ice_ivalsI_e = (*IvE0) * (
-        gcm_ovalsE0_e * icei_v_gcmo_T.M + icei_v_gcmo_T.b.replicate(nE0,1) );
-
-    // Alias the Eigen matrix to blitz array
-    blitz::Array<double,2> ice_ivalsI(
-        ice_ivalsI_e.data(),
-        blitz::shape(ice_ivalsI_e.cols(), ice_ivalsI_e.rows()),
-        blitz::neverDeleteData);
+    // Ice inputs calculated as the result of a matrix multiplication,
+    // written straight into Blitz++ layout: ice_ivalsI(k, i)
+    Eigen::SparseMatrix<double, Eigen::RowMajor> const IvE0_r(*IvE0);
+    blitz::Array<double,2> ice_ivalsI(icei_v_gcmo_T.M.cols(), IvE0_r.rows());
+    fused_regrid_transform(IvE0_r, gcm_ovalsE0,
+        icei_v_gcmo_T.M, icei_v_gcmo_T.b, ice_ivalsI);
 
 printf("AA6\n");
     // Continue construction in a contract-specific manner
@@ -251,6 +270,34 @@ printf("END construct_ice_ivalsI()\n");
     return ice_ivalsI;
 }
 // -----------------------------------------------------------
+IceCoupler::RegridState IceCoupler::take_regrid_state()
+{
+    RegridState rs;
+    rs.cache = std::move(regrid_cache);
+    rs.cache_changed = regrid_cache_changed;
+    return rs;
+}
+
+void IceCoupler::put_regrid_state(RegridState &&rs)
+{
+    regrid_cache = std::move(rs.cache);
+    regrid_cache_changed = rs.cache_changed;
+    if (rs.dimE0) dimE0 = std::move(rs.dimE0);
+    if (rs.IvE0) IvE0 = std::move(rs.IvE0);
+}
+
+void IceCoupler::update_regrid_cache(
+    blitz::Array<double,1> const &emI_ice,
+    RegridState &rs)
+{
+    GCMRegridder *gcmr(&*gcm_coupler->gcm_regridder);
+    int sheet_index = gcmr->ice_regridders().index.at(name());
+
+    auto const update(RegridCache::update(rs.cache,
+        gcmr, sheet_index, emI_ice, sigma, max_patch_fraction));
+    if (update != RegridCache::Update::REUSED) rs.cache_changed = true;
+}
+// -----------------------------------------------------------
 /** 
 @param do_run True if we are to actually run (otherwise just return ice_ovalsI from current state)
 @param gcm_ivalsAE_s Contract inputs for the GCM on the A nad E grid, respectively (1D indexing).
@@ -265,11 +312,100 @@ std::vector<VectorMultivec> &gcm_ivalss_s,                // (accumulate over ma
 // ------- Flags
 bool run_ice)
 {
-    double const time_s = timespan[1];
+    int const sheet_index = this->sheet_index();
+    bool const sheet_root = gcm_coupler->am_i_sheet_root(sheet_index);
+
+    // ----------- Lagged coupling: regrid the previous ice model step
+    // (in a background thread) while the ice model runs this one.
+    // Until regrid_thread is joined:
+    //   * regrid_thread owns rs (the regrid matrices and the next
+    //     IvE0 / dimE0, moved out of *this), ice_ovalsI_lag,
+    //     gcm_ivalss_s, ret and error.
+    //   * This thread owns the rest of *this, including ice_ovalsI and
+    //     the IvE0 / dimE0 used to compute the ice model's inputs.
+    // rs is moved back into *this only after join().
+    if (gcm_coupler->coupling_lag > 0 && run_ice && sheet_root) {
+        blitz::Array<double,2> const ice_ovalsI_lag(ice_ovalsI.copy());
+        std::array<double,2> timespan_lag(timespan_ovalsI);
+        // Initial outputs (run_ice=false) cover no time; use this step's dt
+        if (timespan_lag[1] <= timespan_lag[0])
+            timespan_lag[0] = timespan_lag[1] - (timespan[1] - timespan[0]);
+
+        RegridState rs(take_regrid_state());
+        IceCoupler::CoupleOut ret;
+        std::exception_ptr error;
+        std::thread regrid_thread;
+        auto const regrid_lag([this, timespan_lag, &ice_ovalsI_lag, &gcm_ivalss_s, &rs, &ret, &error]() {
+            profile::Background background;    // Overlaps run_timestep
+            try {
+                ret = regrid_outputs(timespan_lag, ice_ovalsI_lag, gcm_ivalss_s, rs);
+            } catch(...) {
+                error = std::current_exception();
+            }
+        });
+        try {
+            run_icemodel(timespan, gcm_ovalsE_s, run_ice, [&]() {
+                regrid_thread = std::thread(regrid_lag);
+            });
+        } catch(...) {
+            if (regrid_thread.joinable()) regrid_thread.join();
+            put_regrid_state(std::move(rs));
+            throw;
+        }
+        if (regrid_thread.joinable()) regrid_thread.join();
+        put_regrid_state(std::move(rs));
+        if (error) std::rethrow_exception(error);
+
+        // NetCDF is not thread-safe; so write only once the ice model is done
+        write_regrids(timespan_lag[1]);
+
+        // The GCM sees the ice sheet we just regridded, not the new one
+        emI_ice = ice_ovalsI_lag(standard_names[OUTPUT].at("elevmask_ice"), blitz::Range::all());
+        emI_land = ice_ovalsI_lag(standard_names[OUTPUT].at("elevmask_land"), blitz::Range::all());
+        return ret;
+    }
+
+    run_icemodel(timespan, gcm_ovalsE_s, run_ice);
+
+    if (!sheet_root) return IceCoupler::CoupleOut();
+    IceCoupler::CoupleOut ret(regrid_ice_ovalsI(timespan, gcm_ivalss_s));
+    write_regrids(timespan[1]);
+    return ret;
+}
 
+IceCoupler::CoupleOut IceCoupler::regrid_ice_ovalsI(
+std::array<double,2> timespan, // {last_time_s, time_s}
+std::vector<VectorMultivec> &gcm_ivalss_s)
+{
+    RegridState rs(take_regrid_state());
     IceCoupler::CoupleOut ret;
+    try {
+        ret = regrid_outputs(timespan, ice_ovalsI, gcm_ivalss_s, rs);
+    } catch(...) {
+        put_regrid_state(std::move(rs));
+        throw;
+    }
+    put_regrid_state(std::move(rs));
+    return ret;
+}
 
-    if (!gcm_coupler->am_i_root()) {
+void IceCoupler::run_icemodel(
+std::array<double,2> timespan, // {last_time_s, time_s}
+VectorMultivec const &gcm_ovalsE_s,
+bool run_ice,
+std::function<void()> const &overlap)
+{
+    double const time_s = timespan[1];
+
+    int const sheet_index = this->sheet_index();
+    bool const icemodel_root = am_i_icemodel_root();
+    bool const sheet_root = gcm_coupler->am_i_sheet_root(sheet_index);
+    // Only valid if gcm_root and the sheet root are different ranks;
+    // not needed if the ice model runs on the sheet root.
+    boost::mpi::communicator const &sheet_comm(gcm_coupler->sheet_comms[sheet_index]);
+    bool const send_vals = sheet_comm && !runs_on_sheet_root();
+
+    if (!icemodel_root && !sheet_root) {
         printf("[noroot] BEGIN IceCoupler::couple(%s) run_ice=%d\n", name().c_str(), run_ice);
 
         // Allocate dummy variables, even though they will only be set on root
@@ -278,67 +414,85 @@ bool run_ice)
         ice_ovalsI = 0;
         run_timestep(time_s, ice_ivalsI, ice_ovalsI, run_ice);
         printf("[noroot] END IceCoupler::couple(%s)\n", name().c_str());
-        return ret;
+        return;
     }
 
     printf("BEGIN IceCoupler::couple(%s)\n", name().c_str());
 
-    // ========== Get Ice Inputs
-    // E_s = Elevation grid (sparse indices)
-    // E0 = Elevation grid @ beginning of timestep (dense indices)
-    // E1 = Elevation grid @ end of timestep (dense indices)
-    // All matrices and vectors assumed w/ densified indexing
-    // Except _s ending means they use sparse indexing.
+    // ice_ivalsI is computed on the sheet root, but the ice model
+    // reads it on its own root (gcm_root, unless runs_on_sheet_root()).
+    blitz::Array<double,2> ice_ivalsI(contract[INPUT].size(), nI());
+    ice_ivalsI = 0;
+    if (sheet_root) {
+        // ========== Get Ice Inputs
+        // E_s = Elevation grid (sparse indices)
+        // E0 = Elevation grid @ beginning of timestep (dense indices)
+        // E1 = Elevation grid @ end of timestep (dense indices)
+        // All matrices and vectors assumed w/ densified indexing
+        // Except _s ending means they use sparse indexing.
+
+        // ------------- Compute dimE transformation, if this is the first round
+        if (!run_ice) {
+            dimE0.reset(new SparseSetT);
+            for (size_t i=0; i<gcm_ovalsE_s.size(); ++i) {
+                long iE_s(gcm_ovalsE_s.index[i]);
+                dimE0->add_dense(iE_s);
+            }
+        }
 
-    // ------------- Compute dimE transformation, if this is the first round
-    if (!run_ice) {
-        dimE0.reset(new SparseSetT);
+        // ------------- Create gcm_ovalsE
+        // Densify gcm_ovalsE_s --> gcm_ovalsE
+        // This should ONLY involve iE already mentioned in IvE0;
+        // if not, ibmisc_error() will be called inside to_dense()
+        blitz::Array<double,2> gcm_ovalsE(gcm_coupler->gcm_outputsE.size(), dimE0->dense_extent());
+        {profile::Timer timer("densify");
+        gcm_ovalsE = 0;
         for (size_t i=0; i<gcm_ovalsE_s.size(); ++i) {
             long iE_s(gcm_ovalsE_s.index[i]);
-            dimE0->add_dense(iE_s);
-        }
-    }
-
-    // ------------- Create gcm_ovalsE
-    // Densify gcm_ovalsE_s --> gcm_ovalsE
-    // This should ONLY involve iE already mentioned in IvE0;
-    // if not, ibmisc_error() will be called inside to_dense()
-    blitz::Array<double,2> gcm_ovalsE(gcm_coupler->gcm_outputsE.size(), dimE0->dense_extent());
-    gcm_ovalsE = 0;
-    for (size_t i=0; i<gcm_ovalsE_s.size(); ++i) {
-        long iE_s(gcm_ovalsE_s.index[i]);
-        int iE0(dimE0->to_dense(iE_s));   // Can raise error if iE_s not found
-        for (int ivar=0; ivar<gcm_ovalsE_s.nvar; ++ivar) {
-            gcm_ovalsE(ivar, iE0) += gcm_ovalsE_s.val(ivar, i);
-        }
-    }
-
+            int iE0(dimE0->to_dense(iE_s));   // Can raise error if iE_s not found
+            for (int ivar=0; ivar<gcm_ovalsE_s.nvar; ++ivar) {
+                gcm_ovalsE(ivar, iE0) += gcm_ovalsE_s.val(ivar, i);
+            }
+        }}
 
-    // Set up scalars used to instantiate variable conversion matrices
-    // NOTE: by_dt=inf on the first call (run_ice=false)
-    //       Should be OK because output variables that depend on by_dt
-    //       are not needed on the first call.
-    double const dt = timespan[1] - timespan[0];
-    std::vector<std::pair<std::string, double>> scalars({
-        std::make_pair("by_dt", 1.0 / dt)});
 
-    {
-        TmpAlloc tmp;    // Allocate variables for the duration of this function
-        blitz::Array<double,2> ice_ivalsI(run_ice ?
-            construct_ice_ivalsI(gcm_ovalsE, scalars, dt, tmp) :
-            blitz::Array<double,2>(contract[INPUT].size(), nI()));
+        // Set up scalars used to instantiate variable conversion matrices
+        // NOTE: by_dt=inf on the first call (run_ice=false)
+        //       Should be OK because output variables that depend on by_dt
+        //       are not needed on the first call.
+        double const dt = timespan[1] - timespan[0];
+        std::vector<std::pair<std::string, double>> scalars({
+            std::make_pair("by_dt", 1.0 / dt)});
 
-        // ========= Step the ice model forward
-        if (writer[INPUT].get()) {
-            // writing icemodel-in
-            writer[INPUT]->write(time_s, ice_ivalsI);
+        if (run_ice) {
+            profile::Timer timer("construct_ice_ivalsI");
+            TmpAlloc tmp;
+            ice_ivalsI = construct_ice_ivalsI(gcm_ovalsE, scalars, dt, tmp);
         }
-        ice_ovalsI = 0;
+    }
+
+    // ========= Step the ice model forward
+    // ice_ivalsI is done with IvE0; start anything that can overlap the ice model
+    if (overlap) overlap();
+    if (send_vals) {
+        if (sheet_root) sheet_comm.send(0, 0, ice_ivalsI.data(), ice_ivalsI.size());
+        else sheet_comm.recv(1, 0, ice_ivalsI.data(), ice_ivalsI.size());
+    }
+    if (icemodel_root && writer[INPUT].get()) {
+        // writing icemodel-in
+        writer[INPUT]->write(time_s, ice_ivalsI);
+    }
+    ice_ovalsI = 0;
+    {profile::Timer timer("run_timestep");
         run_timestep(time_s, ice_ivalsI, ice_ovalsI, run_ice);
-        if (writer[OUTPUT].get()) {
-            // writing icemodel-out
-            writer[OUTPUT]->write(time_s, ice_ovalsI);
-        }
+    }
+    if (icemodel_root && writer[OUTPUT].get()) {
+        // writing icemodel-out
+        writer[OUTPUT]->write(time_s, ice_ovalsI);
+    }
+    if (send_vals) {
+        if (icemodel_root) sheet_comm.send(1, 1, ice_ovalsI.data(), ice_ovalsI.size());
+        else sheet_comm.recv(0, 1, ice_ovalsI.data(), ice_ovalsI.size());
     }
 
     // ========== Update regridding matrices
@@ -356,30 +510,36 @@ bool run_ice)
 
     emI_ice = out_emI_ice;    // Copy
     emI_land = out_emI_land;    // Copy
-    GCMRegridder *gcmr(&*gcm_coupler->gcm_regridder);
-    int sheet_index = gcmr->ice_regridders().index.at(name());
-    std::unique_ptr<RegridMatrices_Dynamic> rm(gcmr->regrid_matrices(sheet_index, emI_ice));
+    timespan_ovalsI = timespan;
+
+    if (!sheet_root) printf("END IceCoupler::couple(%s)\n", name().c_str());
+}
+
+IceCoupler::CoupleOut IceCoupler::regrid_outputs(
+std::array<double,2> timespan, // {last_time_s, time_s}
+blitz::Array<double,2> const &ice_ovalsI,
+std::vector<VectorMultivec> &gcm_ivalss_s,                // (accumulate over many ice sheets)
+RegridState &rs)
+{
+    IceCoupler::CoupleOut ret;
+
+    double const dt = timespan[1] - timespan[0];
+    std::vector<std::pair<std::string, double>> scalars({
+        std::make_pair("by_dt", 1.0 / dt)});
 
     // ------ Update E1vE0 translation between old and new elevation classes
     //        (global for all ice sheets)
-    // A SparseSet that is identity for the entire range of I
-    SparseSetT dimI(id_sparse_set<SparseSetT>(nI()));
-
-    // _nc means "No Correct" for changes in area due to projections
-    // See commit d038e5cb for deeper explanation
-    std::unique_ptr<SparseSetT> dimE1(new SparseSetT(gcmr->nE()));
-    auto E1vI_unscaled_nc(rm->matrix_d("EvI", {&*dimE1, &dimI},
-        RegridParams(false, false, {0,0,0})));    // scale=f, correctA=f
+    int emI_ice_ix = standard_names[OUTPUT].at("elevmask_ice");
+    {profile::Timer timer("regrid_matrices");
+        update_regrid_cache(ice_ovalsI(emI_ice_ix, blitz::Range::all()), rs);
+    }
+    RegridCache &rc(*rs.cache);
 
     // ========= Compute gcm_ivalsE
-    SparseSetT dimA1;
-    auto A1vI_unscaled(rm->matrix_d("AvI", {&dimA1, &dimI},
-        RegridParams(false, true, {0,0,0})));    // scale=f, correctA=t
-
     // Do it once for _E variables and once for _A variables.
     std::vector<linear::Weighted_Eigen *> AE1vIs(gcm_ivalss_s.size());
-        AE1vIs[(int)IndexAE::A] = &*A1vI_unscaled;
-        AE1vIs[(int)IndexAE::E] = &*E1vI_unscaled_nc;
+        AE1vIs[(int)IndexAE::A] = &*rc.AuI;
+        AE1vIs[(int)IndexAE::E] = &*rc.EuI_nc;
 
     for (int iAE=(int)IndexAE::A; iAE <= (int)IndexAE::E; ++iAE) {
 
@@ -400,7 +560,7 @@ bool run_ice)
 //        print_var_trans(gcmi_v_iceo_T, var_trans_outAE[iAE], 'T');
 
         // Switch from row-major (Blitz++) to col-major (Eigen) indexing
-        Eigen::Map<EigenDenseMatrixT> ice_ovalsI_e(
+        Eigen::Map<EigenDenseMatrixT const> ice_ovalsI_e(
             ice_ovalsI.data(), ice_ovalsI.extent(1), ice_ovalsI.extent(0));
 
         // ----------- Sanity check: There should not be any NaNs...
@@ -442,60 +602,131 @@ bool run_ice)
 
         // Regrid while recombining variables
         // (Do not need to use Weighted_Eigen::apply(), since this is not IvE)
-        EigenDenseMatrixT gcm_ivalsX((*AE1vIs[iAE]->M) * (
-            ice_ovalsI_e * gcmi_v_iceo_T.M + gcmi_v_iceo_T.b.replicate(nI(),1) ));
+        // gcm_ivalsX(n, j), in Blitz++ layout
+        profile::Timer timer("AvI_EvI");
+        Eigen::SparseMatrix<double, Eigen::RowMajor> const X1vI_r(*AE1vIs[iAE]->M);
+        blitz::Array<double,2> gcm_ivalsX(gcmi_v_iceo_T.M.cols(), X1vI_r.rows());
+        fused_regrid_transform(X1vI_r, ice_ovalsI,
+            gcmi_v_iceo_T.M, gcmi_v_iceo_T.b, gcm_ivalsX);
+
         // Sparsify while appending to the global VectorMultivec
         // (Transposes order in memory)
-        std::vector<double> vals(gcm_ivalss_s[iAE].nvar);
-        for (int jj=0; jj < gcm_ivalsX.rows(); ++jj) {
-            auto jj_s(AE1vIs[iAE]->dims[0]->to_sparse(jj));
-            int nn = 0;
-            for (; nn < gcm_ivalsX.cols(); ++nn) {
-                vals[nn] = gcm_ivalsX(jj,nn);
-            }
-            gcm_ivalss_s[iAE].add(jj_s, vals, AE1vIs[iAE]->wM(jj));
+        VectorMultivec &gcm_ivals_s(gcm_ivalss_s[iAE]);
+        if (gcm_ivalsX.extent(0) != gcm_ivals_s.nvar) (*icebin_error)(-1,
+            "gcm_ivalsX has %d variables, expected %d",
+            gcm_ivalsX.extent(0), gcm_ivals_s.nvar);
+        gcm_ivals_s.reserve(gcm_ivals_s.size() + gcm_ivalsX.extent(1));
+        for (int jj=0; jj < gcm_ivalsX.extent(1); ++jj) {
+            // Patched matrices can retain cells that no longer overlap anything
+            if (AE1vIs[iAE]->wM(jj) == 0) continue;
 
+            auto jj_s(AE1vIs[iAE]->dims[0]->to_sparse(jj));
+            gcm_ivals_s.add(jj_s, gcm_ivalsX.data() + jj, gcm_ivalsX.extent(1),
+                AE1vIs[iAE]->wM(jj));
         }
     }        // iAE
-    // Compute IvE (for use interpreting stuffE at beginning of next timestep)
-    std::unique_ptr<EigenSparseMatrixT> IvE1(
-        std::move(rm->matrix_d("IvE", {&dimI, &*dimE1},
-        RegridParams(true, true, sigma))->M)); // scale=t, correctA=t
-
-    // Compute XuE
-    SparseSetT dimX(id_sparse_set<SparseSetT>(ice_regridder->nX()));
-    ret.XuE = rm->matrix_d("XvE", {&dimX, &*dimE1},
-        RegridParams(false, true, std::array<double,3>{0,0,0}));
-    ret.dimE = &*dimE1;   // reference, not moving it
-
 
-    // Record our matrices for posterity
-    {auto fname(
-        boost::filesystem::path(output_dir) / 
-        ("regrids-" + ice_regridder->name() + "-" + gcm_coupler->sdate(time_s) + ".nc"));
-    NcIO ncio(fname.string(), NcFile::replace);
-
-        // Write matrices as their dense subspace versions, not the sparsified versions.
-        dimI.ncio(ncio, "dimI");
-        dimX.ncio(ncio, "dimX");
-        dimA1.ncio(ncio, "dimA");
-        dimE1->ncio(ncio, "dimE");
-
-        AE1vIs[GridAE::E]->ncio(ncio, "EuI_nc", {"dimE", "dimI"});
-        AE1vIs[GridAE::A]->ncio(ncio, "AuI", {"dimA", "dimI"});
-        ncio_eigen(ncio, *IvE1, "IvE");
-        ret.XuE->ncio(ncio, "XuE", {"dimX", "dimE"});
-    }
+    // XuE is used by the GCMCoupler to compute E1vE0
+    ret.XuE = &*rc.XuE;
+    ret.dimE = &*rc.dimE;   // reference, not moving it
 
     // ---------- Save stuff for next time around
-    // Store stuff from this timestep for next time around
-    this->dimE0 = std::move(dimE1);
-    this->IvE0 = std::move(IvE1);
+    // IvE (for use interpreting stuffE at beginning of next timestep)
+    rs.dimE0.reset(new SparseSetT(*rc.dimE));
+    rs.IvE0.reset(new EigenSparseMatrixT(*rc.IvE));
 
     printf("END IceCoupler::couple(%s)\n", name().c_str());
     return ret;
 }
 
+/** Record our matrices for posterity */
+static void compress_configure_var(netCDF::NcVar ncvar)
+{
+    ncvar.setCompression(true, true, 4);
+}
+
+/** FNV-1a hash, for detecting repeated regrid dumps */
+static void hash_bytes(uint64_t &h, void const *data, size_t n)
+{
+    unsigned char const *p = (unsigned char const *)data;
+    for (size_t i=0; i<n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+}
+
+static void hash_eigen(uint64_t &h, EigenSparseMatrixT const &M)
+{
+    long const shape[2] {(long)M.rows(), (long)M.cols()};
+    hash_bytes(h, shape, sizeof(shape));
+    for (int k=0; k<M.outerSize(); ++k) {
+    for (EigenSparseMatrixT::InnerIterator ii(M, k); ii; ++ii) {
+        long const ix[2] {(long)ii.row(), (long)ii.col()};
+        double const val = ii.value();
+        hash_bytes(h, ix, sizeof(ix));
+        hash_bytes(h, &val, sizeof(val));
+    }}
+}
+
+static void hash_weighted(uint64_t &h, linear::Weighted_Eigen const &BuA)
+{
+    hash_eigen(h, *BuA.M);
+    for (auto *w : {&BuA.wM, &BuA.Mw}) {
+        for (int i=0; i<w->extent(0); ++i) hash_bytes(h, &(*w)(i), sizeof(double));
+    }
+}
+
+void IceCoupler::write_regrids(double time_s)
+{
+    int const step = regrids_step++;
+    switch(regrids_dump.index()) {
+        case RegridsDump::NEVER :
+            return;
+        case RegridsDump::EVERY :
+            if (step % regrids_every != 0) return;
+        break;
+        case RegridsDump::CHANGED :
+            if (!regrid_cache_changed) return;
+        break;
+    }
+    regrid_cache_changed = false;
+
+    RegridCache &rc(*regrid_cache);
+
+    // Skip if identical to the previous dump
+    uint64_t hash = 14695981039346656037ULL;
+    hash_weighted(hash, *rc.EuI_nc);
+    hash_weighted(hash, *rc.AuI);
+    hash_weighted(hash, *rc.XuE);
+    hash_eigen(hash, *rc.IvE);
+    if (hash == regrids_hash) {
+        printf("write_regrids(%s): unchanged since last dump, skipping\n", name().c_str());
+        return;
+    }
+    regrids_hash = hash;
+
+    auto fname(
+        boost::filesystem::path(output_dir) / 
+        ("regrids-" + ice_regridder->name() + "-" + gcm_coupler->sdate(time_s) + ".nc"));
+
+    // Written synchronously, on the calling thread: netCDF is not
+    // thread-safe, and the rest of the coupler's netCDF I/O (gcm-in,
+    // gcm-out, ice model output, restart files) is unsynchronized.
+    NcIO ncio(fname.string(), 'w', "nc4", &compress_configure_var);
+
+    // Write matrices as their dense subspace versions, not the sparsified versions.
+    rc.dimI.ncio(ncio, "dimI");
+    rc.dimX.ncio(ncio, "dimX");
+    rc.dimA->ncio(ncio, "dimA");
+    rc.dimE->ncio(ncio, "dimE");
+
+    rc.EuI_nc->ncio(ncio, "EuI_nc", {"dimE", "dimI"});
+    rc.AuI->ncio(ncio, "AuI", {"dimA", "dimI"});
+    ncio_eigen(ncio, *rc.IvE, "IvE");
+    rc.XuE->ncio(ncio, "XuE", {"dimX", "dimE"});
+    ncio.close();
+}
+
 // =======================================================
 /** Specialized init signature for IceWriter */
 IceWriter::IceWriter(
@@ -541,6 +772,26 @@ IceWriter::IceWriter(
     printf("END IceWriter::init_from_ice_model(%s)\n", fname.c_str());
 }
 
+IceWriter::~IceWriter()
+{
+    // Destructors can't throw; so just report it.
+    try {
+        close();
+    } catch(std::exception const &e) {
+        fprintf(stderr, "IceWriter(%s): Error closing file: %s\n",
+            fname.c_str(), e.what());
+    } catch(...) {
+        fprintf(stderr, "IceWriter(%s): Error closing file\n", fname.c_str());
+    }
+}
+
+void IceWriter::close()
+{
+    if (!ncio) return;
+    std::unique_ptr<NcIO> _ncio(std::move(ncio));
+    _ncio->close();
+}
+
 void IceWriter::init_file()
 {
     GCMCoupler const *gcm_coupler(ice_coupler->gcm_coupler);
@@ -602,6 +853,10 @@ void IceWriter::init_file()
 
     file_initialized = true;
 
+    // Keep the file open from here on
+    this->ncio.reset(new NcIO(fname, NcFile::write));
+    cur[0] = 0;
+
     printf("END IceWriter::init_file(%s)\n", ice_coupler->name().c_str());
 }
 
@@ -618,20 +873,17 @@ void IceWriter::write(double time_s,
     blitz::Array<double,2> const &valsI)    // valsI[nvars, nI]
 {
     GCMCoupler const *gcm_coupler(ice_coupler->gcm_coupler);
-    GCMParams const &gcm_params(gcm_coupler->gcm_params);
     auto &time_unit(gcm_coupler->time_unit);
 
     if (!file_initialized) init_file();
-    NcIO ncio(fname, NcFile::write);
-
-    // Read index info
-    cur[0] = ncio.nc->getDim("time").getSize();
+    if (!ncio) (*icebin_error)(-1,
+        "IceWriter(%s): write() after close()", fname.c_str());
 
     // Write the current time
-    NcVar time_var = ncio.nc->getVar("time");
+    NcVar time_var = ncio->nc->getVar("time");
     time_var.putVar(cur, counts, &time_s);
 
-    NcVar time_txt = ncio.nc->getVar("time.txt");
+    NcVar time_txt = ncio->nc->getVar("time.txt");
     time_txt.putVar({cur[0],0}, {counts[0],(unsigned long)iso8601_length},
         to_iso8601(time_unit.to_datetime(time_s)).c_str());
 
@@ -649,12 +901,21 @@ void IceWriter::write(double time_s,
         double factor = (*contract)[ivar].nc_factor(ice_coupler->gcm_coupler->ut_system);
         VarMeta const &cf = (*contract)[ivar];
 
-        NcVar ncvar = ncio.nc->getVar(cf.name.c_str());
-        for (int i=0; i<valsI.extent(1); ++i) valI_tmp(i) = valsI(ivar, i) * factor;
-        ncvar.putVar(cur, counts, valI_tmp.data());
+        NcVar ncvar = ncio->nc->getVar(cf.name.c_str());
+        double const *val;
+        if (factor == 1.0 && valsI.stride(1) == 1) {
+            // Row of valsI is already what we write
+            val = &valsI(ivar, 0);
+        } else {
+            for (int i=0; i<valsI.extent(1); ++i) valI_tmp(i) = valsI(ivar, i) * factor;
+            val = valI_tmp.data();
+        }
+        ncvar.putVar(cur, counts, val);
     }
 
-    ncio.close();
+    // Make the record visible to readers, without closing the file
+    nc_sync(ncio->nc->getId());
+    ++cur[0];
 }
 
 }    // namespace icebin
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdlib>
+#include <cstdint>
 
 #include <ibmisc/datetime.hpp>
 #include <ibmisc/VarTransformer.hpp>
@@ -9,6 +10,7 @@
 #include <ibmisc/ConstantSet.hpp>
 
 #include <icebin/GCMRegridder.hpp>
+#include <icebin/RegridCache.hpp>
 #include <icebin/VarSet.hpp>
 #include <icebin/multivec.hpp>
 
@@ -65,6 +67,7 @@ public:
     // on the next coupling timestep.
     // TODO: Only keep variables we need here, instead of all of ice_ovalsI
     blitz::Array<double,2> ice_ovalsI;
+    std::array<double,2> timespan_ovalsI;    // Time period ice_ovalsI covers
 
     // [INPUT|OUTPUT] variables
     // List of fields this dynamic ice model takes for input / output.
@@ -87,11 +90,50 @@ public:
 
     // Current ice sheet elevation
     blitz::Array<double,1> emI_ice, emI_land;
+
+    /** Regrid matrices computed in the last call to couple(), along
+    with the elevmaskI they were computed from.  See update_regrid_cache(). */
+    std::unique_ptr<RegridCache> regrid_cache;
+
+    /** Patch regrid_cache incrementally if no more than this fraction
+    of ice grid cells changed elevmaskI since the last coupling
+    timestep; otherwise recompute it from scratch.
+    Set by <sheet>.info:max_patch_fraction in the config file. */
+    double max_patch_fraction = 0.1;
+
+    /** Set when regrid_cache changes; cleared when it is dumped. */
+    bool regrid_cache_changed = false;
+
+    // ----------- Debugging dump of regrid_cache (regrids-<sheet>-<date>.nc)
+public:
+    BOOST_ENUM_VALUES( RegridsDump, int,
+        (NEVER)     (0)     // Don't write
+        (EVERY)     (1)     // Every regrids_every coupling timesteps
+        (CHANGED)   (2)     // Only when regrid_cache has changed
+    )
+protected:
+    RegridsDump regrids_dump = RegridsDump::CHANGED;
+    int regrids_every = 1;
+
+    int regrids_step = 0;               // Coupling timesteps seen by write_regrids()
+    uint64_t regrids_hash = 0;          // Content hash of the last dump
 public:
     std::string const &name() const { return _name; }
     AbbrGrid const &agridI() { return ice_regridder->agridI; }
     long nI() const { return ice_regridder->agridI.dim.sparse_extent(); }
 
+    /** Index of this ice sheet in gcm_regridder->ice_regridders() */
+    int sheet_index() const;
+
+    /** True if the ice model runs (serially) on this ice sheet's root
+    (GCMCoupler::sheet_roots), where ice_ivalsI is computed and
+    ice_ovalsI regridded; false if it runs on gcm_root. */
+    virtual bool runs_on_sheet_root() const { return false; }
+
+    /** True if this rank is the ice model's root: the sheet root or
+    gcm_root, according to runs_on_sheet_root() */
+    bool am_i_icemodel_root() const;
+
     // ======================================================
 
     virtual ~IceCoupler();
@@ -158,6 +200,31 @@ protected:
         double dt,
         ibmisc::TmpAlloc &tmp);
 
+public:
+    /** Everything regrid_outputs() modifies: the regrid matrices, and
+    IvE0 / dimE0 for the next coupling timestep.  It is passed
+    explicitly, so that with coupling_lag the regrid thread can own it
+    while the ice model runs; see couple(). */
+    struct RegridState {
+        std::unique_ptr<RegridCache> cache;
+        bool cache_changed = false;
+        std::unique_ptr<SparseSetT> dimE0;           // nullptr if not updated
+        std::unique_ptr<EigenSparseMatrixT> IvE0;    // nullptr if not updated
+    };
+
+protected:
+    /** Moves regrid_cache and regrid_cache_changed out of *this */
+    RegridState take_regrid_state();
+
+    /** Moves a RegridState back into *this (and IvE0 / dimE0, if set) */
+    void put_regrid_state(RegridState &&rs);
+
+    /** Brings rs.cache up to date with emI_ice.  Matrices are
+    re-used if emI_ice has not changed, patched if only a few ice
+    cells have changed, and recomputed otherwise.
+    See RegridCache::update(). */
+    void update_regrid_cache(blitz::Array<double,1> const &emI_ice, RegridState &rs);
+
 public:
     /** A "virtual function" used to customize construct_ice_ivalsI().
     This defaults to NOP, and is set by the coupling contract. */
@@ -165,7 +232,7 @@ public:
 
     struct CoupleOut {
         /** X=exchange grid; E=elevation grid; XuE used to compute E1vE0 */
-        std::unique_ptr<ibmisc::linear::Weighted_Eigen> XuE;    // UNSCALED
+        ibmisc::linear::Weighted_Eigen const *XuE = nullptr;    // UNSCALED; owned by regrid_cache
         SparseSetT *dimE;   // Used to interpret XuE
     };
 
@@ -183,6 +250,47 @@ public:
         // ------- Flags
         bool run_ice);
 
+    /** First half of couple(): computes ice_ivalsI (on the sheet
+    root), runs the ice model (all ranks) and leaves ice_ovalsI,
+    emI_ice and emI_land on gcm_root and the sheet root.  If they are
+    different ranks, inputs and outputs are passed between them over
+    GCMCoupler::sheet_comms.
+    @param overlap If set, called once ice_ivalsI is ready, just
+        before the ice model runs (see GCMCoupler::coupling_lag) */
+    void run_icemodel(
+        std::array<double,2> timespan,
+        VectorMultivec const &gcm_ovalsE_s,
+        bool run_ice,
+        std::function<void()> const &overlap = std::function<void()>());
+
+    /** Second half of couple(), run only on the sheet root: updates
+    regrid matrices and regrids ice model output to the GCM.
+    The only state it modifies is rs; anything else it reads from
+    *this is configuration, which does not change while coupling.
+    So it may run while the ice model runs.
+    @param timespan Time period covered by ice_ovalsI
+    @param ice_ovalsI Ice model output to regrid
+    @param rs Regrid matrices to update; receives IvE0 / dimE0 for
+        the next coupling timestep. */
+    CoupleOut regrid_outputs(
+        std::array<double,2> timespan,
+        blitz::Array<double,2> const &ice_ovalsI,
+        std::vector<VectorMultivec> &gcm_ivalss_s,
+        RegridState &rs);
+
+    /** regrid_outputs() on ice_ovalsI from the last run_icemodel(),
+    updating this IceCoupler's regrid matrices and IvE0 / dimE0.
+    Run only on the sheet root. */
+    CoupleOut regrid_ice_ovalsI(
+        std::array<double,2> timespan,
+        std::vector<VectorMultivec> &gcm_ivalss_s);
+
+    /** Writes the matrices from the last regrid_outputs() to
+    output_dir/regrids-<sheet>-<date>.nc, as directed by
+    regrids_dump.  A dump identical to the previous one
+    is skipped. */
+    void write_regrids(double time_s);
+
     /** (4.1) @param index Index of each grid value.
     @param time_s Time since start of simulation, in seconds
     @param do_run True if we are to actually run (otherwise just return ice_ovalsI from current state) */
@@ -214,6 +322,9 @@ class IceWriter
     // Used for lazy opening of output file
     bool file_initialized = false;
 
+    // Output file, kept open between writes
+    std::unique_ptr<ibmisc::NcIO> ncio;
+
     // Dimensions to use when writing to netCDF
     std::vector<std::string> dim_names;
     std::vector<size_t> cur;        // Base index to write in netCDF
@@ -225,12 +336,18 @@ public:
         VarSet const *_contract,
         std::string const &_fname);
 
+    /** Closes the file; errors are only logged.  Call close() first
+    to have them raised. */
+    ~IceWriter();
+
     void write(double time_s,
         blitz::Array<double,2> const &valsI);    // valsI[nI, nvars]
 
+    /** Closes the output file (if open).  Raises netCDF errors. */
+    void close();
+
 private:
     void init_file();
-
 };
 
 }
@@ -1,9 +1,12 @@
 #include <cstdio>
 #include <iostream>
 #include <functional>
+#include <algorithm>
+#include <mutex>
 #include <icebin/GCMRegridder.hpp>
 #include <icebin/IceRegridder_L0.hpp>
 #include <icebin/Grid.hpp>
+#include <icebin/snapshot.hpp>
 #include <spsparse/netcdf.hpp>
 
 using namespace std;
@@ -64,6 +67,42 @@ void IceRegridder::sEpvE(MakeDenseEigenT::AccumT &&w) const
     }
 }
 // -------------------------------------------------------------
+/** Guards lazy construction of IceRegridder::_x_by_i */
+static std::mutex x_by_i_mutex;
+
+std::vector<int> IceRegridder::idsX(std::vector<long> const &iIs) const
+{
+    std::shared_ptr<XByI const> x_by_i;
+    {std::lock_guard<std::mutex> lock(x_by_i_mutex);
+        if (!_x_by_i) {
+            // Counting sort of the exchange grid by ice grid cell
+            std::shared_ptr<XByI> xi(new XByI);
+            long const nI = agridI.dim.sparse_extent();
+            xi->ptr.assign(nI+1, 0);
+            for (int id=0; id<aexgrid.dense_extent(); ++id)
+                ++xi->ptr[aexgrid.ijk(id,1)+1];
+            for (long iI=0; iI<nI; ++iI) xi->ptr[iI+1] += xi->ptr[iI];
+
+            xi->ids.resize(aexgrid.dense_extent());
+            std::vector<size_t> next(xi->ptr.begin(), xi->ptr.end()-1);
+            for (int id=0; id<aexgrid.dense_extent(); ++id)
+                xi->ids[next[aexgrid.ijk(id,1)]++] = id;
+            _x_by_i = xi;
+        }
+        x_by_i = _x_by_i;
+    }
+
+    std::vector<int> ret;
+    for (long iI : iIs) {
+        ret.insert(ret.end(),
+            x_by_i->ids.begin() + x_by_i->ptr[iI],
+            x_by_i->ids.begin() + x_by_i->ptr[iI+1]);
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+// -------------------------------------------------------------
 #if 0
 void IceRegridder::clear()
 {
@@ -72,22 +111,35 @@ void IceRegridder::clear()
 }
 #endif
 // -------------------------------------------------------------
-void IceRegridder::ncio(NcIO &ncio, std::string const &vname)
+void IceRegridder::ncio(NcIO &ncio, std::string const &vname, SnapshotIO *snap)
 {
     if (ncio.rw == 'r') {
-        agridI.ncio(ncio, vname + ".agridI");
-        aexgrid.ncio(ncio, vname + ".aexgrid");
+        _x_by_i.reset();
+        agridI.ncio(ncio, vname + ".agridI", snap);
+        aexgrid.ncio(ncio, vname + ".aexgrid", snap);
     }
 
     auto info_v = get_or_add_var(ncio, vname + ".info", "int", {});
     get_or_put_att(info_v, ncio.rw, "name", _name);
     get_or_put_att_enum(info_v, ncio.rw, "interp_style", interp_style);
 
-    ncio_blitz_alloc(ncio, gridA_proj_area, vname + ".gridA_proj_area", "double",
-        get_or_add_dims(ncio, gridA_proj_area, {"agridA.ndata"}));
-    agridI.ncio(ncio, vname + ".agridI");
-    aexgrid.ncio(ncio, vname + ".aexgrid");
+    if (snap) {
+        snap->blitz(gridA_proj_area, vname + ".gridA_proj_area");
+    } else {
+        ncio_blitz_alloc(ncio, gridA_proj_area, vname + ".gridA_proj_area", "double",
+            get_or_add_dims(ncio, gridA_proj_area, {"agridA.ndata"}));
+    }
+    agridI.ncio(ncio, vname + ".agridI", snap);
+    aexgrid.ncio(ncio, vname + ".aexgrid", snap);
+
+}
 
+void IceRegridder::snapshot(SnapshotIO &snap, std::string const &vname)
+{
+    snap.blitz(gridA_proj_area, vname + ".gridA_proj_area");
+    agridI.snapshot(snap, vname + ".agridI");
+    aexgrid.snapshot(snap, vname + ".aexgrid");
+    _x_by_i.reset();
 }
 
 void IceRegridder::init(
@@ -100,6 +152,7 @@ void IceRegridder::init(
 {
     agridI = std::move(_agridI);    // convert Grid -> AbbrGrid
     aexgrid = std::move(_aexgrid);  // convert Grid -> AbbrGrid
+    _x_by_i.reset();
     _name = (name != "" ? name : agridI.name);
     interp_style = _interp_style;
 
@@ -175,6 +228,7 @@ void IceRegridder::filter_cellsA(std::function<bool (long)> const &useA)
     used temporarily; and this dimension is ultimately multiplied away
     before being shared between processors or in time. */
     aexgrid.filter_cellsB(useA);
+    _x_by_i.reset();
 }
 // ================================================================
 // ==============================================================
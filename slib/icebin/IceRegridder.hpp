@@ -19,6 +19,7 @@
 #ifndef ICEBIN_ICEREGRIDDER_H
 #define ICEBIN_ICEREGRIDDER_H
 
+#include <memory>
 #include <unordered_set>
 #include <ibmisc/netcdf.hpp>
 
@@ -70,6 +71,21 @@ public:
     ExchangeGrid aexgrid;       /// Exchange grid overlaps (between GCM and Ice)
     InterpStyle interp_style;   /// How we interpolate I<-E.  Determines basis functions in E
 
+protected:
+    /** Exchange grid cells (dense) overlapping each ice grid cell
+    (sparse), in CSR form.  Built on first use by idsX(); reset
+    whenever aexgrid changes. */
+    struct XByI {
+        std::vector<size_t> ptr;    // [nI+1]
+        std::vector<int> ids;
+    };
+    mutable std::shared_ptr<XByI const> _x_by_i;
+
+public:
+    /** @return Dense indices of the exchange grid cells that overlap
+        any of the ice grid cells iIs (sparse indexing); sorted. */
+    std::vector<int> idsX(std::vector<long> const &iIs) const;
+
     // ---------------------------------
 
     // MatrixFunctions used by corresponding functions in GCMRegridder
@@ -117,24 +133,34 @@ public:
     NOTE: wAvAp == sApvA */
     void sEpvE(MakeDenseEigenT::AccumT &&w) const;
 
+    // In the following, idsX (if set) restricts the loop over the
+    // exchange grid to those (dense) cells; see idsX().
+
     /** Produces the unscaled matrix [Interpolation or Ice] <-- [Projected Elevation] */
     virtual void GvEp(MakeDenseEigenT::AccumT &&ret,
         char gridG,
-        blitz::Array<double,1> const *elevmaskI) const = 0;
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const = 0;
 
     /** Produces the unscaled matrix [Interpolation or Ice] <-- [Ice] */
     virtual void GvI(MakeDenseEigenT::AccumT &&ret,
         char gridG,
-        blitz::Array<double,1> const *elevmaskI) const = 0;
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const = 0;
 
     /** Produces the unscaled matrix [Interpolation or Ice] <-- [Projected Atmosphere] */
     virtual void GvAp(MakeDenseEigenT::AccumT &&ret,
         char gridG,
-        blitz::Array<double,1> const *elevmaskI) const = 0;
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const = 0;
 
     /** Define, read or write this data structure inside a NetCDF file.
-    @param vname: Variable name (or prefix) to define/read/write it under. */
-    virtual void ncio(ibmisc::NcIO &ncio, std::string const &vname);
+    @param vname: Variable name (or prefix) to define/read/write it under.
+    @param snap: If set, bulk arrays are read/written there instead. */
+    virtual void ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap = nullptr);
+
+    /** Read/write just the bulk arrays (see SnapshotIO) */
+    void snapshot(SnapshotIO &snap, std::string const &vname);
 
 };  // class IceRegridder
 
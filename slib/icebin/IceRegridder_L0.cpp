@@ -100,7 +100,8 @@ extern void linterp_1d_b(
 void IceRegridder_L0::GvEp(
     MakeDenseEigenT::AccumT &&ret,
     char gridG,    // Interpolation grid to use for G: 'I' (ice) or 'G' (exchange)
-    blitz::Array<double,1> const *_elevmaskI) const
+    blitz::Array<double,1> const *_elevmaskI,
+    std::vector<int> const *idsX) const
 {
 printf("BEGIN IceRegridder_L0::GvEp()\n");
     blitz::Array<double,1> const &elevmaskI(*_elevmaskI);
@@ -112,7 +113,9 @@ printf("BEGIN IceRegridder_L0::GvEp()\n");
     // Handle Z_INTERP or ELEV_CLASS_INTERP
 
     // Interpolate in the vertical
-    for (int id=0; id<aexgrid.dense_extent(); ++id) {
+    size_t const nid = (idsX ? idsX->size() : aexgrid.dense_extent());
+    for (size_t k=0; k<nid; ++k) {
+        int const id = (idsX ? (*idsX)[k] : k);
         long const iA = aexgrid.ijk(id,0);        // GCM Atmosphere grid
         long const iI = aexgrid.ijk(id,1);        // Ice Grid
         long const iX = aexgrid.to_sparse(id);    // X=Exchange Grid
@@ -157,7 +160,8 @@ printf("END IceRegridder_L0::GvEp()\n");
 void IceRegridder_L0::GvI(
     MakeDenseEigenT::AccumT &&ret,
     char gridG,    // Interpolation grid to use for G: 'I' (ice) or 'X' (exchange)
-    blitz::Array<double,1> const *_elevmaskI) const
+    blitz::Array<double,1> const *_elevmaskI,
+    std::vector<int> const *idsX) const
 {
     blitz::Array<double,1> const &elevmaskI(*_elevmaskI);
     if (gridG == 'I') {
@@ -175,7 +179,9 @@ void IceRegridder_L0::GvI(
         }
     } else {
         // Exchange <- Ice
-        for (int id=0; id<aexgrid.dense_extent(); ++id) {
+        size_t const nid = (idsX ? idsX->size() : aexgrid.dense_extent());
+        for (size_t k=0; k<nid; ++k) {
+            int const id = (idsX ? (*idsX)[k] : k);
             // cell->i = index in atmosphere grid
             long const iI = aexgrid.ijk(id,1);        // index in ice grid
             long const iX = aexgrid.to_sparse(id);    // index in exchange grid
@@ -192,11 +198,14 @@ void IceRegridder_L0::GvI(
 void IceRegridder_L0::GvAp(
     MakeDenseEigenT::AccumT &&ret,
     char gridG,    // Interpolation grid to use for G: 'I' (ice) or 'X' (exchange)
-    blitz::Array<double,1> const *_elevmaskI) const
+    blitz::Array<double,1> const *_elevmaskI,
+    std::vector<int> const *idsX) const
 {
 printf("BEGIN IceRegridder_L0::GvAp()\n");
     blitz::Array<double,1> const &elevmaskI(*_elevmaskI);
-    for (int id=0; id<aexgrid.dense_extent(); ++id) {
+    size_t const nid = (idsX ? idsX->size() : aexgrid.dense_extent());
+    for (size_t k=0; k<nid; ++k) {
+        int const id = (idsX ? (*idsX)[k] : k);
         long const iG = (gridG == 'I' ?
             aexgrid.ijk(id,1) : aexgrid.to_sparse(id));
         long const iA = aexgrid.ijk(id,0);
@@ -213,9 +222,9 @@ printf("BEGIN IceRegridder_L0::GvAp()\n");
 printf("END IceRegridder_L0::GvAp()\n");
 }
 // --------------------------------------------------------
-void IceRegridder_L0::ncio(NcIO &ncio, std::string const &vname)
+void IceRegridder_L0::ncio(NcIO &ncio, std::string const &vname, SnapshotIO *snap)
 {
-    IceRegridder::ncio(ncio, vname);
+    IceRegridder::ncio(ncio, vname, snap);
     auto info_v = get_or_add_var(ncio, vname + ".info", "int", {});
 }
 
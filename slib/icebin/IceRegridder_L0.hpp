@@ -41,14 +41,17 @@ public:
     // Implementations of virtual functions
     void GvEp(MakeDenseEigenT::AccumT &&ret,
         char gridG,    // Identity of G: 'I' (ice) or 'X' (exchange)
-        blitz::Array<double,1> const *elevmaskI) const;
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const;
     void GvI(MakeDenseEigenT::AccumT &&ret,
         char gridG,    // Identity of G: 'I' (ice) or 'X' (exchange)
-        blitz::Array<double,1> const *elevmaskI) const;
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const;
     void GvAp(MakeDenseEigenT::AccumT &&ret,
         char gridG,    // Identity of G: 'I' (ice) or 'X' (exchange)
-        blitz::Array<double,1> const *elevmaskI) const;
-    void ncio(ibmisc::NcIO &ncio, std::string const &vname);
+        blitz::Array<double,1> const *elevmaskI,
+        std::vector<int> const *idsX = nullptr) const;
+    void ncio(ibmisc::NcIO &ncio, std::string const &vname, SnapshotIO *snap = nullptr);
 };
 
 
@@ -0,0 +1,316 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <icebin/RegridCache.hpp>
+#include <icebin/ElevMask.hpp>
+#include <icebin/error.hpp>
+
+using namespace spsparse;
+using namespace ibmisc;
+
+namespace icebin {
+
+static double const nan = std::numeric_limits<double>::quiet_NaN();
+
+// Parameters used for each of the cached regrid matrices
+// _nc means "No Correct" for changes in area due to projections
+// See commit d038e5cb for deeper explanation
+static RegridParams const EuI_nc_params(false, false, {0,0,0});    // scale=f, correctA=f
+static RegridParams const AuI_params(false, true, {0,0,0});        // scale=f, correctA=t
+static RegridParams const XuE_params(false, true, {0,0,0});        // scale=f, correctA=t
+
+RegridCache::RegridCache(long nI, long nX, long nE) :
+    dimI(id_sparse_set<SparseSetT>(nI)),
+    dimX(id_sparse_set<SparseSetT>(nX)),
+    dimE(new SparseSetT(nE)),
+    dimA(new SparseSetT)
+{}
+
+RegridCache::~RegridCache() {}
+
+/** @return A copy of elevmaskI, with all cells masked out except iIs */
+static blitz::Array<double,1> select_cells(
+    blitz::Array<double,1> const &elevmaskI,
+    std::vector<long> const &iIs)
+{
+    blitz::Array<double,1> ret(elevmaskI.extent(0));
+    ret = nan;
+    for (long iI : iIs) ret(iI) = elevmaskI(iI);
+    return ret;
+}
+
+/** Copies a blitz vector, zero-padding it to length n */
+static blitz::Array<double,1> zero_pad(blitz::Array<double,1> const &w, int n)
+{
+    blitz::Array<double,1> ret(n);
+    ret = 0;
+    for (int i=0; i<w.extent(0); ++i) ret(i) = w(i);
+    return ret;
+}
+
+/** Replaces rows (idim=0) or columns (idim=1) of M with those of dM.
+Dense dimensions could have grown while computing dM, so M is resized
+to n first.
+@param changed changed[i] is set if row/column i is to be replaced */
+static void patch_matrix(
+    EigenSparseMatrixT &M,
+    EigenSparseMatrixT const &_dM,
+    std::array<int,2> const &n,
+    int idim,
+    std::vector<char> const &changed)
+{
+    auto const in_changed([&](EigenSparseMatrixT::Index i0, EigenSparseMatrixT::Index i1) -> bool {
+        return changed[idim == 0 ? i0 : i1]; });
+
+    EigenSparseMatrixT dM(_dM);
+    dM.conservativeResize(n[0], n[1]);
+    dM.prune([&](EigenSparseMatrixT::Index i0, EigenSparseMatrixT::Index i1, double) {
+        return in_changed(i0, i1); });
+
+    M.conservativeResize(n[0], n[1]);
+    M.prune([&](EigenSparseMatrixT::Index i0, EigenSparseMatrixT::Index i1, double) {
+        return !in_changed(i0, i1); });
+    M += dM;
+}
+
+/** Patches an unscaled regrid matrix in which each row (idim=0) or
+column (idim=1) is computed from a single ice grid cell; for example
+EuI and AuI (idim=1) and XuE (idim=0).  Entries for changed cells are
+replaced.  Weights on the other dimension are sums over cells, so the
+contribution of the changed cells is subtracted and re-added.
+@param BuA Matrix to patch, computed over all cells
+@param BuA_old Same matrix, restricted to changed cells, old elevmaskI
+@param BuA_new Same matrix, restricted to changed cells, new elevmaskI
+@param idim Dimension of BuA that is indexed by the cells that change
+@param changed changed[i] is set if cell i (on dimension idim) changed */
+static void patch_weighted(
+    linear::Weighted_Eigen &BuA,
+    linear::Weighted_Eigen const &BuA_old,
+    linear::Weighted_Eigen const &BuA_new,
+    int idim,
+    std::vector<char> const &changed)
+{
+    std::array<int,2> const n {
+        (int)BuA.dims[0]->dense_extent(), (int)BuA.dims[1]->dense_extent()};
+    int const odim = 1 - idim;
+
+    // ------- Replace entries for changed cells
+    patch_matrix(*BuA.M, *BuA_new.M, n, idim, changed);
+
+    // ------- Patch weights
+    std::array<blitz::Array<double,1> *,2> const w {&BuA.wM, &BuA.Mw};
+    std::array<blitz::Array<double,1> const *,2> const w_old {&BuA_old.wM, &BuA_old.Mw};
+    std::array<blitz::Array<double,1> const *,2> const w_new {&BuA_new.wM, &BuA_new.Mw};
+
+    // Weights of changed cells are replaced outright
+    blitz::Array<double,1> wi(zero_pad(*w[idim], n[idim]));
+    blitz::Array<double,1> wi_new(zero_pad(*w_new[idim], n[idim]));
+    for (int i=0; i<n[idim]; ++i) if (changed[i]) wi(i) = wi_new(i);
+
+    // Weights on the other dimension are sums over cells
+    blitz::Array<double,1> wo(zero_pad(*w[odim], n[odim]));
+    for (int j=0; j<w_old[odim]->extent(0); ++j) wo(j) -= (*w_old[odim])(j);
+    for (int j=0; j<w_new[odim]->extent(0); ++j) wo(j) += (*w_new[odim])(j);
+
+    // Cells with nothing left in them get weight exactly zero,
+    // rather than round-off residue.
+    std::vector<char> used(n[odim], 0);
+    for (int k=0; k<BuA.M->outerSize(); ++k) {
+    for (EigenSparseMatrixT::InnerIterator ii(*BuA.M, k); ii; ++ii) {
+        used[odim == 0 ? ii.row() : ii.col()] = 1;
+    }}
+    for (int j=0; j<n[odim]; ++j) if (!used[j]) wo(j) = 0;
+
+    w[idim]->reference(wi);
+    w[odim]->reference(wo);
+}
+
+/** @return Sorted list of the cells set in mask */
+static std::vector<long> mask_to_list(std::vector<char> const &mask)
+{
+    std::vector<long> ret;
+    for (size_t i=0; i<mask.size(); ++i) if (mask[i]) ret.push_back(i);
+    return ret;
+}
+// -----------------------------------------------------------
+std::vector<long> RegridCache::neighborsI(
+    IceRegridder const *ice_regridder,
+    std::vector<long> const &iIs,
+    std::array<double,3> const &sigma)
+{
+    AbbrGrid const &agridI(ice_regridder->agridI);
+    long const nI = ice_regridder->nI();
+
+    // Centroids are only available on XY grids
+    if (agridI.centroid_xy.extent(0) != agridI.dim.dense_extent())
+        return std::vector<long>();
+
+    if (!rtreeI) {
+        centroidsI.assign(nI, {nan, nan});
+        rtreeI.reset(new RTree);
+        for (int id=0; id<agridI.dim.dense_extent(); ++id) {
+            long const iI = agridI.dim.to_sparse(id);
+            auto &c(centroidsI[iI]);
+            c = {agridI.centroid_xy(id,0), agridI.centroid_xy(id,1)};
+            rtreeI->Insert(&c[0], &c[0], iI);
+        }
+    }
+
+    // Smoother includes points out to nsigma=2 sigmas away,
+    // measured horizontally (see Smoother::matrix_callback()).
+    double const nsigma = 2.;
+    std::vector<char> neighbor(nI, 0);
+    for (long iI : iIs) {
+        neighbor[iI] = 1;
+        auto const &c(centroidsI[iI]);
+        if (std::isnan(c[0])) continue;    // Not on the grid
+
+        rtreeI->Search(
+            {c[0] - nsigma*sigma[0], c[1] - nsigma*sigma[1]},
+            {c[0] + nsigma*sigma[0], c[1] + nsigma*sigma[1]},
+            [&neighbor](long iI1) -> bool {
+                neighbor[iI1] = 1;
+                return true;    // Keep going
+            });
+    }
+    return mask_to_list(neighbor);
+}
+// -----------------------------------------------------------
+RegridCache::Update RegridCache::update(
+    std::unique_ptr<RegridCache> &rcp,
+    GCMRegridder const *gcmr,
+    int sheet_index,
+    blitz::Array<double,1> const &emI_ice,
+    std::array<double,3> const &sigma,
+    double max_patch_fraction)
+{
+    IceRegridder const *ice_regridder = &*gcmr->ice_regridders()[sheet_index];
+    long const nI = ice_regridder->nI();
+    RegridParams const IvE_params(true, true, sigma);    // scale=t, correctA=t
+
+    // Only GCMRegridder_Standard produces matrices in which each
+    // row/column depends on just one ice grid cell.
+    auto const *gcms(dynamic_cast<GCMRegridder_Standard const *>(gcmr));
+
+    // ----------- Decide whether to re-use, patch or recompute
+    std::vector<long> changedI;
+    bool patch = false;
+    if (rcp.get()) {
+        changedI = diff_elevmask(rcp->emI_ice, emI_ice);
+        printf("RegridCache::update(%s): %ld of %ld cells changed\n",
+            ice_regridder->name().c_str(), (long)changedI.size(), nI);
+
+        // Nothing changed: matrices from last time are still good
+        if (changedI.size() == 0) return Update::REUSED;
+
+        patch = (gcms && changedI.size() <= max_patch_fraction * nI);
+    }
+
+    if (!patch) {
+        std::unique_ptr<RegridCache> rc1(new RegridCache(nI, ice_regridder->nX(), gcmr->nE()));
+        if (rcp.get()) {    // Neighbor search is independent of elevmaskI
+            rc1->rtreeI = std::move(rcp->rtreeI);
+            rc1->centroidsI = std::move(rcp->centroidsI);
+        }
+        RegridCache &rc(*rc1);
+
+        std::unique_ptr<RegridMatrices_Dynamic> rm(gcmr->regrid_matrices(sheet_index, emI_ice));
+        rc.EuI_nc = rm->matrix_d("EvI", {&*rc.dimE, &rc.dimI}, EuI_nc_params);
+        rc.AuI = rm->matrix_d("AvI", {&*rc.dimA, &rc.dimI}, AuI_params);
+        rc.XuE = rm->matrix_d("XvE", {&rc.dimX, &*rc.dimE}, XuE_params);
+        rc.IvE = std::move(rm->matrix_d("IvE", {&rc.dimI, &*rc.dimE}, IvE_params)->M);
+        printf("RegridCache::update(%s): recomputed, UrCache hits=%ld misses=%ld\n",
+            ice_regridder->name().c_str(), rm->ur_cache->hits, rm->ur_cache->misses);
+
+        rc.emI_ice.reference(blitz::Array<double,1>(emI_ice.copy()));
+        rcp = std::move(rc1);
+        return Update::RECOMPUTED;
+    }
+
+    RegridCache &rc(*rcp);
+
+    // Cells that changed, on the ice and exchange grids
+    std::vector<char> changed_I(nI, 0);
+    for (long iI : changedI) changed_I[iI] = 1;
+    ExchangeGrid const &aexgrid(ice_regridder->aexgrid);
+    std::vector<char> changed_X(ice_regridder->nX(), 0);
+    for (int id : ice_regridder->idsX(changedI)) changed_X[aexgrid.to_sparse(id)] = 1;
+
+    // Matrices restricted to just the changed cells, before and after.
+    // These only visit the exchange grid cells overlapping changedI.
+    std::array<std::unique_ptr<RegridMatrices_Dynamic>,2> rm_delta {
+        gcms->regrid_matrices(sheet_index, select_cells(rc.emI_ice, changedI), &changedI),
+        gcms->regrid_matrices(sheet_index, select_cells(emI_ice, changedI), &changedI)};
+
+    std::array<std::unique_ptr<linear::Weighted_Eigen>,2> EuI_nc_d, AuI_d, XuE_d;
+    for (int k=0; k<2; ++k) {
+        EuI_nc_d[k] = rm_delta[k]->matrix_d("EvI", {&*rc.dimE, &rc.dimI}, EuI_nc_params);
+        AuI_d[k] = rm_delta[k]->matrix_d("AvI", {&*rc.dimA, &rc.dimI}, AuI_params);
+        XuE_d[k] = rm_delta[k]->matrix_d("XvE", {&rc.dimX, &*rc.dimE}, XuE_params);
+    }
+
+    patch_weighted(*rc.EuI_nc, *EuI_nc_d[0], *EuI_nc_d[1], 1, changed_I);
+    patch_weighted(*rc.AuI, *AuI_d[0], *AuI_d[1], 1, changed_I);
+    patch_weighted(*rc.XuE, *XuE_d[0], *XuE_d[1], 0, changed_X);
+
+    // ----------- IvE
+    // Scaled IvE rows depend only on their own ice grid cell; but
+    // smoothing mixes in cells up to 2 sigma away.  Rows rowsI must be
+    // recomputed, which depends on cells cellsI.
+    std::vector<long> rowsI, cellsI;
+    std::unique_ptr<RegridMatrices_Dynamic> rm_IvE;
+    RegridMatrices_Dynamic *rmI = &*rm_delta[1];
+    if (IvE_params.smooth()) {
+        if (std::isfinite(sigma[0]) && std::isfinite(sigma[1])) {
+            rowsI = rc.neighborsI(ice_regridder, changedI, sigma);
+            if (rowsI.size() > 0) cellsI = rc.neighborsI(ice_regridder, rowsI, sigma);
+        }
+        if (cellsI.size() == 0 || cellsI.size() > max_patch_fraction * nI) {
+            // Neighborhood is too large; cheaper to start over
+            std::unique_ptr<RegridMatrices_Dynamic> rm(
+                gcmr->regrid_matrices(sheet_index, emI_ice));
+            rc.IvE = std::move(rm->matrix_d("IvE", {&rc.dimI, &*rc.dimE}, IvE_params)->M);
+            rowsI.clear();
+        } else {
+            rm_IvE = gcms->regrid_matrices(sheet_index, select_cells(emI_ice, cellsI), &cellsI);
+            rmI = &*rm_IvE;
+        }
+    } else {
+        rowsI = changedI;
+    }
+
+    if (rowsI.size() > 0) {
+        std::vector<char> changed_rows(nI, 0);
+        for (long iI : rowsI) changed_rows[iI] = 1;
+
+        std::unique_ptr<EigenSparseMatrixT> IvE_d(std::move(
+            rmI->matrix_d("IvE", {&rc.dimI, &*rc.dimE}, IvE_params)->M));
+        patch_matrix(*rc.IvE, *IvE_d,
+            {(int)rc.dimI.dense_extent(), (int)rc.dimE->dense_extent()},
+            0, changed_rows);
+    }
+
+    printf("RegridCache::update(%s): patched %ld cells, %ld IvE rows\n",
+        ice_regridder->name().c_str(), (long)changedI.size(), (long)rowsI.size());
+
+    rc.emI_ice.reference(blitz::Array<double,1>(emI_ice.copy()));
+    return Update::PATCHED;
+}
+
+}    // namespace icebin
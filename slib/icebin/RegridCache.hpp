@@ -0,0 +1,80 @@
+#ifndef ICEBIN_REGRIDCACHE_HPP
+#define ICEBIN_REGRIDCACHE_HPP
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <blitz/array.h>
+#include <ibmisc/RTree.hpp>
+#include <icebin/GCMRegridder.hpp>
+
+namespace icebin {
+
+/** Regrid matrices computed in the last coupling timestep, along
+with the elevmaskI they were computed from.  Carried over so they can
+be re-used (or patched) when elevmaskI changes little between
+coupling timesteps.  See RegridCache::update(). */
+class RegridCache {
+public:
+    enum class Update {
+        REUSED,        // elevmaskI unchanged; nothing was done
+        PATCHED,       // Only rows/columns of changed cells were recomputed
+        RECOMPUTED     // Recomputed from scratch
+    };
+
+    blitz::Array<double,1> emI_ice;    // elevmaskI these matrices were computed from
+
+    SparseSetT dimI;    // Identity for the ice grid
+    SparseSetT dimX;    // Identity for the exchange grid
+    std::unique_ptr<SparseSetT> dimE;
+    std::unique_ptr<SparseSetT> dimA;
+
+    std::unique_ptr<ibmisc::linear::Weighted_Eigen> EuI_nc;    // scale=f, correctA=f
+    std::unique_ptr<ibmisc::linear::Weighted_Eigen> AuI;       // scale=f, correctA=t
+    std::unique_ptr<ibmisc::linear::Weighted_Eigen> XuE;       // scale=f, correctA=t
+    std::unique_ptr<EigenSparseMatrixT> IvE;                   // scale=t, correctA=t, smoothed
+
+protected:
+    /** Ice grid cell centroids, used to find the cells within
+    smoothing distance of changed cells.  Built on first use. */
+    typedef ibmisc::RTree<long, double, 2> RTree;
+    std::unique_ptr<RTree> rtreeI;
+    std::vector<std::array<double,2>> centroidsI;    // Indexed by iI
+
+    /** @return Ice grid cells within smoothing distance of any of iIs
+    (including iIs themselves), in increasing order. */
+    std::vector<long> neighborsI(
+        IceRegridder const *ice_regridder,
+        std::vector<long> const &iIs,
+        std::array<double,3> const &sigma);
+
+public:
+    RegridCache(long nI, long nX, long nE);
+    ~RegridCache();    // Not inline because of rtreeI
+
+    /** Brings rc up to date with emI_ice.  Matrices are re-used if
+    emI_ice has not changed, and recomputed from scratch if more than
+    max_patch_fraction of the ice grid cells changed.  Otherwise, only
+    the parts of the matrices that depend on the changed cells are
+    recomputed and patched in:
+       * EuI_nc and AuI: columns of changed cells
+       * XuE: rows of exchange cells overlapping changed cells
+       * IvE: rows of changed cells, plus rows within smoothing
+         distance of them if sigma is set.  If that neighborhood is
+         too large, IvE is recomputed.
+    Patching requires that every row/column of the unscaled matrices
+    depends on just one ice grid cell, which is only true for
+    GCMRegridder_Standard; other GCMRegridders are always recomputed.
+    @param rc The cache to update; allocated if null
+    @param sigma Smoothing used for IvE */
+    static Update update(
+        std::unique_ptr<RegridCache> &rc,
+        GCMRegridder const *gcmr,
+        int sheet_index,
+        blitz::Array<double,1> const &emI_ice,
+        std::array<double,3> const &sigma,
+        double max_patch_fraction);
+};
+
+}    // namespace icebin
+#endif    // guard
@@ -46,14 +46,65 @@ struct UrAE {
 
 
 
+// ------------------------------------------------------------
+/** Densified Ur matrix GvAp (or GvEp), via the cache.
+@param Igrid Identity of G: 'I' (dimG is the interpolation grid) or 'X' */
+static EigenSparseMatrixT const &ur_GvAp(
+    UrCache *cache,
+    UrAE const &AE,
+    char Igrid,
+    SparseSetT *dimG,
+    SparseSetT *dimA,
+    bool include_zero = true)
+{
+    return cache->matrix(
+        AE.name + ".GvAp." + Igrid + (include_zero ? "" : ".nz"),
+        {dimG, dimA},
+        [&]() { return MakeDenseEigenT(
+            AE.GvAp,
+            {SparsifyTransform::ADD_DENSE},
+            {dimG, dimA}, '.', include_zero).to_eigen(); });
+}
+
+/** Densified Ur matrix GvI, via the cache */
+static EigenSparseMatrixT const &ur_GvI(
+    UrCache *cache,
+    IceRegridder const *regridder,
+    blitz::Array<double,1> const *elevmaskI,
+    std::vector<int> const *idsX,
+    SparseSetT *dimG,
+    SparseSetT *dimI)
+{
+    return cache->matrix("GvI", {dimG, dimI},
+        [&]() { return MakeDenseEigenT(
+            // Only includes ice model grid cells with ice in them.
+            std::bind(&IceRegridder::GvI, regridder, _1, 'X', elevmaskI, idsX),
+            {SparsifyTransform::ADD_DENSE},
+            {dimG, dimI}, '.').to_eigen(); });
+}
+
+/** Densified diagonal matrix sApvA (or sEpvE), via the cache */
+static EigenSparseMatrixT const &ur_sApvA(
+    UrCache *cache,
+    UrAE const &AE,
+    SparseSetT *dimA)
+{
+    return cache->matrix(AE.name + ".sApvA", {dimA, dimA},
+        [&]() { return MakeDenseEigenT(
+            AE.sApvA,
+            {SparsifyTransform::TO_DENSE_IGNORE_MISSING},
+            {dimA, dimA}, '.').to_eigen(); });
+}
 // ------------------------------------------------------------
 static std::unique_ptr<linear::Weighted_Eigen> compute_AEvI(
     IceRegridder const *regridder,
     std::array<SparseSetT *,2> dims,
     RegridParams const &params,
     blitz::Array<double,1> const *elevmaskI,
+    std::vector<int> const *idsX,    // Exchange grid cells to visit; nullptr for all
     char Igrid,        // Identity of I in "AEvI": 'I' or 'X'
-    UrAE const &AE)
+    UrAE const &AE,
+    UrCache *cache)
 {
     // if Igrid=='X', then references to I in this
     // function are actually X (exchdnage grid).
@@ -63,8 +114,7 @@ printf("BEGIN compute_AEvI scale=%d correctA=%d\n", params.scale, params.correct
     std::unique_ptr<linear::Weighted_Eigen> ret(new linear::Weighted_Eigen(dims, true));
     SparseSetT * const dimA(ret->dims[0]);
     SparseSetT * const dimI(ret->dims[1]);
-    SparseSetT _dimG;
-    SparseSetT * const dimG(&_dimG);
+    SparseSetT * const dimG(&cache->dimG);
 
     if (dimA) dimA->set_sparse_extent(AE.nfull);
     if (dimI) dimI->set_sparse_extent(
@@ -72,42 +122,29 @@ printf("BEGIN compute_AEvI scale=%d correctA=%d\n", params.scale, params.correct
     dimG->set_sparse_extent(regridder->nX());
 
     // ----- Get the Ur matrices (which determines our dense dimensions)
-    std::unique_ptr<EigenSparseMatrixT> ApvG(new EigenSparseMatrixT(
-    MakeDenseEigenT(
-        // Only includes ice model grid cells with ice in them.
-        AE.GvAp,
-        {SparsifyTransform::ADD_DENSE},
-        std::array<SparseSetT *,2>{Igrid=='I' ? dimG : dimI, dimA},
-        'T').to_eigen()));
-
-    // ----- Convert to Eigen and multiply
-    std::unique_ptr<EigenSparseMatrixT> ApvI;
-    if (Igrid == 'I') {
-        EigenSparseMatrixT GvI(MakeDenseEigenT(
+    // ----- and multiply
+    EigenSparseMatrixT const &ApvI(cache->matrix(
+        AE.name + ".ApvI." + Igrid, {dimA, dimI},
+        [&]() -> EigenSparseMatrixT {
             // Only includes ice model grid cells with ice in them.
-            std::bind(&IceRegridder::GvI, regridder, _1, 'X', elevmaskI),
-            {SparsifyTransform::ADD_DENSE},
-            {dimG, dimI}, '.').to_eigen());
-        auto sGvI(sum(GvI, 0, '-'));
+            EigenSparseMatrixT const &GvAp(ur_GvAp(cache, AE, Igrid,
+                Igrid=='I' ? dimG : dimI, dimA));
+            if (Igrid != 'I') return EigenSparseMatrixT(GvAp.transpose());
 
-        ApvI.reset(new EigenSparseMatrixT(
-            *ApvG * map_eigen_diagonal(sGvI) * GvI));
-        ApvG.release();
-    } else {
-        ApvI = std::move(ApvG);
-    }
+            EigenSparseMatrixT const &GvI(ur_GvI(cache, regridder, elevmaskI, idsX, dimG, dimI));
+            auto sGvI(sum(GvI, 0, '-'));
+            return EigenSparseMatrixT(
+                GvAp.transpose() * map_eigen_diagonal(sGvI) * GvI);
+        }));
 
-    ret->Mw.reference(sum(*ApvI, 1, '+'));    // Area of I cells
+    ret->Mw.reference(sum(ApvI, 1, '+'));    // Area of I cells
 
     // ----- Apply final scaling, and convert back to sparse dimension
     if (params.correctA) {
         // ----- Compute the final weight matrix
-        auto wAvAp(MakeDenseEigenT(                   // diagonal
-            AE.sApvA,
-            {SparsifyTransform::TO_DENSE_IGNORE_MISSING},
-            {dimA, dimA}, '.').to_eigen());
+        EigenSparseMatrixT const &wAvAp(ur_sApvA(cache, AE, dimA));    // diagonal
 
-        auto wApvI(sum(*ApvI, 0, '+'));        // diagonal
+        auto wApvI(sum(ApvI, 0, '+'));        // diagonal
 
         EigenSparseMatrixT wAvI(wAvAp * map_eigen_diagonal(wApvI));    // diagonal...
 
@@ -121,28 +158,28 @@ printf("BEGIN compute_AEvI scale=%d correctA=%d\n", params.scale, params.correct
             blitz::Array<double,1> sApvI(invert1(wApvI));
             blitz::Array<double,1> mul(sAvAp * sApvI);
             ret->M.reset(new EigenSparseMatrixT(
-                map_eigen_diagonal(mul) * *ApvI));    // AvI_scaled
+                map_eigen_diagonal(mul) * ApvI));    // AvI_scaled
         } else {
             // Should be like this for test_conserv.py
             // Note that sAvAp * sApvI = [size (weight) of grid cells in A]
-            ret->M = std::move(ApvI);
+            ret->M.reset(new EigenSparseMatrixT(ApvI));
         }
 
     } else {
 
         // ----- Compute the final weight matrix
         // ~correctA: Weight matrix in Ap space
-        auto wApvI_b(sum(*ApvI, 0, '+'));
+        auto wApvI_b(sum(ApvI, 0, '+'));
         ret->wM.reference(wApvI_b);
 
         if (params.scale) {
             // Get two diagonal Eigen scale matrices
-            auto sApvI(sum(*ApvI, 0, '-'));
+            auto sApvI(sum(ApvI, 0, '-'));
 
             ret->M.reset(new EigenSparseMatrixT(
-                map_eigen_diagonal(sApvI) * *ApvI));    // ApvI_scaled
+                map_eigen_diagonal(sApvI) * ApvI));    // ApvI_scaled
         } else {
-            ret->M = std::move(ApvI);
+            ret->M.reset(new EigenSparseMatrixT(ApvI));
         }
     }
 
@@ -156,8 +193,10 @@ std::unique_ptr<linear::Weighted_Eigen> compute_IvAE(
     std::array<SparseSetT *,2> dims,
     RegridParams const &params,
     blitz::Array<double,1> const *elevmaskI,
+    std::vector<int> const *idsX,    // Exchange grid cells to visit; nullptr for all
     char Igrid,        // Identity of I in "AEvI": 'I' or 'X'
-    UrAE const &AE)
+    UrAE const &AE,
+    UrCache *cache)
 {
     // if Igrid=='X', then references to I in this
     // function are actually X (exchdnage grid).
@@ -166,8 +205,7 @@ std::unique_ptr<linear::Weighted_Eigen> compute_IvAE(
 //printf("BEGIN compute_IvAE\n");
     std::unique_ptr<linear::Weighted_Eigen> ret(new linear::Weighted_Eigen(dims, !params.smooth()));
     SparseSetT * const dimA(ret->dims[1]);    SparseSetT * const dimI(ret->dims[0]);
-    SparseSetT _dimG;
-    SparseSetT * const dimG(&_dimG);
+    SparseSetT * const dimG(&cache->dimG);
 
     if (dimA) dimA->set_sparse_extent(AE.nfull);
     if (dimI) dimI->set_sparse_extent(
@@ -175,61 +213,51 @@ std::unique_ptr<linear::Weighted_Eigen> compute_IvAE(
     dimG->set_sparse_extent(regridder->nX());
 
     // ----- Get the Ur matrices (which determines our dense dimensions)
-    std::unique_ptr<EigenSparseMatrixT> GvAp(new EigenSparseMatrixT(
-    MakeDenseEigenT(
-        AE.GvAp,
-        {SparsifyTransform::ADD_DENSE},
-        std::array<SparseSetT *,2>{Igrid=='I' ? dimG : dimI, dimA},
-        '.').to_eigen()));
-
-    std::unique_ptr<EigenSparseMatrixT> IvAp;
-    if (Igrid == 'I') {
-        EigenSparseMatrixT IvG(MakeDenseEigenT(
-            std::bind(&IceRegridder::GvI, regridder, _1, 'X', elevmaskI),
-            {SparsifyTransform::ADD_DENSE},
-            {dimG, dimI}, 'T').to_eigen());
+    // ----- and multiply
+    EigenSparseMatrixT const &IvAp(cache->matrix(
+        AE.name + ".IvAp." + Igrid, {dimI, dimA},
+        [&]() -> EigenSparseMatrixT {
+            EigenSparseMatrixT const &GvAp(ur_GvAp(cache, AE, Igrid,
+                Igrid=='I' ? dimG : dimI, dimA));
+            if (Igrid != 'I') return GvAp;
 
-        auto sGvAp(sum(*GvAp, 0, '-'));
-        IvAp.reset(new EigenSparseMatrixT(
-            IvG * map_eigen_diagonal(sGvAp) * *GvAp));
-    } else {
-        IvAp = std::move(GvAp);
-    }
+            EigenSparseMatrixT const &GvI(ur_GvI(cache, regridder, elevmaskI, idsX, dimG, dimI));
+            auto sGvAp(sum(GvAp, 0, '-'));
+            return EigenSparseMatrixT(
+                GvI.transpose() * map_eigen_diagonal(sGvAp) * GvAp);
+        }));
 
 
     // Get weight vector from IvAp_e
-    ret->wM.reference(sum(*IvAp, 0, '+'));
+    ret->wM.reference(sum(IvAp, 0, '+'));
 
     // ----- Apply final scaling, and convert back to sparse dimension
     if (params.correctA) {
         // Scaling matrix
-        auto sApvA(MakeDenseEigenT(
-            AE.sApvA,
-            {SparsifyTransform::TO_DENSE_IGNORE_MISSING},
-            {dimA, dimA}, '.').to_eigen());
+        EigenSparseMatrixT const &sApvA(ur_sApvA(cache, AE, dimA));
 
         // Compute area of A grid cells
-        auto IvApw(sum(*IvAp, 1, '+'));    // Area of A cells
+        auto IvApw(sum(IvAp, 1, '+'));    // Area of A cells
         auto &wAvAp(sApvA);    // Symmetry: wAvAp == sApvA
         EigenSparseMatrixT Aw(wAvAp * map_eigen_diagonal(IvApw));
         ret->Mw.reference(sum(Aw,0,'+'));
 
         if (params.scale) {
-            auto sIvAp(sum(*IvAp, 0, '-'));
+            auto sIvAp(sum(IvAp, 0, '-'));
             ret->M.reset(new EigenSparseMatrixT(
-                map_eigen_diagonal(sIvAp) * *IvAp * sApvA));
+                map_eigen_diagonal(sIvAp) * IvAp * sApvA));
         } else {
             ret->M.reset(new EigenSparseMatrixT(
-                *IvAp * sApvA));
+                IvAp * sApvA));
         }
     } else {
-        ret->Mw.reference(sum(*IvAp, 1, '+'));    // Area of A cells
+        ret->Mw.reference(sum(IvAp, 1, '+'));    // Area of A cells
         if (params.scale) {
-            auto sIvAp(sum(*IvAp, 0, '-'));
+            auto sIvAp(sum(IvAp, 0, '-'));
             ret->M.reset(new EigenSparseMatrixT(
-                map_eigen_diagonal(sIvAp) * *IvAp));
+                map_eigen_diagonal(sIvAp) * IvAp));
         } else {
-            ret->M = std::move(IvAp);
+            ret->M.reset(new EigenSparseMatrixT(IvAp));
         }
     }
 
@@ -253,58 +281,44 @@ std::unique_ptr<linear::Weighted_Eigen> compute_IvAE(
 
 static std::unique_ptr<linear::Weighted_Eigen> compute_EvA(IceRegridder const *regridder,
     std::array<SparseSetT *,2> dims,
-    RegridParams const &params, UrAE const &E, UrAE const &A)
+    RegridParams const &params, UrAE const &E, UrAE const &A,
+    UrCache *cache)
 {
     std::unique_ptr<linear::Weighted_Eigen> ret(new linear::Weighted_Eigen(dims, true));
     SparseSetT * const dimE(ret->dims[0]);
     SparseSetT * const dimA(ret->dims[1]);
-    SparseSetT _dimG;
-    SparseSetT * const dimG(&_dimG);
+    SparseSetT * const dimG(&cache->dimG);
 
     if (dimA) dimA->set_sparse_extent(A.nfull);
     if (dimE) dimE->set_sparse_extent(E.nfull);
     dimG->set_sparse_extent(regridder->nG('X'));
 
     // ----- Get the Ur matrices (which determines our dense dimensions)
-
-    MakeDenseEigenT GvAp_m(
-        A.GvAp,
-        {SparsifyTransform::ADD_DENSE},
-        {dimG, dimA}, '.', false);   // include_zero=false
-    MakeDenseEigenT EpvG_m(
-        E.GvAp,
-        {SparsifyTransform::ADD_DENSE},
-        {dimG, dimE}, 'T', false);    // include_zero=false
-
-    // ----- Convert to Eigen and multiply
-    auto GvAp(GvAp_m.to_eigen());
-    auto EpvG(EpvG_m.to_eigen());
-
-    auto sGvAp(sum(GvAp, 0, '-'));
-
-    // Unweighted matrix
-    std::unique_ptr<EigenSparseMatrixT> EpvAp(
-        new EigenSparseMatrixT(EpvG * map_eigen_diagonal(sGvAp) * GvAp));
+    // ----- and multiply
+    EigenSparseMatrixT const &EpvAp(cache->matrix(
+        E.dim_name + "pv" + A.dim_name + "p", {dimE, dimA},
+        [&]() -> EigenSparseMatrixT {
+            EigenSparseMatrixT const &GvAp(ur_GvAp(cache, A, 'X', dimG, dimA, false));  // include_zero=false
+            EigenSparseMatrixT const &GvEp(ur_GvAp(cache, E, 'X', dimG, dimE, false));  // include_zero=false
+
+            // Unweighted matrix
+            auto sGvAp(sum(GvAp, 0, '-'));
+            return EigenSparseMatrixT(
+                GvEp.transpose() * map_eigen_diagonal(sGvAp) * GvAp);
+        }));
 
     // ----- Apply final scaling, and convert back to sparse dimension
-    auto wEpvAp(sum(*EpvAp,0,'+'));
+    auto wEpvAp(sum(EpvAp,0,'+'));
     if (params.correctA) {
-        auto sApvA(MakeDenseEigenT(
-            A.sApvA,
-            {SparsifyTransform::TO_DENSE_IGNORE_MISSING},
-            {dimA, dimA}, '.').to_eigen());
-
-        auto wEvEp(MakeDenseEigenT(
-            E.sApvA,
-            {SparsifyTransform::TO_DENSE_IGNORE_MISSING},
-            {dimE, dimE}, '.').to_eigen());
+        EigenSparseMatrixT const &sApvA(ur_sApvA(cache, A, dimA));
+        EigenSparseMatrixT const &wEvEp(ur_sApvA(cache, E, dimE));
 
         // +correctA: Weight matrix in E space
         EigenSparseMatrixT wEvAp(wEvEp * map_eigen_diagonal(wEpvAp));
         ret->wM.reference(sum(wEvAp,0,'+'));
 
         // Compute area of A cells
-        auto EpvApw(sum(*EpvAp,1,'+'));
+        auto EpvApw(sum(EpvAp,1,'+'));
         auto &wAvAp(sApvA);    // Symmetry: wAvAp == sApvA
         EigenSparseMatrixT Aw(wAvAp * map_eigen_diagonal(EpvApw));
         ret->Mw.reference(sum(Aw,0,'+'));
@@ -312,19 +326,19 @@ static std::unique_ptr<linear::Weighted_Eigen> compute_EvA(IceRegridder const *r
         if (params.scale) {
             auto sEvAp(sum(wEvAp,0,'-'));
             ret->M.reset(new EigenSparseMatrixT(
-                map_eigen_diagonal(sEvAp) * *EpvAp * sApvA));    // EvA
+                map_eigen_diagonal(sEvAp) * EpvAp * sApvA));    // EvA
         } else {
-            ret->M.reset(new EigenSparseMatrixT(*EpvAp * sApvA));
+            ret->M.reset(new EigenSparseMatrixT(EpvAp * sApvA));
         }
     } else {    // ~correctA
         // ~correctA: Weight matrix in Ep space
         ret->wM.reference(wEpvAp);
-        ret->Mw.reference(sum(*EpvAp,1,'+'));
+        ret->Mw.reference(sum(EpvAp,1,'+'));
         if (params.scale) {
             blitz::Array<double,1> sEpvAp(invert1(wEpvAp));
-            ret->M.reset(new EigenSparseMatrixT(map_eigen_diagonal(sEpvAp) * *EpvAp));
+            ret->M.reset(new EigenSparseMatrixT(map_eigen_diagonal(sEpvAp) * EpvAp));
         } else {
-            ret->M = std::move(EpvAp);
+            ret->M.reset(new EigenSparseMatrixT(EpvAp));
         }
     }
 
@@ -335,6 +349,15 @@ std::unique_ptr<RegridMatrices_Dynamic> GCMRegridder_Standard::regrid_matrices(
     int sheet_index,
     blitz::Array<double,1> const &_elevmaskI,
     RegridParams const &params) const
+{
+    return regrid_matrices(sheet_index, _elevmaskI, nullptr, params);
+}
+
+std::unique_ptr<RegridMatrices_Dynamic> GCMRegridder_Standard::regrid_matrices(
+    int sheet_index,
+    blitz::Array<double,1> const &_elevmaskI,
+    std::vector<long> const *cellsI,
+    RegridParams const &params) const
 {
     IceRegridder const *regridder = &*ice_regridders()[sheet_index];
 
@@ -350,44 +373,49 @@ std::unique_ptr<RegridMatrices_Dynamic> GCMRegridder_Standard::regrid_matrices(
     std::unique_ptr<RegridMatrices_Dynamic> rm(
         new RegridMatrices_Dynamic(regridder, params));
     auto &elevmaskI(rm->tmp.take(blitz::Array<double,1>(_elevmaskI)));
+    UrCache * const cache(rm->ur_cache.get());
+
+    // Restrict the Ur matrices to exchange grid cells overlapping cellsI
+    std::vector<int> const *idsX = (!cellsI ? nullptr :
+        &rm->tmp.take(regridder->idsX(*cellsI)));
 
     UrAE urA("A", this->nA(),
-        std::bind(&IceRegridder::GvAp, regridder, _1, 'X', &elevmaskI),
+        std::bind(&IceRegridder::GvAp, regridder, _1, 'X', &elevmaskI, idsX),
         std::bind(&IceRegridder::sApvA, regridder, _1));
 
     UrAE urE("E", this->nE(),
-        std::bind(&IceRegridder::GvEp, regridder, _1, 'X', &elevmaskI),
+        std::bind(&IceRegridder::GvEp, regridder, _1, 'X', &elevmaskI, idsX),
         std::bind(&IceRegridder::sEpvE, regridder, _1));
 
     // ------- AvI, IvA
     rm->add_regrid("AvI",
-        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, 'I', urA));
+        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, idsX, 'I', urA, cache));
     rm->add_regrid("IvA",
-        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, 'I', urA));
+        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, idsX, 'I', urA, cache));
 
     // ------- AvG, GvA
     rm->add_regrid("AvX",
-        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, 'X', urA));
+        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, idsX, 'X', urA, cache));
     rm->add_regrid("XvA",
-        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, 'X', urA));
+        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, idsX, 'X', urA, cache));
 
     // ------- EvI, IvE
     rm->add_regrid("EvI",
-        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, 'I', urE));
+        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, idsX, 'I', urE, cache));
     rm->add_regrid("IvE",
-        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, 'I', urE));
+        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, idsX, 'I', urE, cache));
 
     // ------- EvG, GvE
     rm->add_regrid("EvX",
-        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, 'X', urE));
+        std::bind(&compute_AEvI, regridder, _1, _2, &elevmaskI, idsX, 'X', urE, cache));
     rm->add_regrid("XvE",
-        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, 'X', urE));
+        std::bind(&compute_IvAE, regridder, _1, _2, &elevmaskI, idsX, 'X', urE, cache));
 
     // ------- EvA, AvE regrids.insert(make_pair("EvA", std::bind(&compute_EvA, regridder, _1, _2, urE, urA) ));
     rm->add_regrid("EvA",
-        std::bind(&compute_EvA, regridder, _1, _2, urE, urA));
+        std::bind(&compute_EvA, regridder, _1, _2, urE, urA, cache));
     rm->add_regrid("AvE",
-        std::bind(&compute_EvA, regridder, _1, _2, urA, urE));
+        std::bind(&compute_EvA, regridder, _1, _2, urA, urE, cache));
 
 #if 0
     // ----- Show what we have!
@@ -402,6 +430,50 @@ std::unique_ptr<RegridMatrices_Dynamic> GCMRegridder_Standard::regrid_matrices(
 }
 // -----------------------------------------------------------------------
 // ----------------------------------------------------------------
+UrCache::DimState UrCache::dim_state(SparseSetT const *dim) const
+{
+    DimState ret{dim, 0, 0, -1, version};
+    if (!dim) return ret;
+
+    ret.sparse_extent = dim->sparse_extent();
+    ret.dense_extent = dim->dense_extent();
+    if (ret.dense_extent > 0) ret.last_sparse = dim->to_sparse(ret.dense_extent-1);
+    return ret;
+}
+
+EigenSparseMatrixT const &UrCache::matrix(
+    std::string const &key,
+    std::array<SparseSetT *,2> const &dims,
+    std::function<EigenSparseMatrixT()> const &fn)
+{
+    auto ii(matrices.find(key));
+    if (ii != matrices.end()
+        && ii->second.dims[0] == dim_state(dims[0])
+        && ii->second.dims[1] == dim_state(dims[1]))
+    {
+        ++hits;
+        return *ii->second.val;
+    }
+
+    // Not found, or dims changed since it was computed.
+    // (fn() can add to the cache itself, so call it first.)
+    ++misses;
+    std::unique_ptr<EigenSparseMatrixT> val(new EigenSparseMatrixT(fn()));
+    Entry<EigenSparseMatrixT> &entry(matrices[key]);
+    entry.val = std::move(val);
+    entry.dims = {dim_state(dims[0]), dim_state(dims[1])};
+    return *entry.val;
+}
+
+void UrCache::clear()
+{
+    ++version;
+    matrices.clear();
+    dimG.clear();
+    hits = 0;
+    misses = 0;
+}
+// ----------------------------------------------------------------
 void RegridMatrices_Dynamic::add_regrid(std::string const &spec,
     RegridMatrices_Dynamic::MatrixFunction const &regrid)
 {
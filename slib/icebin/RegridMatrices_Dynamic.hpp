@@ -2,6 +2,8 @@
 #define ICEBIN_REGRID_MATRICES_DYNAMIC_HPP
 
 #include <unordered_set>
+#include <map>
+#include <functional>
 #include <ibmisc/netcdf.hpp>
 #include <ibmisc/memory.hpp>
 #include <ibmisc/linear/eigen.hpp>
@@ -13,6 +15,77 @@ namespace icebin {
 
 class IceRegridder;
 
+// -----------------------------------------------------------
+/** Memoizes the densified Ur matrices (GvAp, GvEp, GvI), and
+intermediate products computed from them, so they may be shared
+between the regrid matrices of a single RegridMatrices_Dynamic
+(i.e. a single elevmaskI).  For example, EvI, AvI, IvE and XvE all
+use GvI or GvEp.
+
+Entries are densified against SparseSets supplied by the caller; an
+entry is only re-used if those SparseSets have not changed since it
+was computed.  Otherwise, it is recomputed and replaced.
+
+Checking that is O(1).  It relies on SparseSets only being appended
+to (add_dense()), which shows up as a change in extent.  Anyone who
+changes a SparseSet in any other way (eg clear() and refill it) while
+the cache is in use must call dims_changed(). */
+class UrCache {
+    /** Summary of a SparseSet, used to tell if it has changed */
+    struct DimState {
+        SparseSetT const *dim;
+        long sparse_extent;
+        long dense_extent;
+        long last_sparse;    // Sparse index of the last dense index
+        long version;        // UrCache::version when this was taken
+
+        bool operator==(DimState const &other) const
+        {
+            return dim == other.dim && sparse_extent == other.sparse_extent
+                && dense_extent == other.dense_extent
+                && last_sparse == other.last_sparse && version == other.version;
+        }
+    };
+    DimState dim_state(SparseSetT const *dim) const;
+
+    /** Bumped by dims_changed(); invalidates every entry */
+    long version = 0;
+
+    template<class ValT>
+    struct Entry {
+        std::array<DimState,2> dims;    // State of dims after computing val
+        std::unique_ptr<ValT> val;
+    };
+
+    std::map<std::string, Entry<EigenSparseMatrixT>> matrices;
+
+public:
+    /** Statistics: number of lookups satisfied from / not in the cache */
+    long hits = 0;
+    long misses = 0;
+
+    /** Interpolation grid G.  It is internal to the regrid matrix
+    computations (always multiplied away), and shared between them so
+    that matrices densified against it can be re-used. */
+    SparseSetT dimG;
+
+    /** Looks up (or computes and stores) a matrix.
+    @param key Unique name of this matrix, for this elevmaskI
+    @param dims Dimensions the matrix is densified against
+    @param fn Computes the matrix; may add to dims.
+    @return Reference to the cached matrix; valid until the next
+        time an entry with the same key is replaced. */
+    EigenSparseMatrixT const &matrix(
+        std::string const &key,
+        std::array<SparseSetT *,2> const &dims,
+        std::function<EigenSparseMatrixT()> const &fn);
+
+    /** Must be called after any SparseSet this cache has seen is
+    changed other than by appending to it. */
+    void dims_changed() { ++version; }
+
+    void clear();
+};
 
 // -----------------------------------------------------------
 /** Holds the set of "Ur" (original) matrices produced by an
@@ -24,6 +97,10 @@ public:
 
     ibmisc::TmpAlloc tmp;    // Stores local vars for different types.  TODO: Maybe re-do this as simple classmember variables.  At least, see where it used (by removing it and running the compiler)
 
+    /** Ur matrices and products shared between the regrids below.
+    Held by pointer so it stays put if this object is moved. */
+    std::unique_ptr<UrCache> ur_cache;
+
     typedef std::function<std::unique_ptr<ibmisc::linear::Weighted_Eigen>(
         std::array<SparseSetT *,2> dims, RegridParams const &params)> MatrixFunction;
 
@@ -32,7 +109,8 @@ public:
     RegridMatrices_Dynamic(
         IceRegridder const *_ice_regridder,
         RegridParams const &params)
-    : RegridMatrices(params), ice_regridder(_ice_regridder) {}
+    : RegridMatrices(params), ice_regridder(_ice_regridder),
+    ur_cache(new UrCache) {}
 
     void add_regrid(std::string const &spec,
         MatrixFunction const &regrid);
@@ -40,6 +40,9 @@ struct Vtable : public std::map<
 #if defined(BUILD_MODELE) && defined(USE_PISM)
     extern void setup_modele_pism(GCMCoupler const *, IceCoupler *);
 #endif
+#if defined(BUILD_MODELE)
+    extern void setup_modele_dismal(GCMCoupler const *, IceCoupler *);
+#endif
 
 Vtable::Vtable()
 {
@@ -51,6 +54,13 @@ Vtable::Vtable()
         std::make_pair(GCMCoupler::Type::MODELE, IceCoupler::Type::PISM),
         std::move(entry)));
 #endif
+
+#if defined(BUILD_MODELE)
+    entry.setup = &setup_modele_dismal;
+    insert(std::make_pair(
+        std::make_pair(GCMCoupler::Type::MODELE, IceCoupler::Type::DISMAL),
+        std::move(entry)));
+#endif
 }
 // -------------------------------------------
 static Vtable vtable;
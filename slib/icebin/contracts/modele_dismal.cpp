@@ -17,108 +17,132 @@
  */
 
 #include <mpi.h>        // Must be first
+#include <limits>
+#include <ibmisc/VarTransformer.hpp>
+#include <icebin/contracts/contracts.hpp>
+#include <icebin/modele/GCMCoupler_ModelE.hpp>
+#include <icebin/dismal/IceCoupler_DISMAL.hpp>
 
-#include <glint2/IceModel_DISMAL.hpp>
-#include <glint2/modele/GCMCoupler_ModelE.hpp>
-#include <giss/exit.hpp>
-
-using namespace giss;
-using namespace glint2::modele;
+using namespace ibmisc;
+using namespace icebin::modele;
 
 // --------------------------------------------------------
-namespace glint2 {
+namespace icebin {
+namespace contracts {
 
+// Aliases
+static auto const &UNIT(VarTransformer::UNIT);
+static auto const &INPUT(IceCoupler::INPUT);
 static double const nan = std::numeric_limits<double>::quiet_NaN();
 
-/** GCM-specific contract */
-void IceModel_DISMAL::setup_contracts_modele()
+static void _reconstruct_ice_ivalsI(
+    GCMCoupler_ModelE const *gcm_coupler,
+    dismal::IceCoupler_DISMAL const *ice_coupler,
+    blitz::Array<double,2> &ice_ivalsI,
+    double dt)
+{
+    // Eliminate SMB if we're told to not use it.
+    if (!gcm_coupler->use_smb) {
+        ice_ivalsI(ice_coupler->contract[INPUT].index.at("massxfer"), blitz::Range::all()) = 0;
+        ice_ivalsI(ice_coupler->contract[INPUT].index.at("enthxfer"), blitz::Range::all()) = 0;
+    }
+}
+
+/** GCM-specific contract.  Same GCM-side variables as modele_pism,
+but only the ones DISMAL can produce. */
+void setup_modele_dismal(GCMCoupler const *_gcm_coupler, IceCoupler *_ice_coupler)
 {
     // Get arguments we need from coupler
-    auto coupler(dynamic_cast<GCMCoupler_ModelE const *>(this->coupler));
+    auto gcm_coupler(dynamic_cast<modele::GCMCoupler_ModelE const *>(_gcm_coupler));
+    auto ice_coupler(dynamic_cast<icebin::dismal::IceCoupler_DISMAL *>(_ice_coupler));
 
-    printf("BEGIN IceModel_DISMAL::setup_contract_modele\n");
-    IceModel &model(*this);
+    printf("BEGIN setup_modele_dismal()\n");
 
-    // Don't bother transferring any constants...
+    ice_coupler->reconstruct_ice_ivalsI = std::bind(
+        &_reconstruct_ice_ivalsI,
+        gcm_coupler, ice_coupler, std::placeholders::_1, std::placeholders::_2);
+
+    // =========== Constants used by DISMAL
+    double const RHOI = gcm_coupler->gcm_constants.get_as("constant::rhoi", "kg m-3");
+    double const SHI = gcm_coupler->gcm_constants.get_as("constant::shi", "J kg-1 K-1");
+    double const LHM = gcm_coupler->gcm_constants.get_as("constant::lhm", "J kg-1");
+    ice_coupler->rhoi = RHOI;
+    // Top of the ice sheet is solid ice at -10C, in ModelE's
+    // enthalpy convention (0 = liquid water at 0C)
+    ice_coupler->ice_top_senth = SHI * -10. - LHM;
 
     // ============ GCM -> Ice
-    CouplingContract &ice_input(contract[IceModel::INPUT]);
-
-    std::string const MASS_FLUX = "smb_mass";
-    std::string const ENTHALPY_FLUX = "smb_enth";
-    std::string const T = "surface_temp";
-    std::string const HEAT_FLUX = "heat_flux";  // Positive is down
-
-    // ------ Decide on the coupling contract for this ice sheet
-    ice_input.add_field(MASS_FLUX, nan, "kg m-2 s-1");
-    ice_input.add_field(ENTHALPY_FLUX, nan, "W m-2");
-    switch(params->coupling_type.index()) {
-        case ModelE_CouplingType::DIRICHLET_BC :
-            ice_input.add_field(T, nan, "K");
-        break;
-        case ModelE_CouplingType::NEUMANN_BC :
-            ice_input.add_field(HEAT_FLUX, nan, "W m-2");
-        break;
-    }
+    VarSet &ice_input(ice_coupler->contract[IceCoupler::INPUT]);
+
+    ice_input.add("massxfer", 0., "kg m-2 s-1", "kg m-2 day-1", 0,
+        "Mass of ice being transferred Stieglitz --> Icebin");
+    ice_input.add("enthxfer", 0., "W m-2", "", 0,
+        "Enthalpy of ice being transferred Stieglitz --> Icebin");
 
-    // ------------- Convert the contract to a var transformer
-    VarTransformer &ice_input_vt(var_transformer[IceModel::INPUT]);
-    ice_input_vt.set_names(VarTransformer::INPUTS, &coupler->gcm_outputs);
-    ice_input_vt.set_names(VarTransformer::OUTPUTS, &ice_input);
-    ice_input_vt.set_names(VarTransformer::SCALARS, &coupler->ice_input_scalars);
-    ice_input_vt.allocate();
-
-    // Add some recipes for gcm_to_ice
-    double const enth_modele_to_pism = 437000;      // Taken from run with PISM
-    std::string out;
     bool ok = true;
-    ok = ok && ice_input_vt.set(MASS_FLUX, "lismb", "unit", 1.0);
-
-    ok = ok && ice_input_vt.set(ENTHALPY_FLUX, "liseb", "unit", 1.0);
-    ok = ok && ice_input_vt.set(ENTHALPY_FLUX, "lismb", "unit", enth_modele_to_pism);
-
-    switch(params->coupling_type.index()) {
-        case ModelE_CouplingType::DIRICHLET_BC :
-            ok = ok && ice_input_vt.set(T, "litg2", "unit", 1.0);
-            ok = ok && ice_input_vt.set(T, "unit", "unit", C2K);    // +273.15
-        break;
-        case ModelE_CouplingType::NEUMANN_BC :
-// Nothing for now...
-//          ok = ok && ice_input_vt.set(HEAT_FLUX, "liseb", "unit", 1.0);
-        break;
+
+    // ------------- Convert the contract to a var transformer
+    // ------------- of I <- E   (Ice <- GCM)
+    {VarTransformer &vt(ice_coupler->var_trans_inE);
+    vt.set_dims(
+        ice_input.keys(),             // outputs
+        gcm_coupler->gcm_outputsE.keys(),  // inputs
+        gcm_coupler->scalars.keys());      // scalars
+
+    ok = ok && vt.set("massxfer", "massxfer", UNIT, 1.0);
+    ok = ok && vt.set("enthxfer", "enthxfer", UNIT, 1.0);
     }
 
+    // ============== Ice -> GCM
+    VarSet &ice_output(ice_coupler->contract[IceCoupler::OUTPUT]);
+    auto &standard_names(ice_coupler->standard_names[IceCoupler::OUTPUT]);
 
-    // ============== Ice -> GCM (none)
-    CouplingContract &ice_output(contract[IceModel::OUTPUT]);
+    ice_output.add("ice_top_elevation", nan, "m", "", contracts::INITIAL, "ice upper surface elevation");
 
-    // Outputs (Ice -> GCM) are same fields as inputs
-    CouplingContract *gcm_inputs = new_CouplingContract();
-    for (auto ii = ice_output.begin(); ii != ice_output.end(); ++ii) {
-        gcm_inputs->add_field(*ii);
-    }
+    standard_names["elevmask_ice"] =
+    ice_output.add("elevmask_ice", nan, "", "", contracts::INITIAL | contracts::ALLOW_NAN,
+        "Elevation of ice sheet; nan for grid cells off ice sheet.");
 
-    CouplingContract *ice_output_scalars = new_CouplingContract();
-    ice_output_scalars->add_field("unit", nan, "", 0, "");
+    standard_names["elevmask_land"] =
+    ice_output.add("elevmask_land", nan, "", "", contracts::INITIAL | contracts::ALLOW_NAN,
+        "Elevation of bare land+ice; nan for grid cells off land or ice (eg ocean).");
 
-    VarTransformer &ice_output_vt(var_transformer[OUTPUT]);
-    ice_output_vt.set_names(VarTransformer::INPUTS, &ice_output);
-    ice_output_vt.set_names(VarTransformer::OUTPUTS, gcm_inputs);
-    ice_output_vt.set_names(VarTransformer::SCALARS, ice_output_scalars);
-    ice_output_vt.allocate();
+    ice_output.add("ice_top_senth", nan, "J kg-1", "", contracts::INITIAL, "");
 
-    // Set up transformations: just copy inputs to outputs
-    for (auto ii = ice_output.begin(); ii != ice_output.end(); ++ii) {
-        ok = ok && ice_output_vt.set(ii->name, ii->name, "unit", 1.0);
-    }
+    // DISMAL has no mass budget: SMB it receives is returned to the GCM.
+    ice_output.add("smb.mass", nan, "kg m-2 s-1", "kg m-2 day-1", 0,
+        "pass-through SMB from input");
+    ice_output.add("smb.enth", nan, "W m-2", "", 0,
+        "pass-through SMB from input");
+
+    std::cout << "========= Ice Model Outputs (" << ice_coupler->name() << ") modele_dismal.cpp:" << std::endl;
+    std::cout << ice_output << std::endl;
+
+    // ------- Variable and unit conversions, GCM <- Ice
+    {
+    VarTransformer &vtA(ice_coupler->var_trans_outAE[GridAE::A]);
+    VarTransformer &vtE_nc(ice_coupler->var_trans_outAE[GridAE::E]);    // _nc ==> correctA=False
 
-    if (!ok) {
-        printf("modele_dismal.cpp quitting due to errors.\n");
-        giss::exit(1);
+    vtA.set_dims(
+        gcm_coupler->gcm_inputs[(int)IndexAE::A].keys(),    // outputs
+        ice_output.keys(),            // inputs
+        gcm_coupler->scalars.keys());    // scalars
+
+    vtE_nc.set_dims(
+        gcm_coupler->gcm_inputs[(int)IndexAE::E].keys(),    // outputs
+        ice_output.keys(),            // inputs
+        gcm_coupler->scalars.keys());    // scalars
+
+    ok = ok && vtE_nc.set("ice_top_senth", "ice_top_senth", UNIT, 1.0);
+
+    ok = ok && vtA.set("epsilon.mass", "smb.mass", UNIT, 1.0);
+    ok = ok && vtA.set("epsilon.enth", "smb.enth", UNIT, 1.0);
     }
 
-    printf("END IceModel_DISMAL::setup_contract_modele\n");
+    // Catch all our errors at once
+    if (!ok) (*ibmisc_error)(-1,
+        "Error(s) setting up contract modele_dismal.");
+    printf("END setup_modele_dismal()\n");
 }
 
-}       // namespace glint2
-// --------------------------------------------------------
+}}
@@ -0,0 +1,297 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mpi.h>    // For Intel MPI, mpi.h must be included before stdio.h
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <boost/filesystem.hpp>
+
+#include <ibmisc/netcdf.hpp>
+#include <ibmisc/blitz.hpp>
+#include <icebin/GCMCoupler.hpp>
+#include <icebin/ElevMask.hpp>
+#include <icebin/dismal/IceCoupler_DISMAL.hpp>
+#include <icebin/contracts/contracts.hpp>
+
+using namespace ibmisc;
+using namespace netCDF;
+
+namespace icebin {
+namespace dismal {
+
+static double const nan = std::numeric_limits<double>::quiet_NaN();
+
+IceCoupler_DISMAL::IceCoupler_DISMAL(IceCoupler::Params const &_params)
+    : IceCoupler(IceCoupler::Type::DISMAL, _params)
+{
+}
+
+void IceCoupler_DISMAL::ncread(ibmisc::NcIO &ncio_config, std::string const &vname_sheet)
+{
+    IceCoupler::ncread(ncio_config, vname_sheet);
+
+    printf("BEGIN IceCoupler_DISMAL::ncread(%s)\n", vname_sheet.c_str());
+
+    NcVar info_var(ncio_config.nc->getVar(vname_sheet + ".info"));
+    get_or_put_att(info_var, 'r', "output_dir", output_dir);
+
+    // (OPTIONAL) Parameters of the synthetic ice sheet and cost model
+    {auto atts(info_var.getAtts());
+        if (atts.find("elevmask") != atts.end())
+            get_or_put_att(info_var, 'r', "elevmask", elevmask_spec);
+        if (atts.find("dome_height") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "dome_height", "double", &dome_height, 1);
+        if (atts.find("elev_amplitude") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "elev_amplitude", "double", &elev_amplitude, 1);
+        if (atts.find("elev_period") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "elev_period", "double", &elev_period, 1);
+        if (atts.find("evolve_fraction") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "evolve_fraction", "double", &evolve_fraction, 1);
+        if (atts.find("cost_step_s") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "cost_step_s", "double", &cost_step_s, 1);
+        if (atts.find("cost_cell_s") != atts.end())
+            get_or_put_att<NcVar,double>(info_var, 'r', "cost_cell_s", "double", &cost_cell_s, 1);
+        if (atts.find("cost_spin") != atts.end())
+            get_or_put_att<NcVar,int>(info_var, 'r', "cost_spin", "int", &cost_spin, 1);
+    }
+
+    if (evolve_fraction <= 0 || evolve_fraction > 1) (*icebin_error)(-1,
+        "evolve_fraction=%g must be in (0,1]", evolve_fraction);
+    if (elev_period <= 0) (*icebin_error)(-1,
+        "elev_period=%g must be positive", elev_period);
+    if (cost_step_s < 0 || cost_cell_s < 0) (*icebin_error)(-1,
+        "cost_step_s=%g and cost_cell_s=%g must not be negative", cost_step_s, cost_cell_s);
+
+    printf("END IceCoupler_DISMAL::ncread()\n");
+}
+
+// ======================================================================
+void IceCoupler_DISMAL::init_elevation()
+{
+    long const nI = this->nI();
+
+    if (elevmask_spec != "") {
+        read_elevmask(elevmask_spec, elev0_land, elev0_ice);
+        if (elev0_land.extent(0) != nI) (*icebin_error)(-1,
+            "elevmask %s has %d cells, ice grid has %ld",
+            elevmask_spec.c_str(), elev0_land.extent(0), nI);
+    } else {
+        // Parabolic dome, centered on the ice grid and just
+        // reaching its farthest cell.  Cells off the dome are bare land
+        // at sea level; cells not in the grid are masked out.
+        AbbrGrid const &agrid(agridI());
+        long const ndense = agrid.dim.dense_extent();
+        double x0 = 0, y0 = 0;
+        for (int id=0; id<ndense; ++id) {
+            x0 += agrid.centroid_xy(id,0);
+            y0 += agrid.centroid_xy(id,1);
+        }
+        x0 /= ndense;
+        y0 /= ndense;
+        double R2 = 0;
+        for (int id=0; id<ndense; ++id) {
+            double const dx = agrid.centroid_xy(id,0) - x0;
+            double const dy = agrid.centroid_xy(id,1) - y0;
+            R2 = std::max(R2, dx*dx + dy*dy);
+        }
+
+        elev0_land.reference(blitz::Array<double,1>(nI));
+        elev0_ice.reference(blitz::Array<double,1>(nI));
+        elev0_land = nan;
+        elev0_ice = nan;
+        for (int id=0; id<ndense; ++id) {
+            double const dx = agrid.centroid_xy(id,0) - x0;
+            double const dy = agrid.centroid_xy(id,1) - y0;
+            double const r2 = (dx*dx + dy*dy) / R2;
+            long const iI = agrid.dim.to_sparse(id);
+            double const h = (r2 < 1. ? dome_height * std::sqrt(1. - r2) : 0.);
+            elev0_land(iI) = h;
+            if (h > 0) elev0_ice(iI) = h;
+        }
+    }
+
+    nice = 0;
+    for (int iI=0; iI<nI; ++iI) if (!std::isnan(elev0_ice(iI))) ++nice;
+
+    elev_land.reference(blitz::Array<double,1>(elev0_land.copy()));
+    elev_ice.reference(blitz::Array<double,1>(elev0_ice.copy()));
+    smb_dh.reference(blitz::Array<double,1>(nI));
+    smb_dh = 0;
+    step = 0;
+}
+
+void IceCoupler_DISMAL::_model_start(
+    bool cold_start,
+    ibmisc::Datetime const &time_base,
+    double time_start_s)
+{
+    printf("BEGIN IceCoupler_DISMAL::_model_start()\n");
+
+    // Set up the coupling contract; this calls back to setup_modele_dismal()
+    contracts::setup(gcm_coupler, this);
+
+    last_time_s = time_start_s;
+    if (gcm_coupler->am_i_sheet_root(sheet_index())) {
+        init_elevation();
+        if (!cold_start && params.rsf_fname != ""
+            && boost::filesystem::exists(params.rsf_fname))
+        {
+            icemodel_rsf(params.rsf_fname, 'r');
+        }
+        printf("IceCoupler_DISMAL: %ld of %ld ice grid cells are ice\n", nice, nI());
+    }
+
+    printf("END IceCoupler_DISMAL::_model_start()\n");
+}
+
+// ======================================================================
+void IceCoupler_DISMAL::evolve(double time_s)
+{
+    // Only cells in this timestep's band move; so about
+    // evolve_fraction of the ice sheet changes each timestep.
+    long const nband = std::max(1L, std::lround(1. / evolve_fraction));
+    long const band = step % nband;
+
+    double const omega = 2. * M_PI / elev_period;
+    for (int iI=0; iI<elev0_ice.extent(0); ++iI) {
+        if (std::isnan(elev0_ice(iI))) continue;
+        if (iI % nband != band) continue;
+
+        // Phase varies over the ice sheet (golden ratio sequence)
+        double const phase = 2. * M_PI * std::fmod(iI * 0.6180339887498949, 1.);
+        double const h = std::max(0.,
+            elev0_ice(iI) + elev_amplitude * std::sin(omega * time_s + phase)
+            + smb_dh(iI));
+        elev_ice(iI) = h;
+        elev_land(iI) = h;
+    }
+}
+
+void IceCoupler_DISMAL::spend_cost()
+{
+    double const cost_s = cost_step_s + cost_cell_s * nice;
+    if (cost_s <= 0) return;
+
+    auto const duration(std::chrono::duration<double>(cost_s));
+    if (cost_spin) {
+        auto const t1(std::chrono::steady_clock::now() + duration);
+        while (std::chrono::steady_clock::now() < t1) ;
+    } else {
+        std::this_thread::sleep_for(duration);
+    }
+}
+
+void IceCoupler_DISMAL::run_timestep(double time_s,
+    blitz::Array<double,2> const &ice_ivalsI,    // ice_ivalsI(nvar, nI)
+    blitz::Array<double,2> &ice_ovalsI,    // ice_ovalsI(nvar, nI)
+    bool run_ice)    // Should we run the ice model?
+{
+    // DISMAL runs entirely on the sheet root; ice_ivalsI is only valid there.
+    if (!gcm_coupler->am_i_sheet_root(sheet_index())) return;
+
+    printf("BEGIN IceCoupler_DISMAL::run_timestep(%f, run_ice=%d)\n", time_s, run_ice);
+
+    VarSet const &icontract(contract[IceCoupler::INPUT]);
+    VarSet const &ocontract(contract[IceCoupler::OUTPUT]);
+    if (ice_ivalsI.extent(0) != icontract.size() || ice_ovalsI.extent(0) != ocontract.size()
+        || ice_ivalsI.extent(1) != nI() || ice_ovalsI.extent(1) != nI())
+    {
+        (*icebin_error)(-1,
+            "Extents mismatch: ice_ivalsI(%d,%d) ice_ovalsI(%d,%d) contract (%d,%d) nI=%ld",
+            ice_ivalsI.extent(0), ice_ivalsI.extent(1),
+            ice_ovalsI.extent(0), ice_ovalsI.extent(1),
+            icontract.size(), ocontract.size(), nI());
+    }
+
+    // Find our inputs in the contract (-1 if not there)
+    int massxfer_ix = -1, enthxfer_ix = -1;
+    for (int ivar=0; ivar<icontract.size(); ++ivar) {
+        std::string const &name(icontract.index[ivar]);
+        if (name == "massxfer") massxfer_ix = ivar;
+        else if (name == "enthxfer") enthxfer_ix = ivar;
+    }
+
+    if (run_ice) {
+        // SMB raises / lowers the surface
+        double const dt = time_s - last_time_s;
+        if (massxfer_ix >= 0) {
+            for (int iI=0; iI<nI(); ++iI) {
+                if (std::isnan(elev0_ice(iI))) continue;
+                smb_dh(iI) += ice_ivalsI(massxfer_ix, iI) * dt / rhoi;
+            }
+        }
+
+        evolve(time_s);
+        spend_cost();
+
+        last_time_s = time_s;
+        ++step;
+    }
+
+    // ----------- Copy state to outputs
+    unsigned int const mask = (run_ice ? 0 : contracts::INITIAL);
+    for (int ivar=0; ivar<ocontract.size(); ++ivar) {
+        VarMeta const &cf(ocontract.data[ivar]);
+        if ((cf.flags & mask) != mask) continue;
+
+        std::string const &name(ocontract.index[ivar]);
+        blitz::Array<double,1> oval(ice_ovalsI(ivar, blitz::Range::all()));
+        if (name == "elevmask_ice") {
+            oval = elev_ice;
+        } else if (name == "elevmask_land") {
+            oval = elev_land;
+        } else if (name == "ice_top_elevation") {
+            for (int iI=0; iI<nI(); ++iI)
+                oval(iI) = (std::isnan(elev_land(iI)) ? 0. : elev_land(iI));
+        } else if (name == "ice_top_senth") {
+            oval = ice_top_senth;
+        } else if (name == "smb.mass") {
+            if (massxfer_ix >= 0) oval = ice_ivalsI(massxfer_ix, blitz::Range::all());
+        } else if (name == "smb.enth") {
+            if (enthxfer_ix >= 0) oval = ice_ivalsI(enthxfer_ix, blitz::Range::all());
+        } else {
+            (*icebin_error)(-1,
+                "IceCoupler_DISMAL: Contract output %s is not produced by DISMAL", name.c_str());
+        }
+    }
+
+    printf("END IceCoupler_DISMAL::run_timestep()\n");
+}
+
+/** Read/write state for restart file */
+void IceCoupler_DISMAL::icemodel_rsf(std::string const &fname, char rw)
+{
+    if (!gcm_coupler->am_i_sheet_root(sheet_index())) return;
+
+    // Might be read before _model_start()
+    if (elev_land.size() == 0) init_elevation();
+
+    NcIO ncio(fname, rw);
+    auto info_v = get_or_add_var(ncio, "dismal", "int", {});
+    get_or_put_att(info_v, ncio.rw, "step", "int64", &step, 1);
+    get_or_put_att(info_v, ncio.rw, "time_s", "double", &last_time_s, 1);
+
+    auto dims(get_or_add_dims(ncio, {"nI"}, {nI()}));
+    ncio_blitz(ncio, elev_land, "elev_land", "double", dims);
+    ncio_blitz(ncio, elev_ice, "elev_ice", "double", dims);
+    ncio_blitz(ncio, smb_dh, "smb_dh", "double", dims);
+}
+
+}}    // namespace icebin::dismal
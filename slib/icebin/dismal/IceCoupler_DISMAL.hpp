@@ -0,0 +1,109 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <icebin/GCMCoupler.hpp>
+
+namespace icebin {
+namespace dismal {
+
+/** Demo Ice Sheet Model And LandIce: a synthetic ice model, built
+into IceBin, that needs no external libraries.  It ignores ice
+dynamics: the surface elevation follows a prescribed, deterministic
+oscillation about a base elevation, plus whatever SMB it is given.
+Each coupling timestep costs a configurable amount of wall time.
+Useful for exercising and profiling the coupler without PISM.
+
+Configured through attributes on <sheet>.info (all optional, except
+output_dir):
+    elevmask: Base elevation, as a read_elevmask() spec (eg pism:fname).
+        If not given, a parabolic dome is made on the ice grid.
+    dome_height [m]: Height of the synthetic dome.
+    elev_amplitude [m], elev_period [s]: Oscillation of the surface.
+    evolve_fraction: Fraction of ice cells whose elevation is updated
+        each coupling timestep (controls how much the regrid matrices change).
+    cost_step_s [s], cost_cell_s [s]: Wall time of each coupling
+        timestep, fixed plus per ice grid cell.
+    cost_spin: If nonzero, burn CPU for that time instead of sleeping.
+*/
+class IceCoupler_DISMAL : public IceCoupler
+{
+public:
+    // ------------- Parameters (from ncread())
+    std::string elevmask_spec;
+    double dome_height = 3000.;
+    double elev_amplitude = 10.;
+    double elev_period = 365. * 86400.;
+    double evolve_fraction = 1.;
+    double cost_step_s = 0.;
+    double cost_cell_s = 0.;
+    int cost_spin = 0;
+
+    /** Specific enthalpy reported for the top of the ice sheet
+    [J kg-1]; set by the coupling contract. */
+    double ice_top_senth = 0;
+
+    /** Density of ice [kg m-3]; set by the coupling contract. */
+    double rhoi = 916.6;
+
+protected:
+    // ------------- State (sparse indexing iI)
+    blitz::Array<double,1> elev0_land, elev0_ice;    // Base elevation
+    blitz::Array<double,1> elev_land, elev_ice;    // Current elevation
+    blitz::Array<double,1> smb_dh;    // Cumulative elevation change due to SMB [m]
+    long nice = 0;    // Number of ice-covered cells
+    long step = 0;    // Number of coupling timesteps run
+    double last_time_s;
+
+public:
+    IceCoupler_DISMAL(IceCoupler::Params const &_params);
+
+    /** DISMAL is serial; run it where its inputs are computed */
+    bool runs_on_sheet_root() const { return true; }
+
+    virtual void ncread(ibmisc::NcIO &ncio_config, std::string const &vname_sheet);
+
+    virtual void _model_start(
+        bool cold_start,
+        ibmisc::Datetime const &time_base,
+        double time_start_s);
+
+    virtual void run_timestep(double time_s,
+        blitz::Array<double,2> const &ice_ivalsI,    // ice_ivalsI(nvar, nI)
+        blitz::Array<double,2> &ice_ovalsI,    // ice_ovalsI(nvar, nI)
+        bool run_ice);
+
+    /** Read/write state for restart file */
+    void icemodel_rsf(std::string const &fname, char rw);
+
+protected:
+    /** Sets elev0_land / elev0_ice, either from elevmask_spec or
+    by making a dome on the ice grid */
+    void init_elevation();
+
+    /** Moves elev_land / elev_ice forward to time_s */
+    void evolve(double time_s);
+
+    /** Spends the wall time given by the cost model */
+    void spend_cost();
+};
+
+}}    // namespace icebin::dismal
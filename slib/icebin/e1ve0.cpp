@@ -1,7 +1,12 @@
 #include <tuple>
 #include <algorithm>
 #include <set>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
 #include <icebin/e1ve0.hpp>
+#include <icebin/error.hpp>
 
 using namespace ibmisc;
 using namespace spsparse;
@@ -52,55 +57,193 @@ void consolidate(std::vector<spsparse::Tuple<IndexT,ValT,RANK>> &M)
 }
 
 
-spsparse::TupleList<int,double,2> compute_E1vE0c(
-std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE1s,  // sparsified
-std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE0s,  // sparsified
-unsigned long nE,            // Size of (sparse) E vector space, never changes
-std::vector<double> const &areaX)
+/** @return True if two (sparsified) XuE matrices are identical, in
+which case E1vE0c for that ice sheet is zero. */
+static bool same_XuE(
+ibmisc::linear::Weighted_Eigen const &XuE1,
+ibmisc::linear::Weighted_Eigen const &XuE0)
 {
-    spsparse::TupleList<int,double,2> E1vE0c;
-    blitz::Array<double,1> sE1(nE);
-    sE1 = 0;
+    EigenSparseMatrixT const &M1(*XuE1.M);
+    EigenSparseMatrixT const &M0(*XuE0.M);
+    if (M1.rows() != M0.rows() || M1.cols() != M0.cols()) return false;
+    if (!M1.isCompressed() || !M0.isCompressed()) return false;
+    if (M1.nonZeros() != M0.nonZeros()) return false;
+    if (XuE1.wM.extent(0) != XuE0.wM.extent(0)) return false;
+
+    for (long i=0; i<=M1.outerSize(); ++i)
+        if (M1.outerIndexPtr()[i] != M0.outerIndexPtr()[i]) return false;
+    for (long i=0; i<M1.nonZeros(); ++i) {
+        if (M1.innerIndexPtr()[i] != M0.innerIndexPtr()[i]) return false;
+        if (M1.valuePtr()[i] != M0.valuePtr()[i]) return false;
+    }
+    for (int i=0; i<XuE1.wM.extent(0); ++i)
+        if (XuE1.wM(i) != XuE0.wM(i)) return false;
+    return true;
+}
 
-    // 1. Compute UNSCALED correction matrix, per ice sheet
-    // 2. Concatenate per-ice-sheet correction matrix into overall correction matrix
-    // correct_unscaled = sum_{ice sheet}[ E1uX * (XvE0 - XvE1) ]
-    for (size_t i=0; i<XuE1s.size(); ++i) {
-        // -------- 1. Compute UNSCALED correction matrix, per ice sheet
-        linear::Weighted_Eigen const *XuE1 = &*XuE1s[i];
-        linear::Weighted_Eigen const *XuE0 = &*XuE0s[i];
-
-        blitz::Array<double,1> sXuE0(1. / XuE0->wM);
-        blitz::Array<double,1> sXuE1(1. / XuE1->wM);
-
-        // blitz::Array<double,1> XuE1s(1. / XuE1->Mw);
-        // auto E1vX(map_eigen_diagonal(XuE1s) * XuE1->M->transpose())
-        auto E1uX(XuE1->M->transpose());
-        auto XvE1(map_eigen_diagonal(sXuE1) * *XuE1->M);
-        auto XvE0(map_eigen_diagonal(sXuE0) * *XuE0->M);
-
-        // -------- 2. Concatenate per-ice-sheet correction matrices
-        // Assemble the correction matrix, and sparsify its indexing.
-        // EigenSparseMatrixT correct_unscaled(E1uX*XvE0 - E1uX*XvE1);
-        EigenSparseMatrixT E1vE0c_local(E1uX*(XvE0 - XvE1));
+/** Computes one ice sheet's UNSCALED E1vE0c = E1uX * (XvE0 - XvE1) */
+template<class MatrixT>
+static void E1vE0c_unscaled_product(
+MatrixT &ret,
+ibmisc::linear::Weighted_Eigen const &XuE1,
+ibmisc::linear::Weighted_Eigen const &XuE0)
+{
+    blitz::Array<double,1> sXuE0(1. / XuE0.wM);
+    blitz::Array<double,1> sXuE1(1. / XuE1.wM);
+
+    // blitz::Array<double,1> XuE1s(1. / XuE1->Mw);
+    // auto E1vX(map_eigen_diagonal(XuE1s) * XuE1->M->transpose())
+    auto E1uX(XuE1.M->transpose());
+    auto XvE1(map_eigen_diagonal(sXuE1) * *XuE1.M);
+    auto XvE0(map_eigen_diagonal(sXuE0) * *XuE0.M);
+
+    // EigenSparseMatrixT correct_unscaled(E1uX*XvE0 - E1uX*XvE1);
+    ret = E1uX*(XvE0 - XvE1);
+}
+
+void add_E1vE0c_unscaled(
+spsparse::TupleList<int,double,2> &E1vE0c_unscaled,
+spsparse::TupleList<int,double,1> &wE1,
+ibmisc::linear::Weighted_Eigen const &XuE1,
+ibmisc::linear::Weighted_Eigen const &XuE0)
+{
+    // Assemble the correction matrix, and sparsify its indexing.
+    // (Nothing to add if the ice sheet has not changed)
+    if (!same_XuE(XuE1, XuE0)) {
+        EigenSparseMatrixT E1vE0c_local;
+        E1vE0c_unscaled_product(E1vE0c_local, XuE1, XuE0);
         spcopy(
-            accum::ref(E1vE0c),
+            accum::ref(E1vE0c_unscaled),
             E1vE0c_local);
+    }
 
-        for (int i=0; i<XuE1->Mw.extent(0); ++i) sE1(i) += XuE1->Mw(i);
+    for (int i=0; i<XuE1.Mw.extent(0); ++i) {
+        if (XuE1.Mw(i) != 0) wE1.add({i}, XuE1.Mw(i));
     }
+}
 
-    // Convert merged weights to scale factor
-    for (int i=0; i<sE1.extent(0); ++i) sE1(i) = 1. / sE1(i);
+
+void scale_E1vE0c(
+spsparse::TupleList<int,double,2> &E1vE0c,
+spsparse::TupleList<int,double,1> &wE1)
+{
+    // Merge weights from all ice sheets
+    consolidate(wE1.tuples);
 
     // E1vE0c = sE1 * E1vE0c_unscaled
+    // Both lists sorted by iE1: merge-join them
+    consolidate(E1vE0c.tuples);
+    auto jj(wE1.tuples.begin());
     for (auto ii(E1vE0c.begin()); ii != E1vE0c.end(); ++ii) {
         long const iE1(ii->index(0));
-        ii->value() *= sE1(iE1);
+        while (jj != wE1.tuples.end() && jj->index(0) < iE1) ++jj;
+        if (jj == wE1.tuples.end() || jj->index(0) != iE1) (*icebin_error)(-1,
+            "scale_E1vE0c(): No weight for iE1=%ld", iE1);
+        ii->value() /= jj->value();
     }
+}
 
-    // Tidy up by consolidating
-    consolidate(E1vE0c.tuples);
+
+spsparse::TupleList<int,double,2> compute_E1vE0c(
+std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE1s,  // sparsified
+std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE0s,  // sparsified
+unsigned long nE,            // Size of (sparse) E vector space, never changes
+std::vector<double> const &areaX,
+int nthreads)
+{
+    typedef Eigen::SparseMatrix<double, Eigen::RowMajor, int> RowMatrixT;
+    size_t const nsheet = XuE1s.size();
+
+    if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Runs fn(0..n-1) on up to nthreads threads
+    auto parallel_for = [nthreads](size_t n, std::function<void(size_t)> const &fn) {
+        int const nt = std::min((size_t)nthreads, n);
+        if (nt <= 1) {
+            for (size_t i=0; i<n; ++i) fn(i);
+            return;
+        }
+        std::atomic<size_t> next(0);
+        std::vector<std::exception_ptr> errors(nt);
+        std::vector<std::thread> threads;
+        for (int t=0; t<nt; ++t) {
+            threads.push_back(std::thread([&fn,&next,&errors,n,t]() {
+                try {
+                    for (size_t i; (i = next++) < n; ) fn(i);
+                } catch(...) {
+                    errors[t] = std::current_exception();
+                }
+            }));
+        }
+        for (auto &thread : threads) thread.join();
+        for (auto &error : errors) if (error) std::rethrow_exception(error);
+    };
+
+    // 1. Compute UNSCALED correction matrix, per ice sheet, in CSR form
+    // correct_unscaled = sum_{ice sheet}[ E1uX * (XvE0 - XvE1) ]
+    // Sheets whose XuE did not change contribute nothing.
+    std::vector<RowMatrixT> E1vE0cs(nsheet);
+    std::vector<char> changed(nsheet);
+    for (size_t i=0; i<nsheet; ++i) changed[i] = !same_XuE(*XuE1s[i], *XuE0s[i]);
+    parallel_for(nsheet, [&](size_t i) {
+        if (changed[i]) E1vE0c_unscaled_product(E1vE0cs[i], *XuE1s[i], *XuE0s[i]);
+    });
+
+    // 2. Merge weights from all ice sheets; convert to scale factor
+    blitz::Array<double,1> sE1(nE);
+    sE1 = 0;
+    for (size_t i=0; i<nsheet; ++i) {
+        blitz::Array<double,1> const &Mw(XuE1s[i]->Mw);
+        for (int j=0; j<Mw.extent(0); ++j) sE1(j) += Mw(j);
+    }
+    for (int i=0; i<sE1.extent(0); ++i) sE1(i) = 1. / sE1(i);
+
+    std::vector<RowMatrixT const *> parts;
+    for (size_t i=0; i<nsheet; ++i) if (changed[i]) parts.push_back(&E1vE0cs[i]);
+    spsparse::TupleList<int,double,2> E1vE0c;
+    // Shape (-1,-1) means "no E1vE0c"; see split_by_domain()
+    E1vE0c.set_shape(std::array<long,2>{(long)nE, (long)nE});
+    if (parts.size() == 0) return E1vE0c;
+
+    // 3. E1vE0c = sE1 * E1vE0c_unscaled, summed over sheets.
+    // Rows are merged in blocks (in parallel); each row's entries from
+    // the different sheets are already sorted by column.
+    long const nrow = parts[0]->rows();
+    int const nblock = std::min((long)nthreads, std::max(1L, nrow / 10000));
+    std::vector<spsparse::TupleList<int,double,2>> blocks(nblock);
+    parallel_for(nblock, [&](size_t b) {
+        long const row0 = (nrow * b) / nblock;
+        long const row1 = (nrow * (b+1)) / nblock;
+        auto &out(blocks[b]);
+
+        std::vector<std::pair<int,double>> row;
+        for (long r=row0; r<row1; ++r) {
+            row.clear();
+            for (RowMatrixT const *P : parts) {
+                for (RowMatrixT::InnerIterator ii(*P, r); ii; ++ii)
+                    row.push_back(std::make_pair((int)ii.col(), ii.value() * sE1(r)));
+            }
+            if (row.size() == 0) continue;
+
+            // Sum duplicate columns (only needed when sheets overlap)
+            if (parts.size() > 1) std::stable_sort(row.begin(), row.end(),
+                [](std::pair<int,double> const &x, std::pair<int,double> const &y)
+                { return x.first < y.first; });
+            size_t j=0;
+            for (size_t i=1; i<row.size(); ++i) {
+                if (row[i].first == row[j].first) row[j].second += row[i].second;
+                else row[++j] = row[i];
+            }
+            for (size_t i=0; i<=j; ++i) out.add({(int)r, row[i].first}, row[i].second);
+        }
+    });
+
+    // Concatenate blocks, already in (iE1, iE0) order
+    size_t nnz = 0;
+    for (auto &block : blocks) nnz += block.size();
+    E1vE0c.tuples.reserve(nnz);
+    for (auto &block : blocks) E1vE0c.tuples.insert(
+        E1vE0c.tuples.end(), block.tuples.begin(), block.tuples.end());
 
     return E1vE0c;
 }
@@ -20,12 +20,37 @@ NOTE: Actual matrix applied is (E1vE0 - I), based on correction factor idea
 @param XuE1s Latest set of per-ice-sheet XuE matrices (unscaled) (X = exchange grid)
 @param XuE0s Previous coupling-timestep set of XuE matrices
 @param nE Number of theoretical elevation classes (in sparse E indexing)
-@param areaX Area of each exchange gridcell. */
+@param areaX Area of each exchange gridcell.
+@param nthreads Compute ice sheets (and merge rows) on up to this many
+    threads; <=0 for one per core. */
 extern TupleListT<2> compute_E1vE0c(
 std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE1s,
 std::vector<std::unique_ptr<ibmisc::linear::Weighted_Eigen>> const &XuE0s,
 unsigned long nE,            // Size of (sparse) E vector space, never changes
-std::vector<double> const &areaX);
+std::vector<double> const &areaX,
+int nthreads = 0);
+
+/** Adds one ice sheet's contribution to an UNSCALED E1vE0c, along
+with the weights needed to scale it later.  Contributions from
+different ice sheets (possibly computed on different MPI ranks) may
+be concatenated, then finished with scale_E1vE0c().
+@param E1vE0c_unscaled Accumulate E1uX * (XvE0 - XvE1) here
+@param wE1 Accumulate (non-zero) weights of E1uX here
+@param XuE1 Latest XuE for this ice sheet (sparsified)
+@param XuE0 Previous coupling-timestep XuE for this ice sheet (sparsified) */
+extern void add_E1vE0c_unscaled(
+spsparse::TupleList<int,double,2> &E1vE0c_unscaled,
+spsparse::TupleList<int,double,1> &wE1,
+ibmisc::linear::Weighted_Eigen const &XuE1,
+ibmisc::linear::Weighted_Eigen const &XuE0);
+
+/** Scales a (concatenated) unscaled E1vE0c by the merged weights
+wE1, and consolidates it.  wE1 must contain all weights for every
+row present in E1vE0c; duplicate entries are summed.
+@param E1vE0c Unscaled on input; scaled on output */
+extern void scale_E1vE0c(
+spsparse::TupleList<int,double,2> &E1vE0c,
+spsparse::TupleList<int,double,1> &wE1);
 
 
 }}    // namespace
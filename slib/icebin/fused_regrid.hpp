@@ -0,0 +1,96 @@
+#ifndef ICEBIN_FUSED_REGRID_HPP
+#define ICEBIN_FUSED_REGRID_HPP
+
+#include <vector>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <blitz/array.h>
+#include <Eigen/SparseCore>
+#include <icebin/error.hpp>
+
+namespace icebin {
+
+/** Regrids while transforming variables, in one fused pass:
+    valsB(k,i) = sum_j BvA(i,j) * (sum_l valsA(l,j) * M(l,k) + b(k))
+computed per row i as
+    acc(l) = sum_j BvA(i,j) valsA(l,j)
+    valsB(k,i) = sum_l acc(l) M(l,k) + (sum_j BvA(i,j)) b(k)
+No dense |j| x nvar temporaries are formed.  Rows are divided among
+threads.
+@param BvA Regrid matrix (row-major)
+@param valsA valsA(l,j), Blitz++ (row-major) layout
+@param M Variable transform, M(l,k) (sparse, column-major)
+@param b Bias b(0,k) (row vector)
+@param valsB valsB(k,i) (output, pre-allocated)
+@param nthreads Maximum number of threads; <=0 for one per core.
+    Results do not depend on the number of threads. */
+template<class MT, class BT>
+void fused_regrid_transform(
+    Eigen::SparseMatrix<double, Eigen::RowMajor> const &BvA,
+    blitz::Array<double,2> const &valsA,
+    MT const &M,
+    BT const &b,
+    blitz::Array<double,2> &valsB,
+    int nthreads = 0)
+{
+    long const nA = valsA.extent(1);
+    int const nl = valsA.extent(0);
+    long const nB = BvA.rows();
+    int const nk = valsB.extent(0);
+    if (BvA.cols() != nA || valsB.extent(1) != nB || M.rows() != nl || M.cols() != nk)
+        (*icebin_error)(-1, "fused_regrid_transform(): Dimension mismatch");
+    if (valsA.stride(0) != nA || valsA.stride(1) != 1 || valsB.stride(0) != nB || valsB.stride(1) != 1)
+        (*icebin_error)(-1, "fused_regrid_transform(): Arrays must be dense row-major");
+
+    double const *A = valsA.data();
+    double *B = valsB.data();
+
+    auto do_rows = [&](long i0, long i1) {
+        std::vector<double> acc(nl);
+        for (long i=i0; i<i1; ++i) {
+            double rowsum = 0;
+            for (int l=0; l<nl; ++l) acc[l] = 0;
+            for (Eigen::SparseMatrix<double, Eigen::RowMajor>::InnerIterator ii(BvA, i); ii; ++ii) {
+                double const v = ii.value();
+                long const j = ii.col();
+                rowsum += v;
+                for (int l=0; l<nl; ++l) acc[l] += v * A[l*nA + j];
+            }
+            for (int k=0; k<nk; ++k) {
+                double val = rowsum * b(0,k);
+                for (typename MT::InnerIterator mm(M, k); mm; ++mm)
+                    val += acc[mm.row()] * mm.value();
+                B[k*nB + i] = val;
+            }
+        }
+    };
+
+    // Don't bother with threads for small problems
+    long const min_per_thread = 10000;
+    if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::min((long)nthreads, std::max(1L, nB / min_per_thread));
+    if (nthreads == 1) {
+        do_rows(0, nB);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::vector<std::thread> threads;
+    for (int t=0; t<nthreads; ++t) {
+        long const i0 = (nB * t) / nthreads;
+        long const i1 = (nB * (t+1)) / nthreads;
+        threads.push_back(std::thread([&do_rows,&errors,t,i0,i1]() {
+            try {
+                do_rows(i0, i1);
+            } catch(...) {
+                errors[t] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &thread : threads) thread.join();
+    for (auto &error : errors) if (error) std::rethrow_exception(error);
+}
+
+}    // namespace
+#endif    // guard
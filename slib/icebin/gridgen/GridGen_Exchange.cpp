@@ -18,6 +18,10 @@
 
 #include <unordered_map>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
 
 #include <CGAL/Exact_predicates_exact_constructions_kernel.h>
 #include <CGAL/Boolean_set_operations_2.h>
@@ -31,6 +35,7 @@
 
 #include <icebin/gridgen/cgal.hpp>
 #include <icebin/gridgen/GridGen_Exchange.hpp>
+#include <icebin/gridgen/overlap_fp.hpp>
 #include <icebin/gridgen/gridutil.hpp>
 
 using namespace ibmisc;
@@ -43,17 +48,24 @@ namespace icebin {
 struct OCell {
     Cell const *cell;
 
-    /** The polygon representing the grid cell (on the map).
-    Vertices in this polygon are always counter-clockwise and have positive area. */
-    gc::Polygon_2 poly;
-    
-    /** Bounding box of the polygon, used for search/overlap algorithms. */
-    gc::Iso_rectangle_2 bounding_box;
+    /** Vertices of the grid cell (on the map), in double precision.
+    Vertices are always counter-clockwise and have positive area. */
+    std::vector<std::array<double,2>> xy;
+
+    /** Bounding box of the polygon, used for search/overlap algorithms.
+    (xmin, ymin, xmax, ymax) */
+    std::array<double,4> bounding_box;
 
     OCell(Cell const *_cell, Proj2 const *proj);
+
+    /** The polygon representing the grid cell (on the map).
+    Constructed on demand, so CGAL objects are never shared between
+    threads. */
+    gc::Polygon_2 poly() const;
 };
 
-OCell::OCell(Cell const *_cell, Proj2 const *proj) : cell(_cell)
+OCell::OCell(Cell const *_cell, Proj2 const *proj) : cell(_cell),
+    bounding_box{1e100, 1e100, -1e100, -1e100}
 {
     // Copy the vertices
     for (auto vertex = cell->begin(); vertex != cell->end(); ++vertex) {
@@ -64,11 +76,22 @@ OCell::OCell(Cell const *_cell, Proj2 const *proj) : cell(_cell)
             x = vertex->x;
             y = vertex->y;
         }
-        poly.push_back(gc::Point_2(x, y));
+        xy.push_back({x, y});
+
+        // Compute the bounding box
+        bounding_box[0] = std::min(bounding_box[0], x);
+        bounding_box[1] = std::min(bounding_box[1], y);
+        bounding_box[2] = std::max(bounding_box[2], x);
+        bounding_box[3] = std::max(bounding_box[3], y);
     }
+}
 
-    // Compute the bounding box
-    bounding_box = CGAL::bounding_box(poly.vertices_begin(), poly.vertices_end());
+gc::Polygon_2 OCell::poly() const
+{
+    gc::Polygon_2 ret;
+    for (auto ii=xy.begin(); ii != xy.end(); ++ii)
+        ret.push_back(gc::Point_2((*ii)[0], (*ii)[1]));
+    return ret;
 }
 
 // =======================================================================
@@ -76,7 +99,7 @@ OCell::OCell(Cell const *_cell, Proj2 const *proj) : cell(_cell)
 struct OGrid {
     Grid const *grid;
 
-    /** CGAL polygon for each grid cell */
+    /** Projected polygon for each grid cell */
     std::unordered_map<int, OCell> ocells;
 
     /** Lazily computes an overall bounding box for all realized grid cells.
@@ -96,6 +119,9 @@ struct OGrid {
     OGrid(Grid const *_grid, Proj2 const *proj);
 
     void realize_rtree();
+
+    /** @return The OCells, sorted by cell index. */
+    std::vector<OCell const *> sorted() const;
 };      // struct OGrid
 
 OGrid::OGrid(Grid const *_grid, Proj2 const *proj) : grid(_grid)
@@ -104,24 +130,23 @@ OGrid::OGrid(Grid const *_grid, Proj2 const *proj) : grid(_grid)
     // Compute bounding box too
     // Be lazy, base bounding box on minimum and maximum values in points
     // (instead of computing the convex hull)
-    gc::Kernel::FT minx(1e100);
-    gc::Kernel::FT maxx(-1e100);
-    gc::Kernel::FT miny(1e100);
-    gc::Kernel::FT maxy(-1e100);
+    double minx(1e100);
+    double maxx(-1e100);
+    double miny(1e100);
+    double maxy(-1e100);
     // bounding_box.clear();
 
     // Compute Simple Bounding Box for overall grid
     for (auto cell = grid->cells.begin(); cell != grid->cells.end(); ++cell) {
         // Convert and copy to the OGrid data structure
         OCell ocell(&*cell, proj);
-        ocells.insert(std::make_pair(cell->index, ocell));
 
-        for (auto vertex = ocell.poly.vertices_begin(); vertex != ocell.poly.vertices_end(); ++vertex) {
-            minx = std::min(minx, vertex->x());
-            maxx = std::max(maxx, vertex->x());
-            miny = std::min(miny, vertex->y());
-            maxy = std::max(maxy, vertex->y());
-        }
+        minx = std::min(minx, ocell.bounding_box[0]);
+        miny = std::min(miny, ocell.bounding_box[1]);
+        maxx = std::max(maxx, ocell.bounding_box[2]);
+        maxy = std::max(maxy, ocell.bounding_box[3]);
+
+        ocells.insert(std::make_pair(cell->index, std::move(ocell)));
     }
 
     // Store it away
@@ -139,10 +164,10 @@ void OGrid::realize_rtree() {
     for (auto ii1=ocells.begin(); ii1 != ocells.end(); ++ii1) {
         OCell &ocell(ii1->second);
 
-        min[0] = CGAL::to_double(ocell.bounding_box.xmin());
-        min[1] = CGAL::to_double(ocell.bounding_box.ymin());
-        max[0] = CGAL::to_double(ocell.bounding_box.xmax());
-        max[1] = CGAL::to_double(ocell.bounding_box.ymax());
+        min[0] = ocell.bounding_box[0];
+        min[1] = ocell.bounding_box[1];
+        max[0] = ocell.bounding_box[2];
+        max[1] = ocell.bounding_box[3];
 
         //fprintf(stderr, "Adding bounding box: (%f %f)  (%f %f)\n", min[0], min[1], max[0], max[1]);
 
@@ -155,61 +180,135 @@ void OGrid::realize_rtree() {
         max[0] += epsilon_x;
         max[1] += epsilon_y;
 
-        //std::cout << ocell.poly << std::endl;
-        //std::cout << ocell.bounding_box << std::endl;
         //printf("(%g,%g) -> (%g,%g)\n", min[0], min[1], max[0], max[1]);
         rtree->Insert(min, max, &ocell);
     }
 }
 
+std::vector<OCell const *> OGrid::sorted() const
+{
+    std::vector<OCell const *> ret;
+    ret.reserve(ocells.size());
+    for (auto ii=ocells.begin(); ii != ocells.end(); ++ii)
+        ret.push_back(&ii->second);
+    std::sort(ret.begin(), ret.end(),
+        [](OCell const *a, OCell const *b) { return a->cell->index < b->cell->index; });
+    return ret;
+}
+
 
 // =======================================================================
 // The main exchange grid computation
 
-/**
-@param exgrid The Exchange Grid we're creating.  Even for L1 grids, we
-    don't need to positively associate vertices in exgrid with
-    vertices in gridA or gridI.  No more than a "best effort" is
-    needed to eliminate duplicate vertices.
-@return Always returns true (tells RTree search algorithm to keep going) */
-static bool overlap_callback(VertexCache *exvcache, GridMap<Cell> *cells, long gridI_ndata,
-    OCell const **ocell1p, OCell const *ocell2)
-{
-    // Enable using same std::function callback for many values of gridA
-    OCell const *ocell1 = *ocell1p;
-
-    // Compute the overlap polygon (CGAL)
-    auto expoly(poly_overlap(ocell1->poly, ocell2->poly));
-    if (expoly.size() == 0) return true;
-
-    // Convert it to a Cell
-    Cell excell;    // Exchange Cell
-    excell.i = ocell1->cell->index;
-    excell.j = ocell2->cell->index;
-//  excell.index = excell.i * gridI_ndata + excell.j;   // guarantee unique (but sparse)
-    excell.index = -1;      // Get an index assigned (but dense)...
-
-    // Add the vertices of the polygon outline
-    for (auto vertex = expoly.vertices_begin(); vertex != expoly.vertices_end(); ++vertex) {
-        double x = CGAL::to_double(vertex->x());
-        double y = CGAL::to_double(vertex->y());
-        exvcache->add_vertex(excell, x, y);
+/** An exchange grid cell, as computed by a worker thread (before it
+is added to the exchange grid). */
+struct ExCell {
+    long iA, iI;
+    std::vector<std::array<double,2>> xy;    // Outline of overlap polygon
+};
+
+/** Counts how overlaps were computed */
+struct OverlapStats {
+    long nfast = 0;        // Computed in double precision (overlap_fp)
+    long nexact = 0;       // Computed with the exact kernel (CGAL)
+    long nvalidated = 0;   // Fast overlaps also computed with CGAL
+    double max_area_diff = 0;        // Max discrepancy in area (validation)
+    double max_rel_area_diff = 0;    // ...relative to area of the overlap
+
+    void merge(OverlapStats const &other)
+    {
+        nfast += other.nfast;
+        nexact += other.nexact;
+        nvalidated += other.nvalidated;
+        max_area_diff = std::max(max_area_diff, other.max_area_diff);
+        max_rel_area_diff = std::max(max_rel_area_diff, other.max_rel_area_diff);
     }
+};
+
+/** Computes the overlaps of one gridA cell with all gridI cells.
+Overlaps are appended to excells, in order of gridI index.
+@param candidates Scratch space */
+static void overlap_cellA(
+    OGrid const &ogridI,
+    OCell const *ocellA,
+    ExchangeGridParams const &params,
+    std::vector<OCell const *> &candidates,
+    std::vector<ExCell> &excells,
+    OverlapStats &stats)
+{
+    // Find gridI cells that might overlap.
+    // Sort them, so results don't depend on RTree internals.
+    candidates.clear();
+    ogridI.rtree->Search(
+        {ocellA->bounding_box[0], ocellA->bounding_box[1]},
+        {ocellA->bounding_box[2], ocellA->bounding_box[3]},
+        [&candidates](OCell const *ocellI) -> bool {
+            candidates.push_back(ocellI);
+            return true;    // Keep going
+        });
+    std::sort(candidates.begin(), candidates.end(),
+        [](OCell const *a, OCell const *b) { return a->cell->index < b->cell->index; });
+
+    std::unique_ptr<gc::Polygon_2> polyA;    // Only constructed if needed
+    overlap_fp::PolygonD fp_out;
+    for (auto ii=candidates.begin(); ii != candidates.end(); ++ii) {
+        OCell const *ocellI = *ii;
+        long const iA = ocellA->cell->index;
+        long const iI = ocellI->cell->index;
+
+        // Try the fast path first
+        auto res(overlap_fp::Result::FALLBACK);
+        if (params.fast_clip) res = overlap_fp::overlap(ocellA->xy, ocellI->xy, fp_out);
+
+        bool const validate = (res != overlap_fp::Result::FALLBACK
+            && params.validate_every > 0 && (iA*31 + iI) % params.validate_every == 0);
+
+        gc::Polygon_2 expoly;
+        if (res == overlap_fp::Result::FALLBACK || validate) {
+            // Compute the overlap polygon (CGAL)
+            if (!polyA) polyA.reset(new gc::Polygon_2(ocellA->poly()));
+            expoly = poly_overlap(*polyA, ocellI->poly());
+        }
 
-    // Compute its area (we will need this)
-    excell.native_area = excell.proj_area(NULL);
+        if (validate) {
+            double const exact_area = (expoly.size() == 0 ? 0. : CGAL::to_double(expoly.area()));
+            double const fast_area = (res == overlap_fp::Result::OK ? overlap_fp::area(fp_out) : 0.);
+            double const diff = std::abs(fast_area - exact_area);
+            ++stats.nvalidated;
+            stats.max_area_diff = std::max(stats.max_area_diff, diff);
+            if (diff > 0) stats.max_rel_area_diff = std::max(stats.max_rel_area_diff,
+                diff / std::max(std::abs(exact_area), std::abs(fast_area)));
+        }
 
-    // Add it to the grid
-    cells->add(std::move(excell));
+        // Store the overlap (from fast path if we have it)
+        std::vector<std::array<double,2>> xy;
+        if (res == overlap_fp::Result::FALLBACK) {
+            ++stats.nexact;
+            for (auto vertex = expoly.vertices_begin(); vertex != expoly.vertices_end(); ++vertex) {
+                xy.push_back({
+                    CGAL::to_double(vertex->x()),
+                    CGAL::to_double(vertex->y())});
+            }
+        } else {
+            ++stats.nfast;
+            if (res == overlap_fp::Result::OK) xy = std::move(fp_out);
+        }
+        if (xy.size() == 0) continue;
 
-    return true;
+        excells.push_back(ExCell());
+        ExCell &excell(excells.back());
+        excell.iA = iA;
+        excell.iI = iI;
+        excell.xy = std::move(xy);
+    }
 }
 // --------------------------------------------------------------------
 
 /** @param gridI Put in an RTree */
 Grid make_exchange_grid(
     Grid const *gridA, Grid const *gridI,
-    std::string sproj)
+    std::string sproj,
+    ExchangeGridParams const &params)
 {
     // Determine compatibility and projections between the two grids
     std::unique_ptr<Proj2> projA, projI;
@@ -238,39 +337,99 @@ Grid make_exchange_grid(
         }
     }
 
-    /** Initialize the new grid */
+    // Projections are done here, single-threaded.
+    OGrid ogridA(gridA, &*projA);   // projA used to transform LL->XY when overlapping
+    OGrid ogridI(gridI, &*projI);   // projI used to transform LL->XY when overlapping
+    ogridI.realize_rtree();
+    std::vector<OCell const *> const ocellsA(ogridA.sorted());
+
+    // ------------- Compute overlaps in parallel
+    // gridA cells are handed out to threads in chunks; each chunk's
+    // results are kept separately, and merged in order below.
+    size_t const chunk_size = 16;
+    size_t const nchunks = (ocellsA.size() + chunk_size - 1) / chunk_size;
+    std::vector<std::vector<ExCell>> chunk_excells(nchunks);
+
+    int nthreads = params.nthreads;
+    if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::max((size_t)1, std::min((size_t)nthreads, nchunks));
+    printf("make_exchange_grid: %ld gridA cells, %d threads\n",
+        (long)ocellsA.size(), nthreads);
+
+    std::atomic<size_t> next_chunk(0);
+    std::atomic<long> nprocessed(0);
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::vector<OverlapStats> thread_stats(nthreads);
+    long next_report = 100;    // Only used by the main thread
+    auto worker = [&](int ithread) {
+        try {
+            std::vector<OCell const *> candidates;
+            for (size_t ichunk; (ichunk = next_chunk++) < nchunks; ) {
+                size_t const end = std::min(ocellsA.size(), (ichunk+1)*chunk_size);
+                for (size_t i=ichunk*chunk_size; i<end; ++i) {
+                    overlap_cellA(ogridI, ocellsA[i], params,
+                        candidates, chunk_excells[ichunk], thread_stats[ithread]);
+                    ++nprocessed;
+                }
+
+                // Logging, from the main thread only
+                long const n = nprocessed;
+                if (ithread == 0 && n >= next_report) {
+                    printf("Processed %ld of %ld from gridA\n",
+                        n, (long)ocellsA.size());
+                    next_report = (n/100 + 1) * 100;
+                }
+            }
+        } catch(...) {
+            errors[ithread] = std::current_exception();
+            next_chunk = nchunks;    // Stop the other threads
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i=1; i<nthreads; ++i) threads.push_back(std::thread(worker, i));
+    worker(0);
+    for (auto &thread : threads) thread.join();
+    for (auto &error : errors) if (error) std::rethrow_exception(error);
+
+    OverlapStats stats;
+    for (auto &tstats : thread_stats) stats.merge(tstats);
+    printf("make_exchange_grid: %ld candidate pairs: %ld fast, %ld exact\n",
+        stats.nfast + stats.nexact, stats.nfast, stats.nexact);
+    if (params.validate_every > 0) {
+        printf("make_exchange_grid: validated %ld fast overlaps: "
+            "max area discrepancy = %g (relative %g)\n",
+            stats.nvalidated, stats.max_area_diff, stats.max_rel_area_diff);
+    }
+
+    // ------------- Merge into the exchange grid, in order of (iA, iI)
+    // This is the same order for any number of threads, so the
+    // exchange grid is numbered the same from run to run.
     GridMap<Vertex> vertices(-1);    // Not specified
     GridMap<Cell> cells(-1);         // Not specified
-
     VertexCache exvcache(&vertices);
 
-    OGrid ogridA(gridA, &*projA);   // projA used to transform LL->XY when overlapping
-    OGrid ogridI(gridI, &*projI);   // projI used to transform LL->XY when overlapping
-    ogridI.realize_rtree();
+    for (auto &excells : chunk_excells) {
+        for (auto &ex : excells) {
+            // Convert it to a Cell
+            Cell excell;    // Exchange Cell
+            excell.i = ex.iA;
+            excell.j = ex.iI;
+            excell.index = -1;      // Get an index assigned (but dense)...
+
+            // Add the vertices of the polygon outline
+            excell.reserve(ex.xy.size());
+            for (auto &xy : ex.xy) exvcache.add_vertex(excell, xy[0], xy[1]);
+
+            // Compute its area (we will need this)
+            excell.native_area = excell.proj_area(NULL);
 
-    OCell const *ocell1;
-    auto callback(std::bind(&overlap_callback, &exvcache, &cells,
-        gridI->ndata(), &ocell1, _1));
-
-    int nprocessed=0;
-    for (auto ii1 = ogridA.ocells.begin(); ii1 != ogridA.ocells.end(); ++ii1) {
-        ocell1 = &ii1->second;      // Set parameter for the callback
-
-//printf("gridA[%d]: x in (%f - %f), y in (%f - %f)\n", ocell1->cell->index, min[0], max[0], min[1], max[1]);
-        int nfound = ogridI.rtree->Search(
-            {CGAL::to_double(ocell1->bounding_box.xmin()),
-             CGAL::to_double(ocell1->bounding_box.ymin())},
-            {CGAL::to_double(ocell1->bounding_box.xmax()),
-             CGAL::to_double(ocell1->bounding_box.ymax())},
-            callback);
-
-        // Logging
-        ++nprocessed;
-        if (nprocessed % 100 == 0) {
-            printf("Processed %d of %d from gridA, total overlaps = %d\n",
-                nprocessed+1, ogridA.ocells.size(), cells.nrealized());
+            // Add it to the grid
+            cells.add(std::move(excell));
         }
+        excells = std::vector<ExCell>();    // Free memory as we go
     }
+    printf("make_exchange_grid: total overlaps = %ld\n", (long)cells.nrealized());
 
     return Grid(
         gridA->name + '-' + gridI->name,
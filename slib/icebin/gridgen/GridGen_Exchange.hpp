@@ -24,9 +24,29 @@
 
 namespace icebin {
 
+/** Options for make_exchange_grid() */
+struct ExchangeGridParams {
+    /** Number of threads to use; 0 for one per core. */
+    int nthreads = 0;
+
+    /** Compute rectangle-vs-convex overlaps in double precision
+    (overlap_fp.hpp), falling back to the exact kernel only for
+    other or near-degenerate cases. */
+    bool fast_clip = true;
+
+    /** If >0, also compute about one in validate_every fast overlaps
+    with the exact kernel, and report the maximum area discrepancy. */
+    int validate_every = 0;
+};
+
+/** Computes the exchange grid (overlap) between two grids.
+Overlaps are computed in parallel; exchange grid cells are numbered in
+order of (gridA index, gridI index), independent of the number of
+threads. */
 extern Grid make_exchange_grid(
     Grid const *gridA, Grid const *gridI,
-    std::string sproj = "");
+    std::string sproj = "",
+    ExchangeGridParams const &params = ExchangeGridParams());
 
 
 
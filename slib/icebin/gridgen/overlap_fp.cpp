@@ -0,0 +1,184 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <icebin/gridgen/overlap_fp.hpp>
+
+namespace icebin {
+namespace overlap_fp {
+
+double area(PolygonD const &poly)
+{
+    double ret = 0;
+    size_t const n = poly.size();
+    for (size_t i=0; i<n; ++i) {
+        PointD const &p0(poly[i]);
+        PointD const &p1(poly[(i+1) % n]);
+        ret += p0[0]*p1[1] - p1[0]*p0[1];
+    }
+    return .5 * ret;
+}
+
+bool is_rectangle(PolygonD const &poly, std::array<double,4> &rect)
+{
+    if (poly.size() != 4) return false;
+
+    // Each edge must be exactly horizontal or vertical, alternating.
+    for (int i=0; i<4; ++i) {
+        PointD const &p0(poly[i]);
+        PointD const &p1(poly[(i+1) % 4]);
+        PointD const &p2(poly[(i+2) % 4]);
+        bool const horiz01 = (p0[1] == p1[1]);
+        bool const vert01 = (p0[0] == p1[0]);
+        bool const horiz12 = (p1[1] == p2[1]);
+        bool const vert12 = (p1[0] == p2[0]);
+        if (!((horiz01 && vert12) || (vert01 && horiz12))) return false;
+    }
+
+    rect = {
+        std::min(poly[0][0], poly[2][0]), std::min(poly[0][1], poly[2][1]),
+        std::max(poly[0][0], poly[2][0]), std::max(poly[0][1], poly[2][1])};
+    return (rect[2] > rect[0] && rect[3] > rect[1]);
+}
+
+/** Clips poly against the half-plane coord(k) >= val (sign=1), or
+coord(k) <= val (sign=-1).  One step of Sutherland-Hodgman. */
+static void clip_half_plane(PolygonD const &poly, int k, double val, double sign,
+    PolygonD &out)
+{
+    out.clear();
+    size_t const n = poly.size();
+    for (size_t i=0; i<n; ++i) {
+        PointD const &p0(poly[i]);
+        PointD const &p1(poly[(i+1) % n]);
+        bool const in0 = (sign * (p0[k] - val) >= 0);
+        bool const in1 = (sign * (p1[k] - val) >= 0);
+
+        if (in0) out.push_back(p0);
+        if (in0 != in1) {
+            // Edge crosses the line: add the intersection
+            double const t = (val - p0[k]) / (p1[k] - p0[k]);
+            PointD x;
+            x[k] = val;
+            x[1-k] = p0[1-k] + t * (p1[1-k] - p0[1-k]);
+            out.push_back(x);
+        }
+    }
+}
+
+Result overlap(PolygonD const &P, PolygonD const &Q, PolygonD &out, double tol)
+{
+    out.clear();
+
+    // Figure out which one is the rectangle
+    std::array<double,4> rect, rectQ;
+    bool const rectP = is_rectangle(P, rect);
+    bool const rect_Q = is_rectangle(Q, rectQ);
+    if (!rectP && !rect_Q) return Result::FALLBACK;
+
+    // ---------- Rectangle vs. rectangle: min/max are exact
+    if (rectP && rect_Q) {
+        double const x0 = std::max(rect[0], rectQ[0]);
+        double const y0 = std::max(rect[1], rectQ[1]);
+        double const x1 = std::min(rect[2], rectQ[2]);
+        double const y1 = std::min(rect[3], rectQ[3]);
+        if (x1 <= x0 || y1 <= y0) return Result::EMPTY;
+        out = {{x0,y0}, {x1,y0}, {x1,y1}, {x0,y1}};
+        return Result::OK;
+    }
+    if (!rectP) rect = rectQ;
+    PolygonD const &subject(rectP ? Q : P);
+
+    // ---------- Subject must be counter-clockwise and convex
+    size_t const n = subject.size();
+    if (n < 3) return Result::FALLBACK;
+    double const w = rect[2] - rect[0];
+    double const h = rect[3] - rect[1];
+    std::array<double,4> sbox{1e100, 1e100, -1e100, -1e100};
+    for (auto &p : subject) {
+        sbox[0] = std::min(sbox[0], p[0]);
+        sbox[1] = std::min(sbox[1], p[1]);
+        sbox[2] = std::max(sbox[2], p[0]);
+        sbox[3] = std::max(sbox[3], p[1]);
+    }
+    double const scale = std::max(std::max(w, h),
+        std::max(sbox[2]-sbox[0], sbox[3]-sbox[1]));
+
+    // Quick reject: bounding boxes clearly disjoint
+    if (sbox[0] > rect[2] + tol*scale || sbox[2] < rect[0] - tol*scale ||
+        sbox[1] > rect[3] + tol*scale || sbox[3] < rect[1] - tol*scale)
+        return Result::EMPTY;
+
+    for (size_t i=0; i<n; ++i) {
+        PointD const &p0(subject[i]);
+        PointD const &p1(subject[(i+1) % n]);
+        PointD const &p2(subject[(i+2) % n]);
+        double const ax = p1[0]-p0[0], ay = p1[1]-p0[1];
+        double const bx = p2[0]-p1[0], by = p2[1]-p1[1];
+        double const cross = ax*by - ay*bx;
+        double const norm = std::hypot(ax,ay) * std::hypot(bx,by);
+        if (norm == 0) return Result::FALLBACK;    // Repeated vertex
+        if (cross < -tol * norm) return Result::FALLBACK;    // Not convex (or clockwise)
+    }
+    if (area(subject) <= 0) return Result::FALLBACK;
+
+    // ---------- Near-degenerate cases go to the exact kernel
+    // Subject vertex on (or near) a rectangle edge line
+    double const eps = tol * scale;
+    for (auto &p : subject) {
+        if (std::abs(p[0]-rect[0]) < eps || std::abs(p[0]-rect[2]) < eps ||
+            std::abs(p[1]-rect[1]) < eps || std::abs(p[1]-rect[3]) < eps)
+            return Result::FALLBACK;
+    }
+    // Rectangle corner on (or near) a subject edge
+    std::array<PointD,4> const corners{{
+        {rect[0],rect[1]}, {rect[2],rect[1]}, {rect[2],rect[3]}, {rect[0],rect[3]}}};
+    for (size_t i=0; i<n; ++i) {
+        PointD const &p0(subject[i]);
+        PointD const &p1(subject[(i+1) % n]);
+        double const ax = p1[0]-p0[0], ay = p1[1]-p0[1];
+        double const len = std::hypot(ax,ay);
+        for (auto &c : corners) {
+            double const dist = std::abs(ax*(c[1]-p0[1]) - ay*(c[0]-p0[0])) / len;
+            if (dist < eps) return Result::FALLBACK;
+        }
+    }
+
+    // ---------- Sutherland-Hodgman: clip subject against the 4 sides
+    PolygonD tmp;
+    clip_half_plane(subject, 0, rect[0], 1., out);
+    clip_half_plane(out, 0, rect[2], -1., tmp);
+    clip_half_plane(tmp, 1, rect[1], 1., out);
+    clip_half_plane(out, 1, rect[3], -1., tmp);
+
+    // Remove repeated vertices
+    out.clear();
+    for (auto &p : tmp) {
+        if (out.size() == 0 || p != out.back()) out.push_back(p);
+    }
+    while (out.size() > 1 && out.front() == out.back()) out.pop_back();
+
+    if (out.size() < 3) {
+        out.clear();
+        return Result::EMPTY;
+    }
+    return Result::OK;
+}
+
+}}    // namespace icebin::overlap_fp
@@ -0,0 +1,59 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+namespace icebin {
+
+/** Double-precision polygon overlaps, used as a fast path for the
+exact (CGAL) overlaps in make_exchange_grid().  Only handles the
+common case of an axis-aligned rectangle (eg, a cell from GridGen_XY)
+against a convex polygon; anything else, or anything close to
+degenerate, is reported as FALLBACK so the caller can use the exact
+kernel instead. */
+namespace overlap_fp {
+
+typedef std::array<double,2> PointD;
+typedef std::vector<PointD> PolygonD;
+
+enum class Result {
+    OK,         // Overlap is in out
+    EMPTY,      // Polygons do not overlap
+    FALLBACK    // Could not compute; use the exact kernel
+};
+
+/** Signed area of a polygon (positive if counter-clockwise) */
+extern double area(PolygonD const &poly);
+
+/** If poly is an axis-aligned rectangle, stores it in rect as
+(xmin, ymin, xmax, ymax) and returns true. */
+extern bool is_rectangle(PolygonD const &poly, std::array<double,4> &rect);
+
+/** Computes the overlap of two polygons (counter-clockwise).
+At least one must be an axis-aligned rectangle; the other must be
+convex.
+@param tol Relative tolerance used to detect near-degenerate cases
+    (eg, a vertex of one polygon on or near an edge of the other).
+@param out The overlap polygon (counter-clockwise), if OK. */
+extern Result overlap(PolygonD const &P, PolygonD const &Q, PolygonD &out,
+    double tol = 1e-9);
+
+}}    // namespace icebin::overlap_fp
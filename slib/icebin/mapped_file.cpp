@@ -0,0 +1,55 @@
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <icebin/mapped_file.hpp>
+#include <icebin/error.hpp>
+
+namespace icebin {
+
+MappedFile::MappedFile(std::string const &fname, bool copy_on_write) : _fname(fname)
+{
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0) (*icebin_error)(-1,
+        "Cannot open %s for mapping: %s", fname.c_str(), strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        (*icebin_error)(-1, "Cannot stat %s: %s", fname.c_str(), strerror(errno));
+    }
+    _size = st.st_size;
+
+    if (_size > 0) {
+        _data = (copy_on_write
+            ? mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+            : mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0));
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            ::close(fd);
+            (*icebin_error)(-1, "Cannot mmap %s: %s", fname.c_str(), strerror(errno));
+        }
+    }
+    ::close(fd);    // Mapping stays valid after close
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) munmap(_data, _size);
+}
+
+void write_atomic(std::string const &fname,
+    std::function<void(std::string const &)> const &write_fn)
+{
+    // PID in the name keeps concurrent writers from clobbering each other
+    std::string const tmp_fname(fname + ".tmp" + std::to_string((long)getpid()));
+
+    write_fn(tmp_fname);
+    if (rename(tmp_fname.c_str(), fname.c_str()) != 0) (*icebin_error)(-1,
+        "Cannot rename %s to %s: %s", tmp_fname.c_str(), fname.c_str(), strerror(errno));
+}
+
+}    // namespace icebin
@@ -0,0 +1,43 @@
+#ifndef ICEBIN_MAPPED_FILE_HPP
+#define ICEBIN_MAPPED_FILE_HPP
+
+#include <string>
+#include <cstddef>
+#include <functional>
+
+/** Read-only memory mapping of a whole file.  Pages are shared
+through the OS page cache, so several processes on one node that map
+the same file hold just one copy of it. */
+
+namespace icebin {
+
+class MappedFile {
+    std::string _fname;
+    void *_data = nullptr;
+    size_t _size = 0;
+
+public:
+    MappedFile() {}
+    /** Maps fname; raises icebin_error on failure.
+    @param copy_on_write If set, pages may be written; the first write
+        to a page makes a private copy of it (the file is not changed). */
+    explicit MappedFile(std::string const &fname, bool copy_on_write=false);
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    std::string const &fname() const { return _fname; }
+    char const *data() const { return (char const *)_data; }
+    size_t size() const { return _size; }
+};
+
+/** Writes a file so it can be picked up by a concurrent reader
+without ever seeing a partial version: writes to a temporary name,
+then renames.
+@param write_fn Called with the temporary filename to write. */
+extern void write_atomic(std::string const &fname,
+    std::function<void(std::string const &)> const &write_fn);
+
+}    // namespace icebin
+#endif    // guard
@@ -17,6 +17,13 @@
  */
 
 #include <cstdlib>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
 #include <mpi.h>        // Intel MPI wants to be first
 #include <ibmisc/netcdf.hpp>
 #include <ibmisc/memory.hpp>
@@ -28,6 +35,8 @@
 #include <icebin/modele/GCMCoupler_ModelE.hpp>
 #include <icebin/modele/grids.hpp>
 #include <icebin/contracts/contracts.hpp>
+#include <icebin/transport.hpp>
+#include <icebin/profile.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/system/error_code.hpp>
 #include <icebin/modele/GCMRegridder_ModelE.hpp>
@@ -79,15 +88,20 @@ using namespace icebin::contracts;
 DomainDecomposer_ModelE::DomainDecomposer_ModelE(
     std::vector<int> const &endj,
     ibmisc::Domain const &_domainA_global) :    // Starts from ModelE; j indexing base=1
-domainA_global(_domainA_global),
-rank_of_j(endj[endj.size()-1], blitz::fortranArray)    // Allocate for 1-based indexing
+domainA_global(_domainA_global)
 {
     ndomain = endj.size();    // startj contains an extra sentinel item at the end
+    long const im_world = domainA_global[0].end;
+    long const jm_world = domainA_global[1].end;
+    nA = im_world * jm_world;
+
+    // Flat lookup table over A; j varies slowest in iA
+    rank_of_iA.resize(nA);
     int j=0;
     for (int irank=0; irank<ndomain; ++irank) {
-        for (; j < endj[irank]; ++j)
-            rank_of_j(j) = irank;    // zero-based indexing for j
-
+        for (; j < endj[irank]; ++j) {    // zero-based indexing for j
+            for (long i=0; i<im_world; ++i) rank_of_iA[j*im_world + i] = irank;
+        }
     }
 }
 
@@ -247,6 +261,16 @@ void GCMCoupler_ModelE::_ncread(
     // Retrieve name of TOPO file (without Greenland, and on Ocean grid)
     get_or_put_att(config_info, ncio_config.rw, "topo_ocean", topoO_fname);
     get_or_put_att(config_info, ncio_config.rw, "global_ec", global_ecO_fname);  // Must contain EvA at the very least
+    // Optional: memory-map static TOPOO fields through this cache file
+    {auto atts(config_info.getAtts());
+        if (atts.find("topo_ocean_mmap") != atts.end())
+            get_or_put_att(config_info, ncio_config.rw, "topo_ocean_mmap", topoO_mmap_fname);
+    }
+
+
+    // TOPOO fields never change during the run; read them once here
+    // (only root runs update_topo())
+    if (am_i_root()) load_topoo_base();
 
     /** EOpvAOp matrix for global (base) ice */
     ibmisc::ZArray<int,double,2> EOpvAOp_base;
@@ -263,6 +287,85 @@ void GCMCoupler_ModelE::_ncread(
                     std::dynamic_pointer_cast<GCMRegridder_Standard>(gcm_regridder)))));
 }
 // -----------------------------------------------------
+static char const topoo_mmap_magic[8] = {'T','O','P','O','M','M','A','P'};
+
+/** Header of the raw TOPOO cache file (see topoO_mmap_fname).  Arrays
+follow, each jm*im doubles (C order), in the order of
+topoo_bundle(BundleOType::MERGEO). */
+struct TopooMmapHeader {
+    char magic[8];
+    int32_t version;
+    int32_t nvar, jm, im;
+    char pad[40];    // Keeps arrays 64-byte aligned
+
+    bool matches(int _nvar) const
+        { return memcmp(magic, topoo_mmap_magic, 8) == 0 && version == 1
+            && nvar == _nvar; }
+
+    size_t nbytes() const
+        { return sizeof(TopooMmapHeader) + sizeof(double) * nvar * jm * im; }
+};
+
+void GCMCoupler_ModelE::load_topoo_base()
+{
+    if (topoO_mmap_fname == "") {
+        topoo_base = topoo_bundle(BundleOType::MERGEO, topoO_fname);
+        return;
+    }
+
+    // Just the variables; only read topoO_fname if the cache is stale
+    topoo_base = topoo_bundle(BundleOType::MERGEO, "");
+    int const nvar = topoo_base.index.size();
+
+    bool write = true;
+    if (boost::filesystem::exists(topoO_mmap_fname)
+        && boost::filesystem::last_write_time(topoO_mmap_fname)
+            >= boost::filesystem::last_write_time(topoO_fname))
+    {
+        MappedFile mf(topoO_mmap_fname);
+        auto const *header((TopooMmapHeader const *)mf.data());
+        write = !(mf.size() >= sizeof(TopooMmapHeader)
+            && header->matches(nvar) && mf.size() == header->nbytes());
+    }
+    if (write) {
+        printf("Writing TOPOO cache %s\n", topoO_mmap_fname.c_str());
+        auto topoo(topoo_bundle(BundleOType::MERGEO, topoO_fname));
+        write_atomic(topoO_mmap_fname, [&](std::string const &fname) {
+            FILE *fout = fopen(fname.c_str(), "wb");
+            if (!fout) (*icebin_error)(-1, "Cannot open %s", fname.c_str());
+
+            TopooMmapHeader header;
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, topoo_mmap_magic, 8);
+            header.version = 1;
+            header.nvar = nvar;
+            header.jm = topoo.data[0].arr.extent(0);
+            header.im = topoo.data[0].arr.extent(1);
+            fwrite(&header, sizeof(header), 1, fout);
+
+            for (auto &d : topoo.data) {
+                blitz::Array<double,2> arr(d.arr.copy());  // Contiguous, C order
+                fwrite(arr.data(), sizeof(double), arr.size(), fout);
+            }
+            if (fclose(fout) != 0) (*icebin_error)(-1, "Error writing %s", fname.c_str());
+        });
+    }
+
+    // Point topoo_base at the (read-only) mapped arrays
+    topoo_mmap.reset(new MappedFile(topoO_mmap_fname));
+    auto const *header((TopooMmapHeader const *)topoo_mmap->data());
+    if (topoo_mmap->size() < sizeof(TopooMmapHeader) || !header->matches(nvar)
+        || topoo_mmap->size() != header->nbytes()) (*icebin_error)(-1,
+        "TOPOO cache %s is corrupt", topoO_mmap_fname.c_str());
+    int const jm = header->jm;
+    int const im = header->im;
+    double *base = (double *)(topoo_mmap->data() + sizeof(TopooMmapHeader));
+    for (int i=0; i<nvar; ++i) {
+        topoo_base.data[i].arr.reference(blitz::Array<double,2>(
+            base + (size_t)i*jm*im, blitz::shape(jm,im), blitz::neverDeleteData));
+    }
+}
+// -----------------------------------------------------
 // Called from LISnow::allocate()
 
 std::string GCMCoupler_ModelE::locate_input_file(
@@ -314,13 +417,21 @@ printf("BEGIN gcmce_new()\n");
 
 
     /** Creates (on root) a picture of the full domain decomposition.
-    Run from all MPI ranks... */
+    Run from all MPI ranks...
+    With distribute_sheets, every rank splits output by domain; so
+    every rank needs it. */
     std::vector<int> endj;
     int endme = self->domainA[1].end;
-    boost::mpi::gather<int>(self->gcm_params.world,
-        &endme, 1,    // In-values
-        endj, self->gcm_params.gcm_root);                    // Out-values, root
-    if (self->am_i_root()) {
+    if (self->distribute_sheets) {
+        boost::mpi::all_gather<int>(self->gcm_params.world,
+            &endme, 1,    // In-values
+            endj);                    // Out-values
+    } else {
+        boost::mpi::gather<int>(self->gcm_params.world,
+            &endme, 1,    // In-values
+            endj, self->gcm_params.gcm_root);                    // Out-values, root
+    }
+    if (self->am_i_root() || self->distribute_sheets) {
         self->domains.reset(
             new DomainDecomposer_ModelE(endj, self->domainA_global));
     }
@@ -602,11 +713,72 @@ void gcmce_model_start(GCMCoupler_ModelE *self, bool cold_start, int yeari, int
 }
 
 
-/** Helper function: splits a single GCMInput struct into per-domain GCMInput structs */
+/** Splits one sparse TupleList by domain of its first index, with a
+counting sort: count per domain, size exactly, then fill. */
+template<int RANK>
+static void split_tuples(
+    spsparse::TupleList<int,double,RANK> const &in,
+    DomainDecomposer_ModelE const &domains,
+    std::vector<GCMInput> &outs,
+    spsparse::TupleList<int,double,RANK> GCMInput::*member)
+{
+    std::vector<int> domain(in.tuples.size());
+    std::vector<size_t> count(outs.size(), 0);
+    for (size_t i=0; i<in.tuples.size(); ++i) {
+        domain[i] = domains.get_domain(in.tuples[i].index(0));
+        ++count[domain[i]];
+    }
+    for (size_t d=0; d<outs.size(); ++d) (outs[d].*member).tuples.reserve(count[d]);
+    for (size_t i=0; i<in.tuples.size(); ++i) {
+        auto const &tp(in.tuples[i]);
+        (outs[domain[i]].*member).add(tp.index(), tp.value());
+    }
+}
+
+/** Splits one VectorMultivec of a GCMInput by domain, with a
+counting sort: count per domain, size exactly, then fill. */
+static void split_multivec(
+    VectorMultivec const &in,
+    DomainDecomposer_ModelE const &domains,
+    std::vector<GCMInput> &outs,
+    int iAE)
+{
+    int const nvar = in.nvar;
+    size_t const n = in.size();
+
+    // Pass 1: histogram
+    std::vector<int> domain(n);
+    std::vector<size_t> count(outs.size(), 0);
+    for (size_t i=0; i<n; ++i) {
+        domain[i] = domains.get_domain(in.index[i]);
+        ++count[domain[i]];
+    }
+    for (size_t d=0; d<outs.size(); ++d) {
+        VectorMultivec &o(outs[d].gcm_ivalss_s[iAE]);
+        o.index.resize(count[d]);
+        o.weights.resize(count[d]);
+        o.vals.resize(count[d] * nvar);
+    }
+
+    // Pass 2: scatter into place
+    std::vector<size_t> cursor(outs.size(), 0);
+    for (size_t i=0; i<n; ++i) {
+        VectorMultivec &o(outs[domain[i]].gcm_ivalss_s[iAE]);
+        size_t const j = cursor[domain[i]]++;
+        o.index[j] = in.index[i];
+        o.weights[j] = in.weights[i];
+        std::copy(&in.vals[i*nvar], &in.vals[(i+1)*nvar], &o.vals[j*nvar]);
+    }
+}
+
+/** Helper function: splits a single GCMInput struct into per-domain GCMInput structs
+@param nthreads Split the parts of out (each segment, E1vE0c, wE1) in
+    parallel on up to this many threads; <=0 for one per core. */
 std::vector<GCMInput> split_by_domain(
     GCMInput const &out,
     DomainDecomposer_ModelE const &domainsA,
-    DomainDecomposer_ModelE const &domainsE)
+    DomainDecomposer_ModelE const &domainsE,
+    int nthreads = 0)
 {
     using namespace spsparse;
 
@@ -623,45 +795,60 @@ std::vector<GCMInput> split_by_domain(
     for (size_t i=0; i<ndomains; ++i)
         outs.push_back(GCMInput(nvar));
 
-    size_t strideb = sizeof(GCMInput);
+    // (E1vE0 is not set the first time around; in that case, shape = (-1,-1)
+    bool const has_E1vE0c = (out.E1vE0c.shape()[0] != -1);
+    if (has_E1vE0c) {
+        for (size_t i=0; i<outs.size(); ++i) outs[i].E1vE0c.set_shape(out.E1vE0c.shape());
+    }
 
-    // Split each element of parallel sparse vectors
+    // Each part of out is split independently, into different parts of outs
+    std::vector<std::function<void()>> tasks;
+    size_t nelem = 0;
     for (int iAE=0; iAE != (int)IndexAE::COUNT; ++iAE) {
-        auto &gcm_ivalsX(out.gcm_ivalss_s[iAE]);
-        DomainDecomposer_ModelE const &domainsX(*domainsAE[iAE]);
-
-        for (size_t i=0; i<out.gcm_ivalss_s[iAE].index.size(); ++i) {
-            // Convert from index to tuple
-            long const iA(gcm_ivalsX.index[i]);
-
-            // Figure out MPI domain of the resulting tuple
-            int idomain = domainsX.get_domain(iA);
-
-            // Add our values to the appropriate MPI domain
-            outs[idomain].gcm_ivalss_s[iAE].add(
-                iA, &gcm_ivalsX.vals[i*nvar[iAE]], gcm_ivalsX.weights[i]);
-        }
+        nelem += out.gcm_ivalss_s[iAE].size();
+        tasks.push_back([&out,&domainsAE,&outs,iAE]() {
+            split_multivec(out.gcm_ivalss_s[iAE], *domainsAE[iAE], outs, iAE); });
+    }
+    // E1vE0 weights (only present if E1vE0c is unscaled)
+    nelem += out.wE1.size();
+    tasks.push_back([&out,&domainsE,&outs]() {
+        split_tuples(out.wE1, domainsE, outs, &GCMInput::wE1); });
+    // Works for matrix in A or E
+    if (has_E1vE0c) {
+        nelem += out.E1vE0c.size();
+        tasks.push_back([&out,&domainsE,&outs]() {
+            split_tuples(out.E1vE0c, domainsE, outs, &GCMInput::E1vE0c); });
     }
 
-    // Split E1vE0
-    // (E1vE0 is not set the first time around; in that case, shape = (-1,-1)
-    if (out.E1vE0c.shape()[0] != -1) {
-        auto shape(out.E1vE0c.shape());
+    // Don't bother with threads for small problems
+    size_t const min_per_thread = 100000;
+    if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::min((size_t)nthreads, std::min(tasks.size(),
+        std::max((size_t)1, nelem / min_per_thread)));
 
-        // Initialize output matrices
-        for (size_t i=0; i<outs.size(); ++i) outs[i].E1vE0c.set_shape(shape);
+    if (nthreads == 1) {
+        for (auto &task : tasks) task();
+        return outs;
+    }
 
-        // Copy the main matrix
-        // Works for matrix in A or E
-        for (auto &tp : out.E1vE0c.tuples) {
-            int const domain = domainsE.get_domain(tp.index(0));
-            outs[domain].E1vE0c.add(tp.index(), tp.value());
-        }
+    std::atomic<size_t> next_task(0);
+    std::vector<std::exception_ptr> errors(nthreads);
+    std::vector<std::thread> threads;
+    for (int i=0; i<nthreads; ++i) {
+        threads.push_back(std::thread([&tasks,&next_task,&errors,i]() {
+            try {
+                for (size_t k; (k = next_task++) < tasks.size(); ) tasks[k]();
+            } catch(...) {
+                errors[i] = std::current_exception();
+            }
+        }));
     }
+    for (auto &thread : threads) thread.join();
+    for (auto &error : errors) if (error) std::rethrow_exception(error);
+
     return outs;
 }
 
-
 // =======================================================
 // Called from LISheetIceBin::couple()
 /**
@@ -758,38 +945,66 @@ printf("domainA size=%ld base_hc=%d  nhc_ice=%d\n", domainA.data.size(), base_hc
     for (VarSet const &vs : self->gcm_inputs) sizes.push_back(vs.size());
     GCMInput out(sizes);
 
-    if (self->am_i_root()) {
-        // =================== MPI ROOT =============================
-        std::vector<VectorMultivec> every_gcm_ovalsE_s;
-        boost::mpi::gather(self->gcm_params.world, gcm_ovalsE_s,
-            every_gcm_ovalsE_s, self->gcm_params.gcm_root);
+    if (self->distribute_sheets) {
+        // =================== DISTRIBUTED ICE SHEETS ===============
+        // Gather our input to each sheet root (and to root, for logging)
+        std::set<int> gather_ranks(self->sheet_roots.begin(), self->sheet_roots.end());
+        if (self->gcm_params.icebin_logging) gather_ranks.insert(self->gcm_params.gcm_root);
 
-        // Concatenate coupler inputs
-        VectorMultivec gcm_ovalsE_s(concatenate(every_gcm_ovalsE_s));
+        VectorMultivec all_gcm_ovalsE_s(self->gcm_outputsE.size());
+        for (int rank : gather_ranks) {
+            transport::gather(self->gcm_params.world, gcm_ovalsE_s,
+                all_gcm_ovalsE_s, rank);
+        }
+
+        // Each rank produces part of the GLOBAL output
+        // (update_topo() on root; the ice sheets on their sheet roots)
+        GCMInput part(self->couple(time_s, all_gcm_ovalsE_s, run_ice));
+
+        // Send each part to the MPI domain it belongs to; and merge
+        // what we receive (reduce-scatter)
+        std::vector<GCMInput> every_outs;
+        {profile::Timer timer("split_by_domain");
+            every_outs = split_by_domain(part, *self->domains, *self->domains);
+        }
+        std::vector<GCMInput> every_ins;
+        boost::mpi::all_to_all(self->gcm_params.world, every_outs, every_ins);
+        out = merge_by_domain(every_ins);
+
+    } else if (self->am_i_root()) {
+        // =================== MPI ROOT =============================
+        // Gather and concatenate coupler inputs
+        VectorMultivec all_gcm_ovalsE_s(self->gcm_outputsE.size());
+        transport::gather(self->gcm_params.world, gcm_ovalsE_s,
+            all_gcm_ovalsE_s, self->gcm_params.gcm_root);
 
         // Couple on root!
         // out contains GLOBAL output for all MPI ranks
-        out = self->couple(time_s, gcm_ovalsE_s, run_ice);  // move semantics
+        out = self->couple(time_s, all_gcm_ovalsE_s, run_ice);  // move semantics
 
         // Split up the output (and 
-        std::vector<GCMInput> every_outs(
-            split_by_domain(out, *self->domains, *self->domains));
+        std::vector<GCMInput> every_outs;
+        {profile::Timer timer("split_by_domain");
+            every_outs = split_by_domain(out, *self->domains, *self->domains);
+        }
 
         // Scatter!
-        boost::mpi::scatter(self->gcm_params.world, every_outs, out, self->gcm_params.gcm_root);
+        transport::scatter(self->gcm_params.world, every_outs, out, self->gcm_params.gcm_root);
 
 
     } else {
         // =================== NOT MPI ROOT =============================
         // Send our input to root
-        boost::mpi::gather(self->gcm_params.world, gcm_ovalsE_s, self->gcm_params.gcm_root);
+        VectorMultivec dummy(self->gcm_outputsE.size());
+        transport::gather(self->gcm_params.world, gcm_ovalsE_s,
+            dummy, self->gcm_params.gcm_root);
 
         // Let root do the work...
         // update_topo() is built into this
         self->couple(time_s, gcm_ovalsE_s, run_ice);
 
         // Receive our output back from root
-        boost::mpi::scatter(self->gcm_params.world, out, self->gcm_params.gcm_root);
+        transport::scatter(self->gcm_params.world, {}, out, self->gcm_params.gcm_root);
     }
 
     // 1. Copies values back into modele.gcm_ivals from scatterd MPI stuff
@@ -986,8 +1201,9 @@ TupleListLT<1> &wEAm_base)   // Clear; then store wEAm in here
         dynamic_cast<GCMRegridder_WrapE *>(&*gcm_regridder));
     GCMRegridder_ModelE const *gcmA(gcmW->gcmA.get());
 
-    // Read from TOPOO file
-    ibmisc::ArrayBundle<double,2> topoo(topoo_bundle(BundleOType::MERGEO, topoO_fname));
+    // Copy static TOPOO fields (loaded in _ncread()); merge_topoO() writes into these
+    ibmisc::ArrayBundle<double,2> topoo(topoo_base);
+    for (auto &d : topoo.data) d.arr.reference(d.arr.copy());
         auto &foceanOp(topoo.array("FOCEANF"));
         auto &fgiceOp(topoo.array("FGICEF"));
         auto &zatmoOp(topoo.array("ZATMOF"));
@@ -1069,7 +1285,7 @@ TupleListLT<1> &wEAm_base)   // Clear; then store wEAm in here
     std::vector<std::string> errors2(make_topoA(
         foceanOm, flakeOm, fgrndOm, fgiceOm, zatmoOm, zlakeOm, zicetopO,
         zland_minO, zland_maxO, mergemaskO,
-        gcmA->hspecO(), gcmA->hspecA(), gcmA->indexingHC, gcmA->hcdefs(), underice_hc,
+        *gcmA->hntr_AAvAO, gcmA->indexingHC, gcmA->hcdefs(), underice_hc,
         AAmvEAm,
         foceanA, flakeA, fgrndA, fgiceA, zatmoA, hlakeA, zicetopA,
         zland_minA, zland_maxA, mergemaskA,
@@ -1176,8 +1392,9 @@ bool run_ice)    // if false, only initialize
     // Call superclass coupling for starters
     GCMInput out(this->GCMCoupler::couple(time_s, gcm_ovalsE, run_ice));
 
-    // Nothing more to do unless we're root
-    if (!gcm_params.am_i_root()) return out;
+    // Only root updates TOPO
+    // (but with distribute_sheets, other ranks have outputs to scale)
+    if (gcm_params.am_i_root()) {
 
     // Run update_topo()
     TupleListLT<1> wEAm_base;  // set by update_topo()
@@ -1192,11 +1409,13 @@ bool run_ice)    // if false, only initialize
             emI_lands.push_back(ice_coupler->emI_land);
         }
 
+        profile::Timer timer("update_topo");
         update_topo(time_s, run_ice, emI_lands, emI_ices, out, wEAm_base);
     }
 
 
     // Log the results
+    // (Just this rank's part of the output if distribute_sheets)
     if (gcm_params.icebin_logging) {
         std::string fname = "gcm-in-" + sdate(time_s) + ".nc";
         NcIO ncio(fname, 'w');
@@ -1206,6 +1425,7 @@ bool run_ice)    // if false, only initialize
         ncio_gcm_input(ncio, out, timespan, time_unit, "");
         ncio();
     }
+    }    // if root
 
     // ---------- Apply scaling to gcm_ivalsA_s, originally set in gcmce_add_xxx()
 
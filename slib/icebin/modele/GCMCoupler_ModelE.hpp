@@ -23,6 +23,8 @@
 #include <icebin/GCMCoupler.hpp>
 #include <icebin/modele/GCMRegridder_ModelE.hpp>
 #include <icebin/vectorsparse.hpp>
+#include <icebin/mapped_file.hpp>
+#include <ibmisc/bundle.hpp>
 
 namespace icebin {
 namespace modele {
@@ -61,7 +63,8 @@ struct ModelEParams
 class DomainDecomposer_ModelE {
     ibmisc::Domain domainA_global;
     size_t ndomain;
-    blitz::Array<int,1> rank_of_j;    // indexing base=1
+    long nA;                          // Size of the (global) A grid
+    std::vector<int> rank_of_iA;      // MPI rank of each iA (zero-based)
 public:
 
     DomainDecomposer_ModelE(std::vector<int> const &endj, ibmisc::Domain const &_domainA_global);
@@ -71,11 +74,8 @@ public:
 
     /** Returns the MPI rank of grid cell.  Works if ix is iA (atmosphere grid) or iE (elevation grid) */
     int get_domain(long ix) const {    // zero-based
-        auto im_world(domainA_global[0].end);
-        auto jm_world(domainA_global[1].end);
-
-        int j = (ix / im_world) % jm_world;    // +0 for 0-based indexing
-        return rank_of_j(j);
+        // iE = iA + nA*ihc, so ix % nA is iA in either case
+        return rank_of_iA[ix % nA];
     }
 };
 
@@ -109,8 +109,8 @@ public:
     double dtsrc;
     ModelEParams const *rdparams;    // Params straight from the rundeck (came during init; memory is from Fortran structure)
 
-    /** On root: separate global stuff back into individual domains.
-    Works for A and E grids. */
+    /** On root (all ranks if distribute_sheets): separate global
+    stuff back into individual domains.  Works for A and E grids. */
     std::unique_ptr<DomainDecomposer_ModelE> domains;
 
     // ================== ModelE Outputs
@@ -137,6 +137,18 @@ public:
     program, sans ice sheets) */
     std::string topoO_fname;
 
+    /** (OPTIONAL) Raw binary cache of the static TOPOO fields.  If
+    set, topoo_base is memory-mapped (read-only) from here, so MPI
+    root processes on one node share a single copy.  Written
+    (from topoO_fname) if missing or out of date. */
+    std::string topoO_mmap_fname;
+
+    /** Static fields of topoO_fname (topoo_bundle(BundleOType::MERGEO)).
+    Loaded once by _ncread(); they never change during a run.
+    update_topo() merges into a copy of this. */
+    ibmisc::ArrayBundle<double,2> topoo_base;
+    std::unique_ptr<MappedFile> topoo_mmap;    // Backs topoo_base, if mapped
+
     /** Name of file on ocean grid containing the EvA matrix for global (non-IceBin) ice. */
     std::string global_ecO_fname;
 
@@ -206,6 +218,9 @@ public:
 
     int _read_nhc_gcm();
 
+    /** Loads topoo_base from topoO_fname (or topoO_mmap_fname) */
+    void load_topoo_base();
+
     /** Copies GCM inputs back to original GCM-supplied sparse input arrays */
     void apply_gcm_ivals(GCMInput const &out);
 
@@ -220,9 +235,8 @@ public:
 
 // ===============================================================
 // The "gcmce_*" interface used by Fortran ModelE
-// These headers are NOT needed, they are repeated in api_f.f90
+// (repeated in api_f.f90; declared here for C++ drivers, eg oneway)
 
-#if 0
 extern "C"
 GCMCoupler_ModelE *gcmce_new(
     ModelEParams const &_rdparams,
@@ -288,18 +302,6 @@ double mm, double bb,
 int initial,    // bool
 char const *long_name_f, int long_name_len);
 
-extern "C"
-void gcmce_reference_globals(
-    GCMCoupler_ModelE *self,
-    ibmisc::F90Array<double, 3> fhc,
-    ibmisc::F90Array<int, 3> underice,
-    ibmisc::F90Array<double, 3> elevE,
-    ibmisc::F90Array<double, 2> focean,
-    ibmisc::F90Array<double, 2> flake,
-    ibmisc::F90Array<double, 2> fgrnd,
-    ibmisc::F90Array<double, 2> fgice,
-    ibmisc::F90Array<double, 2> zatmo);
-
 extern "C"
 void gcmce_io_rsf(GCMCoupler_ModelE *self,
     char *fname_c, int fname_n, char rw);
@@ -307,8 +309,6 @@ void gcmce_io_rsf(GCMCoupler_ModelE *self,
 extern "C"
 void gcmce_model_start(GCMCoupler_ModelE *self, bool cold_start, int yeari, int itimei, double dtsrc);
 
-#endif
-
 extern "C"
 void gcmce_couple_native(GCMCoupler_ModelE *self,
 int itime,
@@ -99,16 +99,12 @@ static std::unique_ptr<linear::Weighted_Eigen> compute_AOmvAAm(
     auto &dimAAm(*dims[1]);
 
 
-    // Obtain hntrA and hntrO for process below.
-    GridSpec_LonLat const &specO(gcmA->specO());
     GridSpec_LonLat const &specA(gcmA->specA());
 
-    Hntr hntr_XOmvXAm(17.17, specO.hntr, specA.hntr);
-
     std::unique_ptr<linear::Weighted_Eigen> ret(new linear::Weighted_Eigen(dims, true));    // conservative
     reset_ptr(ret->M, MakeDenseEigenT(
         std::bind(&Hntr::overlap<MakeDenseEigenT::AccumT,DimClip>,
-            &hntr_XOmvXAm, _1, specA.eq_rad, DimClip(&dimAOm)),
+            &*gcmA->hntr_AOvAA, _1, specA.eq_rad, DimClip(&dimAOm)),
         {SparsifyTransform::TO_DENSE_IGNORE_MISSING, SparsifyTransform::ADD_DENSE},
         {&dimAOm, &dimAAm}, transpose).to_eigen());
 
@@ -191,9 +187,6 @@ ComputeXAmvGp_Helper::ComputeXAmvGp_Helper(
 
     EigenColVectorT wAOm_e(compute_wAOm(foceanAOp, foceanAOm, wAOp, dimAOp, dimAOm));
 
-    HntrSpec const &hntrA(cast_GridSpec_LonLat(*gcmA->agridA->spec).hntr);
-    HntrSpec const &hntrO(cast_GridSpec_LonLat(*gcmA->gcmO->agridA->spec).hntr);
-
     dimXAm.set_sparse_extent(gcmA->nAE(gridX));
     dimIp.set_sparse_extent(rmO->ice_regridder->nG(gridG));
 
@@ -236,7 +229,7 @@ ComputeXAmvGp_Helper::ComputeXAmvGp_Helper(
         blitz::Array<double,1> wXOm(to_blitz(*wXOm_e));
         reset_ptr(XAmvXOm, MakeDenseEigenT(    // TODO: Call this XAvXO, since it's the same 'm' or 'p'
             std::bind(&raw_EOvEA, _1,
-                hntrO, hntrA,
+                std::cref(*gcmA->hntr_AOvAA),
                 eq_rad, &dimAOm, wXOm,
                 gcmA->nhc(), gcmA->gcmO->indexingHC, gcmA->indexingHC),
             {SparsifyTransform::TO_DENSE_IGNORE_MISSING, SparsifyTransform::ADD_DENSE},
@@ -258,10 +251,9 @@ ComputeXAmvGp_Helper::ComputeXAmvGp_Helper(
         SparseSetT &dimAAm(dimXAm);
 
         // Actually AOmvAAm
-        Hntr hntr_XOmvXAm(17.17, hntrO, hntrA);
         reset_ptr(XAmvXOm, MakeDenseEigenT(
             std::bind(&Hntr::overlap<MakeDenseEigenT::AccumT,DimClip>,
-                &hntr_XOmvXAm, _1, eq_rad, DimClip(&dimAOm)),
+                &*gcmA->hntr_AOvAA, _1, eq_rad, DimClip(&dimAOm)),
             {SparsifyTransform::TO_DENSE_IGNORE_MISSING, SparsifyTransform::ADD_DENSE},
             {&dimAOm, &dimAAm}, 'T').to_eigen());
     }
@@ -455,6 +447,11 @@ GCMRegridder_ModelE::GCMRegridder_ModelE(
         {gcmO->indexingHC.indices()[0], gcmO->indexingHC.indices()[1]});
     indexingE = derive_indexingE(agridA->indexing, indexingHC);
 
+    hntr_AOvAA.reset(new Hntr(17.17, hspecO(), hspecA()));
+    hntr_AOvAA->precompute();
+    hntr_AAvAO.reset(new Hntr(17.17, hspecA(), hspecO()));
+    hntr_AAvAO->precompute();
+
     // Read number of global EC's out of global EC matrix file.
     if (global_ecO == "") {
         global_hcdefs.clear();
@@ -473,10 +470,12 @@ printf("Opening global_ecO = %s\n", global_ecO.c_str());
     // Read EOpvAOp_base from global_ec file
     // Read metadata and global EOpvAOp matrix (from output of global_ec.cpp)
     if (global_ecO != "") {
+        ZArray<int,double,2> EOpvAOp_c;    // from linear::Weighted_Compressed
         {NcIO ncio(global_ecO, 'r');
             // metaO.ncio(ncio);   // no metaO in this class
-            EOpvAOp_base.ncio(ncio, "EvO.M");
+            EOpvAOp_c.ncio(ncio, "EvO.M");
         }
+        EOpvAOp_base = EOpvAOpBase(EOpvAOp_c, &*gcmO);
     }
 
 }
@@ -619,8 +618,7 @@ linear::Weighted_Tuple GCMRegridder_ModelE::global_AvE(
     return _compute_AAmvEAm(
         scale,
         specO.eq_rad,
-        cast_GridSpec_LonLat(*this->gcmO->agridA->spec).hntr,
-        cast_GridSpec_LonLat(*this->agridA->spec).hntr,
+        *this->hntr_AOvAA,
         this->gcmO->indexingHC,
         this->indexingHC,
         foceanAOp,
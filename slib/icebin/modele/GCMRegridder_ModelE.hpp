@@ -4,6 +4,8 @@
 #include <ibmisc/linear/eigen.hpp>
 #include <icebin/GCMRegridder.hpp>
 #include <icebin/modele/grids.hpp>
+#include <icebin/modele/hntr.hpp>
+#include <icebin/modele/merge_topo.hpp>
 
 namespace icebin {
 namespace modele {
@@ -127,8 +129,16 @@ public:
     This is typically loaded directly from a NetCDF file. */
     std::shared_ptr<icebin::GCMRegridder_Standard> const gcmO;
 
-    /** Base EOpvAOp matrix, laoded from TOPO_OC file */
-    ibmisc::ZArray<int,double,2> EOpvAOp_base;    // from linear::Weighted_Compressed; UNSCALED
+    /** Base EOpvAOp matrix, loaded from TOPO_OC file.  Decompressed
+    once on load, and partitioned by whether gcmO's ice sheets touch
+    each AOp cell (see EOpvAOpBase). */
+    EOpvAOpBase EOpvAOp_base;    // UNSCALED
+
+    /** Hntr operators between AO and AA.  Both grids are static, so
+    these are pre-computed once (see Hntr::precompute()) and re-used
+    by the topo code; clip them with DimClip as usual. */
+    std::unique_ptr<Hntr> hntr_AOvAA;    // dimB=O, dimA=A: overlaps
+    std::unique_ptr<Hntr> hntr_AAvAO;    // dimB=A, dimA=O: regrid O fields to A
 
     /** Constructor used in coupler: create the GCMRegridder first,
         then fill in foceanAOp and foceanAOm later.
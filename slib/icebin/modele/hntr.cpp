@@ -79,6 +79,42 @@ Hntr::Hntr(double yp17, HntrSpec const &_Bgrid, HntrSpec const &_Agrid, double _
     partition_north_south();
 }
 
+/** Accumulator for Hntr::matrix() that records its raw output */
+class CSRAccum {
+    Hntr::CSR &M;
+public:
+    CSRAccum(Hntr::CSR &_M) : M(_M) {}
+
+    void clear() {}
+
+    void addA(int const IJA, double const FG)
+    {
+        M.IJA.push_back(IJA);
+        M.FG.push_back(FG);
+    }
+
+    void finishB(int const IJB, int const JB)
+    {
+        // B cells with nothing before this one get empty rows
+        while ((int)M.row_begin.size() < IJB) M.row_begin.push_back(M.IJA.size());
+        M.row_begin.push_back(M.IJA.size());
+    }
+};
+
+void Hntr::precompute()
+{
+    std::shared_ptr<CSR> M(new CSR);
+    M->row_begin.reserve(Bgrid.spec.size()+1);
+    M->row_begin.push_back(0);
+
+    csr.reset();
+    matrix(CSRAccum(*M), IncludeConst<int,true>());
+    while ((int)M->row_begin.size() < Bgrid.spec.size()+1)
+        M->row_begin.push_back(M->IJA.size());
+
+    csr = M;
+}
+
 // Partitions in east-west (I) direction
 // Domain, around the globe, is scaled to fit from 0 to IMA*Bgrid.spec.im
 void Hntr::partition_east_west()
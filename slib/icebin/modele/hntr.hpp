@@ -1,6 +1,8 @@
 #ifndef ICEBIN_HNTR_HPP
 #define ICEBIN_HNTR_HPP
 
+#include <memory>
+#include <vector>
 #include <ibmisc/blitz.hpp>
 #include <ibmisc/indexing.hpp>
 #include <icebin/eigen_types.hpp>
@@ -87,6 +89,15 @@ public:
     // cell (IB,JB) has integrated value 0 of WTA
     double DATMIS;
 
+    /** The (A,FG) pairs matrix() generates for each B grid cell, in
+    CSR form.  Set by precompute(). */
+    struct CSR {
+        std::vector<int> row_begin;    // One row per B cell (IJB-1), plus end
+        std::vector<int> IJA;          // 1-based
+        std::vector<double> FG;
+    };
+    std::shared_ptr<CSR const> csr;
+
 public:
 
 
@@ -99,6 +110,11 @@ public:
 
     Hntr(double yp17, HntrSpec const &_B, HntrSpec const &_A, double _DATMIS=0.0);
 
+    /** Runs the overlap computation once and stores it (see CSR).
+    Later overlap(), scaled_regrid_matrix() and regrid() calls replay
+    it, with identical results; includeB just masks rows. */
+    void precompute();
+
 
 
 
@@ -137,11 +153,28 @@ public:
         blitz::Array<double,RANK> const &A,
         bool mean_polar = false) const;
 
+    /** Regrids many fields sharing the same WTA, in a single pass
+    over the overlaps.  Equivalent to calling regrid(WTA, As[i], Bs[i])
+    for each i.
+    @param As Fields on grid A
+    @param Bs Fields on grid B (written) */
+    template<class WeightT, int RANK>
+    void regrid(
+        blitz::Array<WeightT,RANK> const &_WTA,
+        std::vector<blitz::Array<double,RANK>> const &As,
+        std::vector<blitz::Array<double,RANK>> const &Bs,
+        bool mean_polar=false,
+        double wtm=1.0, double wtb=0.0) const;
+
 
 private:
     void partition_east_west();
     void partition_north_south();
 
+    /** Replace individual values near the poles by longitudinal mean */
+    template<class DestT>
+    void mean_polar_B(blitz::Array<DestT,1> &B) const;
+
     // Default function argument for overlap() template below
     template<typename Typ, bool Val>
     struct IncludeConst
@@ -173,14 +206,14 @@ public:
     void overlap(
         AccumT &&accum,        // The output (sparse) matrix; 0-based indexing
         double const eq_rad,        // Radius of the Earth
-        IncludeT includeB = IncludeT());
+        IncludeT includeB = IncludeT()) const;
 
     /** Produces a scaled regrid matrix, without the extra baggage.
     Equivalent to running overlap() and then scaling. */
     template<class AccumT, class IncludeT = IncludeConst<int,true>>
     void scaled_regrid_matrix(
         AccumT &&accum,        // The output (sparse) matrix; 0-based indexing
-        IncludeT includeB = IncludeT());
+        IncludeT includeB = IncludeT()) const;
 };    // class Hntr
 
 
@@ -206,6 +239,23 @@ void Hntr::matrix(
     MatAccumT &&mataccum,        // The output (sparse) matrix; 0-based indexing
     IncludeT includeB) const
 {
+    // ------------------
+    // Replay the pre-computed overlaps
+    if (csr.get()) {
+        CSR const &M(*csr);
+        for (int JB=1; JB <= Bgrid.spec.jm; ++JB) {
+        for (int IB=1; IB <= Bgrid.spec.im; ++IB) {
+            int const IJB = IB + Bgrid.spec.im * (JB-1);
+            if (!includeB(IJB-1)) continue;
+
+            mataccum.clear();
+            for (int k=M.row_begin[IJB-1]; k < M.row_begin[IJB]; ++k)
+                mataccum.addA(M.IJA[k], M.FG[k]);
+            mataccum.finishB(IJB, JB);
+        }}
+        return;
+    }
+
     // ------------------
     // Interpolate the A grid onto the B grid
     for (int JB=1; JB <= Bgrid.spec.jm; ++JB) {
@@ -287,7 +337,7 @@ template<class AccumT, class IncludeT>
 void Hntr::overlap(
     AccumT &&accum,        // The output (sparse) matrix; 0-based indexing
     double const eq_rad,        // Radius of the Earth
-    IncludeT includeB)
+    IncludeT includeB) const
 {
     matrix(OverlapMatAccum<AccumT>(std::move(accum), Bgrid, eq_rad*eq_rad), includeB);
 }
@@ -331,7 +381,7 @@ public:
 template<class AccumT, class IncludeT>
 void Hntr::scaled_regrid_matrix(
     AccumT &&accum,        // The output (sparse) matrix; 0-based indexing
-    IncludeT includeB)
+    IncludeT includeB) const
 {
     matrix(
         ScaledRegridMatAccum<AccumT>(std::move(accum), Agrid),
@@ -410,29 +460,125 @@ void Hntr::regrid(
         RegridAccum<WeightT,SrcT,DestT>(WTA, A, B, DATMIS, wtm, wtb),
         IncludeConst<int,true>());
 
-    if (mean_polar) {
-        // Replace individual values near the poles by longitudinal mean
-        for (int JB=1; JB <= Bgrid.spec.jm; JB += Bgrid.spec.jm-1) {
-            double BMEAN  = DATMIS;
-            double WEIGHT = 0;
-            double VALUE  = 0;
-            for (int IB=1; ; ++IB) {
-                if (IB > Bgrid.spec.im) {
-                    if (WEIGHT != 0) BMEAN = VALUE / WEIGHT;
-                    break;
-                }
-                int IJB = IB + Bgrid.spec.im * (JB-1);
-                if (B(IJB) == DATMIS) break;
-                WEIGHT += 1;
-                VALUE  += B(IJB);
-            }
-            for (int IB=1; IB <= Bgrid.spec.im; ++IB) {
-                int IJB = IB + Bgrid.spec.im * (JB-1);
-                B(IJB) = BMEAN;
+    if (mean_polar) mean_polar_B(B);
+}
+
+template<class DestT>
+void Hntr::mean_polar_B(blitz::Array<DestT,1> &B) const
+{
+    // Replace individual values near the poles by longitudinal mean
+    for (int JB=1; JB <= Bgrid.spec.jm; JB += Bgrid.spec.jm-1) {
+        double BMEAN  = DATMIS;
+        double WEIGHT = 0;
+        double VALUE  = 0;
+        for (int IB=1; ; ++IB) {
+            if (IB > Bgrid.spec.im) {
+                if (WEIGHT != 0) BMEAN = VALUE / WEIGHT;
+                break;
             }
+            int IJB = IB + Bgrid.spec.im * (JB-1);
+            if (B(IJB) == DATMIS) break;
+            WEIGHT += 1;
+            VALUE  += B(IJB);
+        }
+        for (int IB=1; IB <= Bgrid.spec.im; ++IB) {
+            int IJB = IB + Bgrid.spec.im * (JB-1);
+            B(IJB) = BMEAN;
         }
     }
 }
+// ----------------------------------------------------------
+/** Like RegridAccum, for many fields at once.  Source values are
+interleaved (field fastest), so the inner loop runs over contiguous
+memory. */
+template<class WeightT>
+class MultiRegridAccum {
+    blitz::Array<WeightT,1> &WTA;
+    std::vector<double> const &A;    // A[(IJA-1)*nfield + ifield]
+    std::vector<blitz::Array<double,1>> &Bs;
+    int const nfield;
+    double const DATMIS;
+    double const wtm;
+    double const wtb;
+
+    double WEIGHT;
+    std::vector<double> VALUE;
+
+public:
+    MultiRegridAccum(
+        blitz::Array<WeightT,1> &_WTA,
+        std::vector<double> const &_A,
+        std::vector<blitz::Array<double,1>> &_Bs,
+        double _DATMIS,
+        double _wtm, double _wtb)    // Use wtm * WTA + wtb for weight
+    : WTA(_WTA), A(_A), Bs(_Bs), nfield(_Bs.size()),
+        DATMIS(_DATMIS), wtm(_wtm), wtb(_wtb), VALUE(nfield) {}
+
+    void clear()
+    {
+        WEIGHT = 0.;
+        for (int k=0; k<nfield; ++k) VALUE[k] = 0.;
+    }
+
+    void addA(int const IJA, double const FG)
+    {
+        double const wta = wtm * WTA(IJA) + wtb;
+        double const wt = FG * wta;
+        WEIGHT += wt;
+        double const *Ak = &A[(IJA-1)*nfield];
+        for (int k=0; k<nfield; ++k) VALUE[k] += wt * Ak[k];
+    }
+
+    void finishB(int const IJB, int const JB)
+    {
+        for (int k=0; k<nfield; ++k)
+            Bs[k](IJB) = (WEIGHT == 0 ? DATMIS : VALUE[k] / WEIGHT);
+    }
+};
+
+template<class WeightT, int RANK>
+void Hntr::regrid(
+    blitz::Array<WeightT,RANK> const &_WTA,
+    std::vector<blitz::Array<double,RANK>> const &As,
+    std::vector<blitz::Array<double,RANK>> const &_Bs,
+    bool mean_polar,
+    double wtm, double wtb) const
+{
+    if (As.size() != _Bs.size()) (*icebin_error)(-1,
+        "Number of source (%ld) and destination (%ld) fields must match",
+        As.size(), _Bs.size());
+    int const nfield = As.size();
+    int const nA = Agrid.spec.size();
+
+    // Reshape to 1-D
+    auto WTA(ibmisc::reshape1(_WTA, 1));
+    std::vector<blitz::Array<double,1>> Bs;
+    for (auto &B : _Bs) Bs.push_back(ibmisc::reshape1(B, 1));
+
+    // Check array dimensions
+    if (WTA.extent(0) != nA) (*icebin_error)(-1,
+        "Error in dimensions: WTA %d vs. %d\n", WTA.extent(0), nA);
+    for (int k=0; k<nfield; ++k) {
+        if ((As[k].size() != nA) || (Bs[k].extent(0) != Bgrid.spec.size()))
+            (*icebin_error)(-1, "Error in dimensions of field %d: (%ld, %d) vs. (%d, %d)\n",
+                k, (long)As[k].size(), Bs[k].extent(0), nA, Bgrid.spec.size());
+    }
+
+    // Interleave source fields
+    std::vector<double> A(nA * nfield);
+    for (int k=0; k<nfield; ++k) {
+        auto Ak(ibmisc::reshape1(As[k], 1));
+        for (int IJA=1; IJA <= nA; ++IJA) A[(IJA-1)*nfield + k] = Ak(IJA);
+    }
+
+    matrix(
+        MultiRegridAccum<WeightT>(WTA, A, Bs, DATMIS, wtm, wtb),
+        IncludeConst<int,true>());
+
+    if (mean_polar) {
+        for (auto &B : Bs) mean_polar_B(B);
+    }
+}
 
 /** Creates a HntrSpec for the Atmosphere grid by halving a HntrSpec
 for the Ocean grid.  Relies on this 2-to-1 relationship of ocean to
@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <limits>
 #include <icebin/modele/merge_topo.hpp>
 #include <icebin/modele/topo.hpp>
 #include <icebin/modele/grids.hpp>
 #include <icebin/eigen_types.hpp>
+#include <icebin/error.hpp>
 #include <ibmisc/linear/compressed.hpp>
 #include <ibmisc/const.hpp>
 
@@ -372,6 +374,68 @@ Indexing indexingHC_change_nhc(Indexing const &indexingHC0, int nhc)
 }
 
 
+EOpvAOpBase::EOpvAOpBase(
+ibmisc::ZArray<int,double,2> const &EOpvAOp_base,
+GCMRegridder_Standard const *gcmO)
+: shape(EOpvAOp_base.shape()), offsetE(gcmO->indexingE.extent())
+{
+    // AOp cells overlapped by some ice sheet
+    std::vector<char> touchedA(shape[1], 0);
+    for (size_t sheet_index=0; sheet_index < gcmO->ice_regridders().index.size(); ++sheet_index) {
+        ExchangeGrid const &aexgrid(gcmO->ice_regridders()[sheet_index]->aexgrid);
+        for (int id=0; id<aexgrid.dense_extent(); ++id) {
+            long const iA = aexgrid.ijk(id,0);
+            if (iA >= 0 && iA < shape[1]) touchedA[iA] = 1;
+        }
+    }
+
+    // Decompress (just once), splitting into the two partitions
+    struct Elt {
+        long iA, iE;
+        double val;
+        bool operator<(Elt const &o) const
+            { return (iA < o.iA) || (iA == o.iA && iE < o.iE); }
+    };
+    std::vector<Elt> touched, untouched_elts;
+    for (auto ii(EOpvAOp_base.generator()); ++ii; ) {
+        Elt const elt {ii->index(1), ii->index(0) + offsetE, ii->value()};
+        if (touchedA[elt.iA]) touched.push_back(elt);
+        else untouched_elts.push_back(elt);
+    }
+    std::stable_sort(touched.begin(), touched.end());
+    std::stable_sort(untouched_elts.begin(), untouched_elts.end());
+
+    // Touched partition: CSR by AOp
+    touched_iE.reserve(touched.size());
+    touched_val.reserve(touched.size());
+    for (Elt const &elt : touched) {
+        if (touched_iA.size() == 0 || touched_iA.back() != elt.iA) {
+            touched_iA.push_back(elt.iA);
+            touched_ptr.push_back(touched_iE.size());
+        }
+        touched_iE.push_back(elt.iE);
+        touched_val.push_back(elt.val);
+    }
+    touched_ptr.push_back(touched_iE.size());
+
+    // Untouched partition: densify now, once
+    std::shared_ptr<Untouched> u(new Untouched);
+    u->dimEOp.set_sparse_extent(offsetE + shape[0]);
+    u->dimAOp.set_sparse_extent(shape[1]);
+    TupleListT<2> tl;
+    tl.tuples.reserve(untouched_elts.size());
+    for (Elt const &elt : untouched_elts) {
+        tl.add({u->dimEOp.add_dense(elt.iE), u->dimAOp.add_dense(elt.iA)}, elt.val);
+    }
+    u->M.resize(u->dimEOp.dense_extent(), u->dimAOp.dense_extent());
+    u->M.setFromTriplets(tl.begin(), tl.end());
+    untouched = std::move(u);
+
+    printf("EOpvAOpBase: %ld elements in %ld touched AOp cells, %ld untouched\n",
+        (long)touched_val.size(), (long)touched_iA.size(), (long)untouched->M.nonZeros());
+}
+
+
 EOpvAOpResult compute_EOpvAOp_merged(  // (generates in dense indexing)
 SparseSetT &dimAOp,    // dimAOp is appended; dimEOp is returned as part of return variable.
 ibmisc::ZArray<int,double,2> const &EOpvAOp_base,    // from linear::Weighted_Compressed; UNSCALED
@@ -385,21 +449,54 @@ std::vector<double> const &hcdefs_base, // [nhc]  Elev class definitions for bas
 Indexing const &indexingHC_base,
 bool squash_ecs,    // Should ECs be merged if they are the same elevation?
 std::vector<std::string> &errors)
+{
+    return compute_EOpvAOp_merged(dimAOp,
+        use_global_ice ? EOpvAOpBase(EOpvAOp_base, gcmO) : EOpvAOpBase(),
+        paramsO, gcmO, eq_rad, emIs, use_global_ice, use_local_ice,
+        hcdefs_base, indexingHC_base, squash_ecs, errors);
+}
+
+EOpvAOpResult compute_EOpvAOp_merged(  // (generates in dense indexing)
+SparseSetT &dimAOp,    // dimAOp is appended; dimEOp is returned as part of return variable.
+EOpvAOpBase const &EOpvAOp_base,    // UNSCALED
+RegridParams paramsO,
+GCMRegridder_Standard const *gcmO,     // A bunch of local ice sheets
+double const eq_rad,    // Radius of the earth
+std::vector<blitz::Array<double,1>> const &emIs,
+bool use_global_ice,
+bool use_local_ice,
+std::vector<double> const &hcdefs_base, // [nhc]  Elev class definitions for base ice
+Indexing const &indexingHC_base,
+bool squash_ecs,    // Should ECs be merged if they are the same elevation?
+std::vector<std::string> &errors)
 {
     EOpvAOpResult ret;    // return variable
 
     // ======================= Create a merged EOpvAOp of base ice and ice sheets
     // (and then call through to _compute_AAmvEAm)
 
-    // Accumulator for merged EOpvAOp (unscaled)
-    MakeDenseEigenT EOpvAOp_m(
-        {SparsifyTransform::ADD_DENSE},   // convert sparse to dense indexing
-        {&ret.dimEOp, &dimAOp}, '.');
-    auto EOpvAOp_accum(EOpvAOp_m.accum());
+    EOpvAOpBase::Untouched const *untouched = nullptr;
+    if (use_global_ice) {
+        if (EOpvAOp_base.offsetE != gcmO->indexingE.extent()) (*icebin_error)(-1,
+            "EOpvAOp_base was partitioned for offsetE=%ld, but gcmO has %ld",
+            EOpvAOp_base.offsetE, (long)gcmO->indexingE.extent());
+        untouched = EOpvAOp_base.untouched.get();
+    }
+
+    // Start from the untouched partition of the base ice, which has
+    // already been densified.  Its dense indices are only valid if
+    // dimAOp is empty coming in.
+    bool const reuse_untouched = (untouched && dimAOp.dense_extent() == 0);
+    if (reuse_untouched) {
+        ret.dimEOp = untouched->dimEOp;
+        dimAOp = untouched->dimAOp;
+    }
+
+    // Everything else is accumulated here (unscaled; dense indexing)
+    TupleListT<2> EOpvAOp_tl;
 
     // Merge in local matrices
     paramsO.scale = false;
-    std::array<long,2> EOpvAOp_sheet_shape {0,0};
     ret.offsetE = 0;
     if (use_local_ice) {
         for (size_t sheet_index=0; sheet_index < gcmO->ice_regridders().index.size(); ++sheet_index) {
@@ -409,16 +506,15 @@ std::vector<std::string> &errors)
             SparseSetT dimEO_sheet, dimAO_sheet;
             std::unique_ptr<ibmisc::linear::Weighted_Eigen> EOpvAOp_sheet(
                 rmO->matrix_d("EvA", {&dimEO_sheet, &dimAO_sheet}, paramsO));
-            EOpvAOp_sheet_shape = EOpvAOp_sheet->shape();
 
             // Merge it in...
             // ECs are same for local ice in merged vs. unmerged case
             // NOTE: Assumes EC dimension in indexing has largest stride
             for (auto ii(begin(*EOpvAOp_sheet->M)); ii != end(*EOpvAOp_sheet->M); ++ii) {
                 // Separate ice sheet ECs from global ECs
-                EOpvAOp_accum.add({
-                    dimEO_sheet.to_sparse(ii->index(0)),
-                    dimAO_sheet.to_sparse(ii->index(1))},
+                EOpvAOp_tl.add({
+                    ret.dimEOp.add_dense(dimEO_sheet.to_sparse(ii->index(0))),
+                    dimAOp.add_dense(dimAO_sheet.to_sparse(ii->index(1)))},
                     ii->value());
             }
         }
@@ -431,19 +527,29 @@ std::vector<std::string> &errors)
     // Merge in global matrix
     std::array<long,2> EOpvAOp_base_shape {0,0};
     if (use_global_ice) {
-        ret.offsetE = gcmO->indexingE.extent();
-        // Merge in global matrix (compressed format; sparse indexing)
-        EOpvAOp_base_shape = EOpvAOp_base.shape();  // sparse shape of ZArray
-
-        // printf("EOpvAOp_base_shape = [%d %d] (NHC=%g)\n", EOpvAOp_base_shape[0], EOpvAOp_base_shape[1], (double)EOpvAOp_base_shape[0] / (double)EOpvAOp_base_shape[1]);
-
-        // Copy elements to accumulator matrix
-        for (auto ii(EOpvAOp_base.generator()); ++ii; ) {
-            auto iE(ii->index(0));   // In case iE occurs more than once in M
+        ret.offsetE = EOpvAOp_base.offsetE;
+        EOpvAOp_base_shape = EOpvAOp_base.shape;  // sparse shape
+
+        // Touched partition (offsetE already added: global EC's are
+        // stacked on top of local EC's)
+        for (size_t k=0; k<EOpvAOp_base.touched_iA.size(); ++k) {
+            int const iA_d = dimAOp.add_dense(EOpvAOp_base.touched_iA[k]);
+            for (size_t j=EOpvAOp_base.touched_ptr[k]; j<EOpvAOp_base.touched_ptr[k+1]; ++j) {
+                EOpvAOp_tl.add({ret.dimEOp.add_dense(EOpvAOp_base.touched_iE[j]), iA_d},
+                    EOpvAOp_base.touched_val[j]);
+            }
+        }
 
-            // Stack global EC's on top of local EC's.
-            EOpvAOp_accum.add({ii->index(0)+ret.offsetE, ii->index(1)}, ii->value());
+        // Untouched partition, if it could not be used directly
+        if (untouched && !reuse_untouched) {
+            for (auto ii(begin(untouched->M)); ii != end(untouched->M); ++ii) {
+                EOpvAOp_tl.add({
+                    ret.dimEOp.add_dense(untouched->dimEOp.to_sparse(ii->index(0))),
+                    dimAOp.add_dense(untouched->dimAOp.to_sparse(ii->index(1)))},
+                    ii->value());
+            }
         }
+
         ret.hcdefs.insert(ret.hcdefs.end(), hcdefs_base.begin(), hcdefs_base.end());
         for (size_t i=0; i<hcdefs_base.size(); ++i)
             ret.underice_hc.push_back(UI_GLOBALICE);
@@ -455,7 +561,16 @@ std::vector<std::string> &errors)
     dimAOp.set_sparse_extent(EOpvAOp_base_shape[1]);
 
     // Convert to Eigen
-    ret.EOpvAOp.reset(new EigenSparseMatrixT(EOpvAOp_m.to_eigen()));
+    EOpvAOp_tl.set_shape(std::array<long,2>{});
+    ret.EOpvAOp.reset(new EigenSparseMatrixT(
+        ret.dimEOp.dense_extent(), dimAOp.dense_extent()));
+    ret.EOpvAOp->setFromTriplets(EOpvAOp_tl.begin(), EOpvAOp_tl.end());
+    if (reuse_untouched) {
+        // Untouched dense indices are a prefix of the merged ones
+        EigenSparseMatrixT M(untouched->M);
+        M.conservativeResize(ret.EOpvAOp->rows(), ret.EOpvAOp->cols());
+        *ret.EOpvAOp += M;
+    }
     ret.indexingHC = indexingHC_change_nhc(indexingHC_base, ret.hcdefs.size());
 
     if (squash_ecs) {
@@ -1,6 +1,7 @@
 #ifndef ICEBIN_MODELE_MERGE_TOPO_HPP
 #define ICEBIN_MODELE_MERGE_TOPO_HPP
 
+#include <memory>
 #include <ibmisc/blitz.hpp>
 #include <ibmisc/zarray.hpp>
 #include <ibmisc/indexing.hpp>
@@ -70,6 +71,44 @@ struct EOpvAOpResult {
 };
 
 
+/** Base EOpvAOp matrix (output of global_ec.cpp), decompressed once
+out of its ZArray so it may be merged repeatedly (on every
+update_topo()) without walking the compressed stream each time.
+Elements are partitioned by AOp cell: cells overlapped by the exchange
+grid of some (local) ice sheet in gcmO, vs. the untouched rest.  Only
+the touched partition needs to be re-merged with the local ice; the
+untouched bulk is kept already densified and shared between merges. */
+struct EOpvAOpBase {
+    std::array<long,2> shape {0,0};    // Sparse shape of the base matrix
+    long offsetE = 0;    // Offset added to base EC indices (gcmO->indexingE.extent())
+
+    /** Elements in untouched AOp cells.  Dense indexing, offsetE
+    already added to EOp. */
+    struct Untouched {
+        SparseSetT dimEOp, dimAOp;
+        EigenSparseMatrixT M;
+    };
+    std::shared_ptr<Untouched const> untouched;
+
+    /** Elements in touched AOp cells, CSR by AOp.  Sparse indexing,
+    offsetE already added to EOp. */
+    std::vector<long> touched_iA;     // AOp index of each row
+    std::vector<size_t> touched_ptr;  // Start of each row; touched_iA.size()+1 entries
+    std::vector<long> touched_iE;
+    std::vector<double> touched_val;
+
+    EOpvAOpBase() {}
+
+    /** @param EOpvAOp_base Compressed base matrix (sparse indexing)
+    @param gcmO Local ice sheets that will be merged in */
+    EOpvAOpBase(
+        ibmisc::ZArray<int,double,2> const &EOpvAOp_base,
+        GCMRegridder_Standard const *gcmO);
+
+    size_t nnz() const
+        { return touched_val.size() + (untouched ? untouched->M.nonZeros() : 0); }
+};
+
 /** Merge per-ice sheet data into a global base EOpvAOp matrix (from
 which ice sheet(s) have be removed; output of global_ec.cpp).  The
 matrix is all based on un-rounded ("raw") verions of TOPO fields.
@@ -106,6 +145,22 @@ ibmisc::Indexing const &indexingHC_base,
 bool squash_ecs,    // Should ECs be merged if they are the same elevation?
 std::vector<std::string> &errors);
 
+/** Same as above, but merges from an already-decompressed base matrix.
+EOpvAOp_base must have been constructed with the same gcmO. */
+EOpvAOpResult compute_EOpvAOp_merged(  // (generates in dense indexing)
+SparseSetT &dimAOp,    // dimAOp is appended
+EOpvAOpBase const &EOpvAOp_base,
+RegridParams paramsO,
+GCMRegridder_Standard const *gcmO,     // A bunch of local ice sheets
+double const eq_rad,    // Radius of the earth
+std::vector<blitz::Array<double,1>> const &emI_ices,
+bool use_global_ice,
+bool use_local_ice,
+std::vector<double> const &hcdefs_base, // [nhc]  Elev class definitions for base ice
+ibmisc::Indexing const &indexingHC_base,
+bool squash_ecs,    // Should ECs be merged if they are the same elevation?
+std::vector<std::string> &errors);
+
 
 /** Merges repeated ECs */
 EOpvAOpResult squash_ECs(
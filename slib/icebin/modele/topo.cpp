@@ -185,8 +185,7 @@ NOTES:
 */
 void raw_EOvEA(
 MakeDenseEigenT::AccumT &&ret,        // {dimEA, dimEO}; dimEO should not change here.
-HntrSpec const &hntrO,
-HntrSpec const &hntrA,
+Hntr const &hntr_AOvAA,    // dimB=O,  dimA=A; gcmA->hntr_AOvAA
 double const eq_rad,
 SparseSetT const *dimAO,            // Used to clip in Hntr::matrix()
 blitz::Array<double,1> &wEO_d,            // == EOvI.wM.  Dense indexing.
@@ -196,8 +195,6 @@ ibmisc::Indexing const indexingHCO,    // gcmA->gcmO->indexingHC
 ibmisc::Indexing const indexingHCA)    // gcmA->indexingHC
 {
     // Call Hntr to generate AOvAA; and use that (above) to produce EOvEA
-    Hntr hntr_AOvAA(17.17, hntrO, hntrA, 0);    // dimB=A,  dimA=O
-
     hntr_AOvAA.overlap<RawEOvEA, DimClip>(
         RawEOvEA(std::move(ret), wEO_d, nhc, indexingHCO, indexingHCA),
         eq_rad, DimClip(dimAO));
@@ -245,8 +242,7 @@ std::unique_ptr<linear::Weighted_Eigen> _compute_AAmvEAm_EIGEN(
     double const eq_rad,    // Radius of the earth
 
     // Things obtained from gcmA
-    HntrSpec const &hntrO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-    HntrSpec const &hntrA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+    Hntr const &hntr_AOvAA,        // gcmA->hntr_AOvAA
     ibmisc::Indexing const indexingHCO,    // gcmA->gcmO->indexingHC
     ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
     blitz::Array<double,1> const &foceanAOp,    // gcmA->foceanAOp
@@ -279,14 +275,9 @@ std::unique_ptr<linear::Weighted_Eigen> _compute_AAmvEAm_EIGEN(
     EigenColVectorT wAOm_e(compute_wAOm(foceanAOp, foceanAOm, wAOp, dimAOp, dimAOm));
 
     // ------------- Compute wAAm and AAmvAOm
-    // Obtain hntrA and hntrO for process below.
-    if (!hntrA.is_set()) (*icebin_error)(-1, "hntrA must be set");
-    if (!hntrO.is_set()) (*icebin_error)(-1, "hntrO must be set");
-
-    Hntr hntr_AOmvAAm(17.17, hntrO, hntrA);
     EigenSparseMatrixT AAmvAOm(MakeDenseEigenT(
         std::bind(&Hntr::overlap<MakeDenseEigenT::AccumT,DimClip>,
-            &hntr_AOmvAAm, _1, eq_rad, DimClip(&dimAOm)),
+            &hntr_AOvAA, _1, eq_rad, DimClip(&dimAOm)),
         {SparsifyTransform::TO_DENSE_IGNORE_MISSING, SparsifyTransform::ADD_DENSE},
         {&dimAOm, &dimAAm}, 'T').to_eigen());
 
@@ -308,7 +299,7 @@ std::unique_ptr<linear::Weighted_Eigen> _compute_AAmvEAm_EIGEN(
     // ------------ Compute EOmvEAm
     EigenSparseMatrixT EOmvEAm(MakeDenseEigenT(    // TODO: Call this EOvEA, since it's the same 'm' or 'p'
         std::bind(&raw_EOvEA, _1,
-            hntrO, hntrA,
+            std::cref(hntr_AOvAA),
             eq_rad, &dimAOm, wEOm,
             nhc, indexingHCO, indexingHCA),
         {SparsifyTransform::TO_DENSE_IGNORE_MISSING, SparsifyTransform::ADD_DENSE},
@@ -351,8 +342,7 @@ linear::Weighted_Tuple _compute_AAmvEAm(
     double const eq_rad,    // Radius of the earth
 
     // Things obtained from gcmA
-    HntrSpec const &hntrO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-    HntrSpec const &hntrA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+    Hntr const &hntr_AOvAA,        // gcmA->hntr_AOvAA
     ibmisc::Indexing const indexingHCO,    // gcmA->gcmO->indexingHC
     ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
     blitz::Array<double,1> const &foceanAOp,    // gcmA->foceanAOp
@@ -367,7 +357,7 @@ linear::Weighted_Tuple _compute_AAmvEAm(
     SparseSetT dimAAm, dimEAm;
     std::unique_ptr<linear::Weighted_Eigen> ret(_compute_AAmvEAm_EIGEN(
         {&dimAAm, &dimEAm},
-        scale, eq_rad, hntrO, hntrA,
+        scale, eq_rad, hntr_AOvAA,
         indexingHCO, indexingHCA, foceanAOp, foceanAOm,
         EOpvAOp, dimEOp, dimAOp, wAOp));
     return to_tuple(*ret);
@@ -593,8 +583,7 @@ blitz::Array<double,2> const &zland_maxOm2,
 blitz::Array<int16_t,2> const &mergemaskOm2,
 //
 // Things obtained from gcmA
-HntrSpec const &hspecO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-HntrSpec const &hspecA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+Hntr const &hntr_AvO,        // dimB=A, dimA=O; gcmA->hntr_AAvAO
 ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
 std::vector<double> const &hcdefs,        // gcmA->hcdefs()
 //int const nhc_icesheet,                         // gcmA->gcmO->hcdefs()Just EC's related to dynamic ice sheets
@@ -617,16 +606,16 @@ blitz::Array<double,3> &fhc3,
 blitz::Array<double,3> &elevE3,
 blitz::Array<int16_t,3> &underice3)
 {
-
-    Hntr hntr_AvO(17.17, hspecA, hspecO);
+    HntrSpec const &hspecO(hntr_AvO.Agrid.spec);
+    HntrSpec const &hspecA(hntr_AvO.Bgrid.spec);
 
     blitz::Array<double, 2> WTO(const_array(blitz::shape(hspecO.jm,hspecO.im), 1.0));
-    hntr_AvO.regrid(WTO, foceanOm2, foceanA2);
-    hntr_AvO.regrid(WTO, flakeOm2, flakeA2);
-    hntr_AvO.regrid(WTO, fgrndOm2, fgrndA2);
-    hntr_AvO.regrid(WTO, fgiceOm2, fgiceA2);
-    hntr_AvO.regrid(WTO, zatmoOm2, zatmoA2);
-    hntr_AvO.regrid(WTO, zlakeOm2, zlakeA2);
+    // All fields weighted by WTO are regridded in one pass
+    hntr_AvO.regrid(WTO,
+        std::vector<blitz::Array<double,2>>
+            {foceanOm2, flakeOm2, fgrndOm2, fgiceOm2, zatmoOm2, zlakeOm2},
+        std::vector<blitz::Array<double,2>>
+            {foceanA2, flakeA2, fgrndA2, fgiceA2, zatmoA2, zlakeA2});
     hntr_AvO.regrid(fgiceOm2, zicetopOm2, zicetopA2);
 
     // -------------------------
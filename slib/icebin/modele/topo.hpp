@@ -63,8 +63,7 @@ NOTES:
 */
 extern void raw_EOvEA(
 MakeDenseEigenT::AccumT &&ret,        // {dimEA, dimEO}; dimEO should not change here.
-HntrSpec const &hntrO,
-HntrSpec const &hntrA,
+Hntr const &hntr_AOvAA,    // dimB=O,  dimA=A; gcmA->hntr_AOvAA
 double const eq_rad,
 SparseSetT const *dimAO,            // Used to clip in Hntr::matrix()
 blitz::Array<double,1> &wEO_d,            // == EOvI.wM.  Dense indexing.
@@ -92,8 +91,7 @@ bool scale,        // paramsA.scale
 double const eq_rad,    // Radius of the earth
 
 // Things obtained from gcmA
-HntrSpec const &hntrO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-HntrSpec const &hntrA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+Hntr const &hntr_AOvAA,        // gcmA->hntr_AOvAA
 ibmisc::Indexing const indexingHCO,    // gcmA->gcmO->indexingHC
 ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
 blitz::Array<double,1> const &foceanAOp,    // gcmA->foceanAOp
@@ -111,8 +109,7 @@ bool scale,        // paramsA.scale
 double const eq_rad,    // Radius of the earth
 
 // Things obtained from gcmA
-HntrSpec const &hntrO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-HntrSpec const &hntrA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+Hntr const &hntr_AOvAA,        // gcmA->hntr_AOvAA
 ibmisc::Indexing const indexingHCO,    // gcmA->gcmO->indexingHC
 ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
 blitz::Array<double,1> const &foceanAOp,    // gcmA->foceanAOp
@@ -190,8 +187,7 @@ blitz::Array<int16_t,2> const &mergemaskOm2,
 
 //
 // Things obtained from gcmA
-HntrSpec const &hspecO,        // cast_GridSpec_LonLat(*gcmA->gcmO->agridA.spec).hntr
-HntrSpec const &hspecA,        // cast_GridSpec_LonLat(*gcmA->agridA.spec).hntr
+Hntr const &hntr_AvO,        // dimB=A, dimA=O; gcmA->hntr_AAvAO
 ibmisc::Indexing const indexingHCA,    // gcmA->indexingHC
 std::vector<double> const &hcdefs,        // gcmA->hcdefs()
 std::vector<int16_t> const &underice_hc,    // contructed from gcmA->underice()
@@ -5,11 +5,25 @@ namespace icebin {
 
 static double const nan = std::numeric_limits<double>::quiet_NaN();
 
+void VectorMultivec::reserve(size_t n)
+{
+    index.reserve(n);
+    weights.reserve(n);
+    vals.reserve(n * nvar);
+}
+
 void VectorMultivec::add(long ix, double const *val, double weight)
 {
     index.push_back(ix);
     weights.push_back(weight);
-    for (int i=0; i<nvar; ++i) vals.push_back(val[i]);
+    vals.insert(vals.end(), val, val + nvar);
+}
+
+void VectorMultivec::add(long ix, double const *val, long stride, double weight)
+{
+    index.push_back(ix);
+    weights.push_back(weight);
+    for (int i=0; i<nvar; ++i) vals.push_back(val[i*stride]);
 }
 
 VectorMultivec concatenate(std::vector<VectorMultivec> const &vecs)
@@ -80,4 +94,37 @@ void VectorMultivec::to_dense(
 
 }
 
+void VectorMultivec::to_dense_all(
+    blitz::Array<double,1> const &scaleE,
+    double fill,
+    blitz::Array<double,2> &denseE) const
+{
+    int nE(denseE.extent(1));
+    if (denseE.extent(0) != nvar) (*icebin_error)(-1,
+        "denseE has %d variables, expected %d", denseE.extent(0), nvar);
+
+    // Fill our dense vars
+    std::vector<char> touched(nE, 0);
+    for (unsigned int i=0; i<this->index.size(); ++i) {
+        auto iE(this->index[i]);
+        if (iE >= nE) (*icebin_error)(-1,
+            "Index out of range: %ld vs. %ld", (long)iE, (long)nE);
+        double const *val = &this->vals[i*nvar];
+        double const scale = scaleE(iE);
+        if (!touched[iE]) {
+            touched[iE] = 1;
+            for (int ivar=0; ivar<nvar; ++ivar) denseE(ivar, iE) = val[ivar] * scale;
+        } else {
+            for (int ivar=0; ivar<nvar; ++ivar) denseE(ivar, iE) += val[ivar] * scale;
+        }
+    }
+
+    // Set all untouched items to the fill value
+    for (int iE=0; iE<nE; ++iE) {
+        if (!touched[iE]) {
+            for (int ivar=0; ivar<nvar; ++ivar) denseE(ivar, iE) = fill;
+        }
+    }
+}
+
 }
@@ -46,12 +46,20 @@ public:
         ar & nvar;
     }
 
+    /** Pre-allocates space for n elements in total */
+    void reserve(size_t n);
+
     /** Adds a new element to all the sparse vectors */
     void add(long ix, double const *val, double weight);
 
     void add(long ix, std::vector<double> &val, double weight)
         { add(ix, &val[0], weight); }
 
+    /** Adds a new element, reading value for variable ivar from
+    val[ivar*stride].  Use to append directly from a row of a
+    column-major matrix. */
+    void add(long ix, double const *val, long stride, double weight);
+
     double val(int varix, long ix) const
         { return vals[ix*nvar + varix]; }
 
@@ -66,6 +74,15 @@ public:
         double fill,
         blitz::Array<double,1> &denseE) const;
 
+    /** Densifies all variables in a single pass over the index.
+    Equivalent to calling to_dense() for each ivar.
+    @param scaleE Multiply by this.
+    @param denseE Pre-allocated array to put it in: denseE(ivar, iE) */
+    void to_dense_all(
+        blitz::Array<double,1> const &scaleE,
+        double fill,
+        blitz::Array<double,2> &denseE) const;
+
 };
 
 VectorMultivec concatenate(std::vector<VectorMultivec> const &vecs);
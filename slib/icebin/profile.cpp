@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <sys/resource.h>
+#include <icebin/profile.hpp>
+
+namespace icebin {
+namespace profile {
+
+Profiler profiler;
+thread_local bool in_background = false;
+
+void Profiler::add(std::string const &phase, double seconds, bool concurrent)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    PhaseStats &st(stats[phase]);
+    ++st.count;
+    st.total_s += seconds;
+    st.max_s = std::max(st.max_s, seconds);
+    if (concurrent) st.concurrent_s += seconds;
+}
+
+std::map<std::string, PhaseStats> Profiler::snapshot()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void Profiler::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.clear();
+}
+
+long peak_rss_kb()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss;    // kB on Linux
+}
+
+}}    // namespace
@@ -0,0 +1,86 @@
+#ifndef ICEBIN_PROFILE_HPP
+#define ICEBIN_PROFILE_HPP
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+/** Wall-clock accounting for the phases of coupling (densify,
+regrid_matrices, etc), for benchmarking the coupler.  Off by default;
+a disabled Timer costs one branch. */
+
+namespace icebin {
+namespace profile {
+
+struct PhaseStats {
+    long count = 0;         // Number of times the phase ran
+    double total_s = 0;     // Total wall time [s]
+    double max_s = 0;       // Longest single run [s]
+    /** Part of total_s spent in a background thread (see Background),
+    overlapping other phases; so phase times may sum to more than
+    the wall time of coupling. */
+    double concurrent_s = 0;
+};
+
+class Profiler {
+    std::mutex mutex;
+    std::map<std::string, PhaseStats> stats;
+public:
+    /** Timers do nothing unless set; may be set while other
+    threads are timing */
+    std::atomic<bool> enabled{false};
+
+    /** @param concurrent True if timed in a background thread */
+    void add(std::string const &phase, double seconds, bool concurrent);
+
+    /** @return Copy of the stats accumulated so far */
+    std::map<std::string, PhaseStats> snapshot();
+
+    void reset();
+};
+
+/** The process-wide profiler */
+extern Profiler profiler;
+
+/** True in threads that run concurrently with the main coupling
+thread (eg: lagged regridding); see Background */
+extern thread_local bool in_background;
+
+/** Marks the current thread as a background thread while in scope;
+Timers started there record their time as concurrent. */
+class Background {
+    bool const in_background0;
+public:
+    Background() : in_background0(in_background)
+        { in_background = true; }
+    ~Background()
+        { in_background = in_background0; }
+};
+
+/** Adds the time from construction to destruction to a phase of the
+profiler.  Phases may nest, and may run in more than one thread. */
+class Timer {
+    char const *phase;
+    bool const active;
+    bool const concurrent;
+    std::chrono::steady_clock::time_point t0;
+public:
+    Timer(char const *_phase) : phase(_phase),
+        active(profiler.enabled.load(std::memory_order_relaxed)),
+        concurrent(in_background)
+        { if (active) t0 = std::chrono::steady_clock::now(); }
+    ~Timer()
+    {
+        if (active) profiler.add(phase,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(),
+            concurrent);
+    }
+};
+
+/** @return Peak resident set size of this process so far [kB] */
+extern long peak_rss_kb();
+
+}}    // namespace
+#endif    // guard
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include <cmath>
 #include <icebin/smoother.hpp>
 
 namespace icebin {
@@ -19,10 +23,11 @@ Smoother::Smoother(std::vector<Smoother::Tuple> &&_tuples,
 }
 // -----------------------------------------------------------
 /** Inner loop for Smoother::matrix() */
-bool Smoother::matrix_callback(Smoother::Tuple const *t)
+bool Smoother::matrix_callback(Scratch &scratch, Smoother::Tuple const *t) const
 {
     // t0 = point from outer loop
     // t = point from innter loop
+    Tuple const *t0(scratch.t0);
 
     // Compute a scaled distance metric, based on the radius in each direction
     double norm_distance_squared = 0;
@@ -34,21 +39,23 @@ bool Smoother::matrix_callback(Smoother::Tuple const *t)
     if (norm_distance_squared < nsigma_squared) {
         double const gaussian_ij = std::exp(-.5 * norm_distance_squared);
         double w = gaussian_ij * t->area;
-        M_raw.push_back(std::make_pair(t->iX_d, w));
-        denom_sum += w;
+        scratch.M_raw.push_back(std::make_pair(t->iX_d, w));
+        scratch.denom_sum += w;
     }
     return true;
 }
 
-void Smoother::matrix(TupleListT<2> &ret)
+void Smoother::matrix_range(TupleListT<2> &ret, size_t begin, size_t end)
 {
     using namespace std::placeholders;  // for _1, _2, _3...
 
-    RTree::Callback callback(std::bind(&Smoother::matrix_callback, this, _1));
-    for (auto _t0(tuples.begin()); _t0 != tuples.end(); ++_t0) {
-        t0 = &*_t0;
-        M_raw.clear();
-        denom_sum = 0;
+    Scratch scratch;
+    RTree::Callback callback(std::bind(&Smoother::matrix_callback, this, std::ref(scratch), _1));
+    for (size_t it=begin; it<end; ++it) {
+        Tuple const *t0 = &tuples[it];
+        scratch.t0 = t0;
+        scratch.M_raw.clear();
+        scratch.denom_sum = 0;
 
         // Pair t0 with nearby points
         std::array<double,3> min, max;
@@ -58,22 +65,217 @@ void Smoother::matrix(TupleListT<2> &ret)
         }
         rtree.Search(min, max, callback);
 
+        // Add to the final matrix
+        double factor = 1. / scratch.denom_sum;
+        for (auto ii=scratch.M_raw.begin(); ii != scratch.M_raw.end(); ++ii) {
+            ret.add({t0->iX_d, ii->first}, factor * ii->second);
+        }
+    }
+}
+
+// -----------------------------------------------------------
+/** Runs range_fn(shard, begin, end) over blocks of [0,nrows) in
+parallel, and appends the shards to ret in order.  The result is the
+same (bit for bit) as calling range_fn(ret, 0, nrows). */
+static void parallel_rows(TupleListT<2> &ret, size_t nrows, int nthreads,
+    std::function<void(TupleListT<2> &, size_t, size_t)> const &range_fn)
+{
+    // Don't bother with threads for small problems
+    size_t const min_per_thread = 1000;
+
+    if (nthreads <= 0) nthreads = std::max(1u, std::thread::hardware_concurrency());
+    nthreads = std::min((size_t)nthreads,
+        std::max((size_t)1, nrows / min_per_thread));
+
+    if (nthreads == 1) {
+        range_fn(ret, 0, nrows);
+        return;
+    }
+
+    // Each thread does a contiguous block of rows, into its own shard.
+    std::vector<TupleListT<2>> shards;
+    for (int i=0; i<nthreads; ++i) shards.push_back(
+        TupleListT<2>({ret.shape(0), ret.shape(1)}));
+    std::vector<std::exception_ptr> errors(nthreads);
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<nthreads; ++i) {
+        size_t const begin = (nrows * i) / nthreads;
+        size_t const end = (nrows * (i+1)) / nthreads;
+        threads.push_back(std::thread([&range_fn,&shards,&errors,i,begin,end]() {
+            try {
+                range_fn(shards[i], begin, end);
+            } catch(...) {
+                errors[i] = std::current_exception();
+            }
+        }));
+    }
+    for (auto &thread : threads) thread.join();
+    for (auto &error : errors) if (error) std::rethrow_exception(error);
+
+    // Merge, in order of rows
+    for (auto &shard : shards) {
+        for (auto ii=shard.begin(); ii != shard.end(); ++ii) {
+            ret.add({ii->index(0), ii->index(1)}, ii->value());
+        }
+    }
+}
+
+void Smoother::matrix(TupleListT<2> &ret, int nthreads)
+{
+    using namespace std::placeholders;  // for _1, _2, _3...
+
+    // The RTree is only read here, so it may be shared between threads.
+    parallel_rows(ret, tuples.size(), nthreads,
+        std::bind(&Smoother::matrix_range, this, _1, _2, _3));
+}
+// ===========================================================
+Smoother_UniformXY::Smoother_UniformXY(
+    std::vector<Tuple> &&_tuples,
+    std::vector<std::array<int,2>> &&_ijs,
+    std::array<int,2> const &nij,
+    std::array<double,2> const &dxy,
+    std::array<double,3> const &_sigma) :
+    sigma(_sigma),
+    nsigma(2.),
+    nsigma_squared(nsigma*nsigma),
+    tuples(std::move(_tuples)),
+    ijs(std::move(_ijs)),
+    tuple_ix(nij[0], nij[1])
+{
+    if (ijs.size() != tuples.size()) (*icebin_error)(-1,
+        "tuples and ijs must have same size: %ld vs %ld",
+        (long)tuples.size(), (long)ijs.size());
+
+    // Locate tuples on the grid
+    tuple_ix = -1;
+    for (size_t it=0; it<tuples.size(); ++it) {
+        tuple_ix(ijs[it][0], ijs[it][1]) = it;
+    }
+
+    // Precompute the horizontal part of the stencil.
+    // (Gaussian is separable; but it's cheap to store the product)
+    ri = (int)std::ceil(nsigma * sigma[0] / dxy[0]);
+    rj = (int)std::ceil(nsigma * sigma[1] / dxy[1]);
+    hdist_squared.reserve((2*ri+1) * (2*rj+1));
+    hgaussian.reserve((2*ri+1) * (2*rj+1));
+    for (int di=-ri; di<=ri; ++di) {
+        double const si = (di * dxy[0]) / sigma[0];
+        for (int dj=-rj; dj<=rj; ++dj) {
+            double const sj = (dj * dxy[1]) / sigma[1];
+            double const d2 = si*si + sj*sj;
+            hdist_squared.push_back(d2);
+            hgaussian.push_back(std::exp(-.5 * d2));
+        }
+    }
+}
+
+std::array<double,2> Smoother_UniformXY::uniform_spacing(AbbrGrid const &agridX)
+{
+    std::array<double,2> const no{0.,0.};
+
+    auto const *spec(dynamic_cast<GridSpec_XY const *>(&*agridX.spec));
+    if (!spec) return no;
+    if (agridX.ijk.extent(0) != agridX.dim.dense_extent()) return no;
+
+    std::array<double,2> dxy;
+    std::array<std::vector<double> const *,2> const bbs{&spec->xb, &spec->yb};
+    for (int k=0; k<2; ++k) {
+        auto &bb(*bbs[k]);
+        if (bb.size() < 2) return no;
+        dxy[k] = (bb.back() - bb.front()) / (bb.size() - 1);
+        for (size_t i=1; i<bb.size(); ++i) {
+            if (std::abs((bb[i] - bb[i-1]) - dxy[k]) > 1e-8 * dxy[k]) return no;
+        }
+    }
+    return dxy;
+}
+
+long Smoother_UniformXY::stencil_size(
+    std::array<double,2> const &dxy,
+    std::array<double,3> const &sigma,
+    double nsigma)
+{
+    double const ri = std::ceil(nsigma * sigma[0] / dxy[0]);
+    double const rj = std::ceil(nsigma * sigma[1] / dxy[1]);
+    double const n = (2*ri+1) * (2*rj+1);
+    return n > 1e12 ? -1 : (long)n;    // -1 = too big (or infinite)
+}
+
+void Smoother_UniformXY::matrix_range(TupleListT<2> &ret, size_t begin, size_t end) const
+{
+    int const ni = tuple_ix.extent(0);
+    int const nj = tuple_ix.extent(1);
+    std::vector<std::pair<int,double>> M_raw;
+
+    for (size_t it0=begin; it0<end; ++it0) {
+        Tuple const &t0(tuples[it0]);
+        auto const &ij0(ijs[it0]);
+        M_raw.clear();
+        double denom_sum = 0;
+
+        // Sweep the stencil around (i,j) of t0
+        int k = 0;
+        for (int di=-ri; di<=ri; ++di) {
+            int const i = ij0[0] + di;
+            if (i < 0 || i >= ni) {
+                k += 2*rj+1;
+                continue;
+            }
+            for (int dj=-rj; dj<=rj; ++dj, ++k) {
+                int const j = ij0[1] + dj;
+                if (j < 0 || j >= nj) continue;
+                int const it = tuple_ix(i,j);
+                if (it < 0) continue;
+
+                Tuple const &t(tuples[it]);
+                double const dz = (t.centroid[2] - t0.centroid[2]) / sigma[2];
+                double const dz_squared = dz*dz;
+                if (hdist_squared[k] + dz_squared < nsigma_squared) {
+                    double const gaussian_ij = (dz_squared == 0 ?
+                        hgaussian[k] : hgaussian[k] * std::exp(-.5 * dz_squared));
+                    double w = gaussian_ij * t.area;
+                    M_raw.push_back(std::make_pair(t.iX_d, w));
+                    denom_sum += w;
+                }
+            }
+        }
+
         // Add to the final matrix
         double factor = 1. / denom_sum;
         for (auto ii=M_raw.begin(); ii != M_raw.end(); ++ii) {
-            ret.add({t0->iX_d, ii->first}, factor * ii->second);
+            ret.add({t0.iX_d, ii->first}, factor * ii->second);
         }
     }
 }
+
+void Smoother_UniformXY::matrix(TupleListT<2> &ret, int nthreads) const
+{
+    using namespace std::placeholders;  // for _1, _2, _3...
+
+    parallel_rows(ret, tuples.size(), nthreads,
+        std::bind(&Smoother_UniformXY::matrix_range, this, _1, _2, _3));
+}
 // -----------------------------------------------------------
 void smoothing_matrix(TupleListT<2> &ret_d,
     AbbrGrid const &agridX,
     SparseSetT const &dimX,
     DenseArrayT<1> const &elev_s,
     DenseArrayT<1> const &area_d,
-    std::array<double,3> const &sigma)
+    std::array<double,3> const &sigma,
+    int nthreads)
 {
     std::vector<Smoother::Tuple> tuples;
+    std::vector<std::array<int,2>> ijs;
+
+    // Use the stencil if the grid is uniform, and the stencil is not
+    // so big that searching the RTree would be cheaper.
+    std::array<double,2> dxy(Smoother_UniformXY::uniform_spacing(agridX));
+    bool uniform = (dxy[0] > 0);
+    if (uniform) {
+        long const nstencil = Smoother_UniformXY::stencil_size(dxy, sigma);
+        uniform = (nstencil >= 0 && nstencil <= agridX.dim.dense_extent());
+    }
 
     for (int id=0; id<agridX.dim.dense_extent(); ++id) {
         auto iX_s(agridX.dim.to_sparse(id));
@@ -93,9 +295,18 @@ void smoothing_matrix(TupleListT<2> &ret_d,
             Smoother::Tuple(iX_d,
                 {agridX.centroid_xy(id,0), agridX.centroid_xy(id,1)},
                 elev, area));
+        if (uniform) ijs.push_back({agridX.ijk(id,0), agridX.ijk(id,1)});
+    }
+
+    if (uniform) {
+        auto const *spec(dynamic_cast<GridSpec_XY const *>(&*agridX.spec));
+        Smoother_UniformXY smoother(std::move(tuples), std::move(ijs),
+            {spec->nx(), spec->ny()}, dxy, sigma);
+        smoother.matrix(ret_d, nthreads);
+    } else {
+        Smoother smoother(std::move(tuples), sigma);
+        smoother.matrix(ret_d, nthreads);
     }
-    Smoother smoother(std::move(tuples), sigma);
-    smoother.matrix(ret_d);
 }
 
 }    // namespace
@@ -42,11 +42,13 @@ public:
     double const nsigma_squared;
 
 protected:
-    // ------ Variables used in loop; see Smoother::matrix()
-    Tuple *t0;
-    std::vector<std::pair<int,double>> M_raw;
-    double denom_sum;
-    // --------------------------
+    /** Variables used in loop; see Smoother::matrix().
+    Each thread gets its own. */
+    struct Scratch {
+        Tuple const *t0;
+        std::vector<std::pair<int,double>> M_raw;
+        double denom_sum;
+    };
 
     RTree rtree;
 
@@ -61,11 +63,72 @@ public:
 
 protected:
     /** Inner loop for Smoother::matrix() */
-    bool matrix_callback(Tuple const *t);
+    bool matrix_callback(Scratch &scratch, Tuple const *t) const;
+
+    /** Generates rows of the smoothing matrix for tuples[begin:end] */
+    void matrix_range(TupleListT<2> &ret, size_t begin, size_t end);
+
+public:
+    /** Generate the smoothing matrix.
+    @param nthreads Number of threads to use; 0 for one per core.
+        Each thread handles a contiguous block of tuples, and the
+        per-thread results are appended in order.  Therefore, the
+        result is the same (bit for bit) for any number of threads. */
+    void matrix(TupleListT<2> &ret, int nthreads = 0);
+};
+
+/** Smoother for grids with uniform spacing in x and y (eg
+    GridSpec_XY).  Produces the same matrix as Smoother (within
+    floating point tolerance), but finds neighbors using the (i,j)
+    structure of the grid instead of an RTree.  The horizontal
+    Gaussian weights only depend on (di,dj), so they are computed
+    once for the stencil. */
+class Smoother_UniformXY {
+public:
+    typedef Smoother::Tuple Tuple;
+
+    std::array<double,3> sigma;
+    double const nsigma;
+    double const nsigma_squared;
+
+protected:
+    std::vector<Tuple> tuples;
+    std::vector<std::array<int,2>> ijs;    // (i,j) of each tuple
+    blitz::Array<int,2> tuple_ix;    // (i,j) --> index into tuples; -1 if none
+
+    // Stencil, indexed by (di+ri)*(2*rj+1) + (dj+rj)
+    int ri, rj;    // Radius of the stencil in i and j directions
+    std::vector<double> hdist_squared;    // Scaled horizontal distance squared
+    std::vector<double> hgaussian;    // exp(-.5 * hdist_squared)
+
+public:
+    /** @param _ijs (i,j) index of each tuple on the grid
+    @param nij Number of grid cells in the (i,j) directions
+    @param dxy Size of each grid cell in the (i,j) directions */
+    Smoother_UniformXY(
+        std::vector<Tuple> &&_tuples,
+        std::vector<std::array<int,2>> &&_ijs,
+        std::array<int,2> const &nij,
+        std::array<double,2> const &dxy,
+        std::array<double,3> const &sigma);
+
+    /** Returns the (dx,dy) spacing if agridX is a GridSpec_XY with
+    uniform spacing and the (i,j) index of each cell; or {0,0} if not. */
+    static std::array<double,2> uniform_spacing(AbbrGrid const &agridX);
+
+    /** Size of the stencil required for a given sigma */
+    static long stencil_size(
+        std::array<double,2> const &dxy,
+        std::array<double,3> const &sigma,
+        double nsigma = 2.);
+
+protected:
+    /** Generates rows of the smoothing matrix for tuples[begin:end] */
+    void matrix_range(TupleListT<2> &ret, size_t begin, size_t end) const;
 
 public:
-    /** Generate the smoothing matrix. */
-    void matrix(TupleListT<2> &ret);
+    /** Generate the smoothing matrix.  See Smoother::matrix() */
+    void matrix(TupleListT<2> &ret, int nthreads = 0) const;
 };
 
 /** Produces a smoothing matrix that "smears" one grid cell into
@@ -99,13 +162,18 @@ public:
         size of an A grid cell and sigma[2] infinity.  If smoothing IvE,
         then sigma[2] should be about the elevation difference between
         different elevation classes.
+    @param nthreads
+        Number of threads to use; 0 for one per core.
+    If agridX is a GridSpec_XY grid with uniform spacing,
+    Smoother_UniformXY is used in place of Smoother.
 */
 extern void smoothing_matrix(TupleListT<2> &ret,
     AbbrGrid const &agridX,
     SparseSetT const &dimX,
     DenseArrayT<1> const &elev_s,
     DenseArrayT<1> const &area_d,
-    std::array<double,3> const &sigma);
+    std::array<double,3> const &sigma,
+    int nthreads = 0);
 
 }
 
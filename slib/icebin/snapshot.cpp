@@ -0,0 +1,171 @@
+#include <cstdio>
+#include <cerrno>
+#include <array>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <icebin/snapshot.hpp>
+
+namespace icebin {
+
+static char const snapshot_magic[8] = {'I','C','E','B','S','N','A','P'};
+
+/** Size and modification time of a file; {-1,-1} if it does not exist */
+static std::array<int64_t,2> file_fingerprint(std::string const &fname)
+{
+    struct stat st;
+    if (stat(fname.c_str(), &st) != 0) return {{-1, -1}};
+    return {{(int64_t)st.st_size, (int64_t)st.st_mtime}};
+}
+
+SnapshotIO::SnapshotIO(std::string const &_fname, char _rw,
+    std::string const &source_fname)
+: rw(_rw), fname(_fname)
+{
+    memset(&header, 0, sizeof(header));
+
+    if (rw == 'w') {
+        memcpy(header.magic, snapshot_magic, 8);
+        header.version = SnapshotHeader::VERSION;
+        header.byte_order = SnapshotHeader::ENDIAN_CHECK;
+        auto fp(file_fingerprint(source_fname));
+        header.source_size = fp[0];
+        header.source_mtime = fp[1];
+
+        tmp_fname = fname + ".tmp" + std::to_string((long)getpid());
+        fout = fopen(tmp_fname.c_str(), "wb");
+        if (!fout) (*icebin_error)(-1,
+            "Cannot open snapshot %s for writing: %s", tmp_fname.c_str(), strerror(errno));
+
+        // Header page gets filled in by close()
+        std::vector<char> zeros(PAGE, 0);
+        fwrite(&zeros[0], 1, PAGE, fout);
+    } else {
+        _mem.reset(new MappedFile(fname, true));
+        if (_mem->size() < sizeof(SnapshotHeader)) (*icebin_error)(-1,
+            "Snapshot %s is truncated", fname.c_str());
+        memcpy(&header, _mem->data(), sizeof(header));
+
+        if (memcmp(header.magic, snapshot_magic, 8) != 0) (*icebin_error)(-1,
+            "%s is not an IceBin snapshot", fname.c_str());
+        if (header.version != SnapshotHeader::VERSION) (*icebin_error)(-1,
+            "Snapshot %s has version %d; only version %d is supported",
+            fname.c_str(), (int)header.version, (int)SnapshotHeader::VERSION);
+        if (header.byte_order != SnapshotHeader::ENDIAN_CHECK) (*icebin_error)(-1,
+            "Snapshot %s was written on a machine with different byte order", fname.c_str());
+        if (header.toc_offset + header.ntoc * sizeof(SnapshotEntry) > _mem->size())
+            (*icebin_error)(-1, "Snapshot %s is truncated", fname.c_str());
+
+        SnapshotEntry const *toc0 = (SnapshotEntry const *)(_mem->data() + header.toc_offset);
+        for (size_t i=0; i<header.ntoc; ++i) {
+            SnapshotEntry const &e(toc0[i]);
+            if (e.offset + e.nbytes > _mem->size()) (*icebin_error)(-1,
+                "Snapshot %s: array %s is truncated", fname.c_str(), e.name);
+            toc_map.insert(std::make_pair(std::string(e.name), e));
+        }
+    }
+}
+
+SnapshotIO::~SnapshotIO()
+{
+    // Don't leave a half-written file behind if close() was never called
+    if (fout) {
+        fclose(fout);
+        remove(tmp_fname.c_str());
+    }
+}
+
+bool SnapshotIO::is_current(std::string const &fname, std::string const &source_fname)
+{
+    FILE *fin = fopen(fname.c_str(), "rb");
+    if (!fin) return false;
+    SnapshotHeader h;
+    bool const ok = (fread(&h, sizeof(h), 1, fin) == 1);
+    fclose(fin);
+    if (!ok) return false;
+
+    auto fp(file_fingerprint(source_fname));
+    return memcmp(h.magic, snapshot_magic, 8) == 0
+        && h.version == SnapshotHeader::VERSION
+        && h.byte_order == SnapshotHeader::ENDIAN_CHECK
+        && h.source_size == fp[0] && h.source_mtime == fp[1];
+}
+
+SnapshotEntry const &SnapshotIO::entry(std::string const &name, char type, unsigned rank) const
+{
+    auto ii(toc_map.find(name));
+    if (ii == toc_map.end()) (*icebin_error)(-1,
+        "Snapshot %s has no array %s", fname.c_str(), name.c_str());
+    SnapshotEntry const &e(ii->second);
+    if (e.type != type || e.rank != rank) (*icebin_error)(-1,
+        "Snapshot %s: array %s has type %c rank %d; expected type %c rank %d",
+        fname.c_str(), name.c_str(), e.type, (int)e.rank, type, (int)rank);
+    return e;
+}
+
+void SnapshotIO::write_array(std::string const &name, char type,
+    std::vector<int64_t> const &extent, void const *data, size_t nbytes)
+{
+    if (name.size() >= sizeof(SnapshotEntry::name)) (*icebin_error)(-1,
+        "Snapshot array name too long: %s", name.c_str());
+    if (extent.size() > 4) (*icebin_error)(-1,
+        "Snapshot array %s has rank %d > 4", name.c_str(), (int)extent.size());
+
+    // Start each array on a page boundary
+    long pos = ftell(fout);
+    long const offset = ((pos + PAGE - 1) / PAGE) * PAGE;
+    for (; pos < offset; ++pos) fputc(0, fout);
+
+    SnapshotEntry e;
+    memset(&e, 0, sizeof(e));
+    strncpy(e.name, name.c_str(), sizeof(e.name)-1);
+    e.type = type;
+    e.rank = extent.size();
+    for (size_t k=0; k<extent.size(); ++k) e.extent[k] = extent[k];
+    e.offset = offset;
+    e.nbytes = nbytes;
+    toc.push_back(e);
+
+    if (nbytes > 0 && fwrite(data, 1, nbytes, fout) != nbytes) (*icebin_error)(-1,
+        "Error writing snapshot %s: %s", tmp_fname.c_str(), strerror(errno));
+}
+
+void SnapshotIO::close()
+{
+    if (!fout) return;
+
+    header.ntoc = toc.size();
+    header.toc_offset = ftell(fout);
+    if (toc.size() > 0)
+        fwrite(&toc[0], sizeof(SnapshotEntry), toc.size(), fout);
+
+    fseek(fout, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, fout);
+    int const err = fclose(fout);
+    fout = nullptr;
+    if (err != 0) (*icebin_error)(-1,
+        "Error writing snapshot %s: %s", tmp_fname.c_str(), strerror(errno));
+
+    if (rename(tmp_fname.c_str(), fname.c_str()) != 0) (*icebin_error)(-1,
+        "Cannot rename %s to %s: %s", tmp_fname.c_str(), fname.c_str(), strerror(errno));
+}
+
+void SnapshotIO::sparse_set(spsparse::SparseSet<long,int> &dim, std::string const &name)
+{
+    std::vector<long> sparse_extent {(long)dim.sparse_extent()};
+    std::vector<long> to_sparse;
+    if (rw == 'w') {
+        to_sparse.reserve(dim.dense_extent());
+        for (int i=0; i<dim.dense_extent(); ++i) to_sparse.push_back(dim.to_sparse(i));
+    }
+
+    vector(sparse_extent, name + ".sparse_extent");
+    vector(to_sparse, name + ".to_sparse");
+
+    if (rw == 'r') {
+        spsparse::SparseSet<long,int> dim1(sparse_extent[0]);
+        for (long is : to_sparse) dim1.add_dense(is);
+        dim = std::move(dim1);
+    }
+}
+
+}    // namespace icebin
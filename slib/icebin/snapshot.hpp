@@ -0,0 +1,139 @@
+#ifndef ICEBIN_SNAPSHOT_HPP
+#define ICEBIN_SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <blitz/array.h>
+#include <spsparse/SparseSet.hpp>
+#include <icebin/error.hpp>
+#include <icebin/mapped_file.hpp>
+
+/** Binary snapshot of the bulk arrays of a GCMRegridder, so they can
+be mmap'd at start-up instead of decoded from NetCDF.  Small metadata
+(specs, indexing, names) stays in the NetCDF grid file.
+
+Format (native byte order, checked on read):
+    Header, padded to one page
+    Arrays, each starting on a page boundary, C order
+    Table of contents (one SnapshotEntry per array)
+
+Like NcIO, one SnapshotIO is used for reading ('r') and writing
+('w'), so each class lists its arrays once, in its snapshot() method.
+On read, blitz::Arrays point into the mapping (copy-on-write);
+std::vectors and SparseSets are bulk-copied out of it. */
+
+namespace icebin {
+
+struct SnapshotHeader {
+    static uint32_t const VERSION = 1;
+    static uint32_t const ENDIAN_CHECK = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t ntoc;           // Number of entries in table of contents
+    uint64_t toc_offset;
+    // Fingerprint of the NetCDF file this was made from
+    int64_t source_size;
+    int64_t source_mtime;
+};
+
+struct SnapshotEntry {
+    char name[128];
+    char type;               // 'i' (int32), 'l' (int64), 'd' (double)
+    char pad[3];
+    uint32_t rank;
+    int64_t extent[4];
+    uint64_t offset;
+    uint64_t nbytes;
+};
+
+template<class T> char snapshot_type();
+template<> inline char snapshot_type<int>() { return 'i'; }
+template<> inline char snapshot_type<long>() { return 'l'; }
+template<> inline char snapshot_type<double>() { return 'd'; }
+
+
+class SnapshotIO {
+public:
+    static size_t const PAGE = 4096;
+
+    char const rw;
+private:
+    std::string fname;
+
+    // ------- rw == 'w'
+    std::string tmp_fname;
+    FILE *fout = nullptr;
+    std::vector<SnapshotEntry> toc;
+    SnapshotHeader header;
+
+    // ------- rw == 'r'
+    std::shared_ptr<MappedFile> _mem;
+    std::map<std::string, SnapshotEntry> toc_map;
+
+    SnapshotEntry const &entry(std::string const &name, char type, unsigned rank) const;
+    void write_array(std::string const &name, char type,
+        std::vector<int64_t> const &extent, void const *data, size_t nbytes);
+public:
+    /** @param source_fname NetCDF file the snapshot is made from ('w' only) */
+    SnapshotIO(std::string const &_fname, char _rw,
+        std::string const &source_fname = "");
+    ~SnapshotIO();
+
+    /** Finishes writing (atomically); no-op on read. */
+    void close();
+
+    /** True if fname is a readable snapshot of (the current version of) source_fname */
+    static bool is_current(std::string const &fname, std::string const &source_fname);
+
+    /** The mapping that arrays read from this snapshot point into;
+    must be kept alive as long as they are in use. */
+    std::shared_ptr<MappedFile> const &mem() const { return _mem; }
+
+    template<class T, int RANK>
+    void blitz(blitz::Array<T,RANK> &arr, std::string const &name);
+
+    template<class T>
+    void vector(std::vector<T> &vec, std::string const &name);
+
+    void sparse_set(spsparse::SparseSet<long,int> &dim, std::string const &name);
+};
+
+template<class T, int RANK>
+void SnapshotIO::blitz(blitz::Array<T,RANK> &arr, std::string const &name)
+{
+    if (rw == 'w') {
+        blitz::Array<T,RANK> carr(arr.shape());    // Contiguous, C order
+        carr = arr;
+        std::vector<int64_t> extent;
+        for (int k=0; k<RANK; ++k) extent.push_back(arr.extent(k));
+        write_array(name, snapshot_type<T>(), extent, carr.data(), sizeof(T)*carr.size());
+    } else {
+        SnapshotEntry const &e(entry(name, snapshot_type<T>(), RANK));
+        blitz::TinyVector<int,RANK> shape;
+        for (int k=0; k<RANK; ++k) shape[k] = e.extent[k];
+        T *data = (T *)(_mem->data() + e.offset);
+        arr.reference(blitz::Array<T,RANK>(data, shape, blitz::neverDeleteData));
+    }
+}
+
+template<class T>
+void SnapshotIO::vector(std::vector<T> &vec, std::string const &name)
+{
+    if (rw == 'w') {
+        write_array(name, snapshot_type<T>(), {(int64_t)vec.size()},
+            vec.data(), sizeof(T)*vec.size());
+    } else {
+        SnapshotEntry const &e(entry(name, snapshot_type<T>(), 1));
+        T const *data = (T const *)(_mem->data() + e.offset);
+        vec.assign(data, data + e.extent[0]);
+    }
+}
+
+}    // namespace icebin
+#endif    // guard
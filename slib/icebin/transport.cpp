@@ -0,0 +1,203 @@
+#include <mpi.h>        // Intel MPI wants to be first
+#include <icebin/transport.hpp>
+#include <icebin/error.hpp>
+
+namespace icebin {
+namespace transport {
+
+int VTable::set_displs()
+{
+    displs.resize(counts.size());
+    int total = 0;
+    for (size_t i=0; i<counts.size(); ++i) {
+        displs[i] = total;
+        total += counts[i];
+    }
+    return total;
+}
+
+// ------------------------------------------------------------
+void gather(
+    boost::mpi::communicator const &comm,
+    VectorMultivec const &in,
+    VectorMultivec &out,
+    int root)
+{
+    bool const am_root = (comm.rank() == root);
+    int const nvar = in.nvar;
+
+    // Number of elements on each rank
+    VTable vt;
+    int n = in.size();
+    if (am_root) vt.counts.resize(comm.size());
+    MPI_Gather(&n, 1, MPI_INT,
+        am_root ? &vt.counts[0] : nullptr, 1, MPI_INT, root, comm);
+
+    int ntotal = 0;
+    if (am_root) {
+        ntotal = vt.set_displs();
+        out.nvar = nvar;
+        out.index.resize(ntotal);
+        out.weights.resize(ntotal);
+        out.vals.resize((size_t)ntotal * nvar);
+    }
+
+    MPI_Gatherv(in.index.data(), n, MPI_LONG,
+        am_root ? out.index.data() : nullptr,
+        am_root ? &vt.counts[0] : nullptr,
+        am_root ? &vt.displs[0] : nullptr, MPI_LONG, root, comm);
+    MPI_Gatherv(in.weights.data(), n, MPI_DOUBLE,
+        am_root ? out.weights.data() : nullptr,
+        am_root ? &vt.counts[0] : nullptr,
+        am_root ? &vt.displs[0] : nullptr, MPI_DOUBLE, root, comm);
+
+    // vals has nvar entries per element
+    if (am_root) {
+        for (auto &c : vt.counts) c *= nvar;
+        vt.set_displs();
+    }
+    MPI_Gatherv(in.vals.data(), n*nvar, MPI_DOUBLE,
+        am_root ? out.vals.data() : nullptr,
+        am_root ? &vt.counts[0] : nullptr,
+        am_root ? &vt.displs[0] : nullptr, MPI_DOUBLE, root, comm);
+}
+
+// ------------------------------------------------------------
+/** Packs a GCMInput into typed buffers.
+@param head Number of elements in each gcm_ivalss_s, then E1vE0c,
+    then wE1; then the shapes of E1vE0c (2) and wE1 (1).
+    (Shape -1 means "not set"; see split_by_domain()) */
+static void pack(GCMInput const &in,
+    std::vector<int> &head,
+    std::vector<long> &lbuf,
+    std::vector<double> &dbuf)
+{
+    for (VectorMultivec const &vm : in.gcm_ivalss_s) {
+        head.push_back(vm.size());
+        lbuf.insert(lbuf.end(), vm.index.begin(), vm.index.end());
+        dbuf.insert(dbuf.end(), vm.weights.begin(), vm.weights.end());
+        dbuf.insert(dbuf.end(), vm.vals.begin(), vm.vals.end());
+    }
+
+    head.push_back(in.E1vE0c.size());
+    for (auto ii(in.E1vE0c.begin()); ii != in.E1vE0c.end(); ++ii) {
+        lbuf.push_back(ii->index(0));
+        lbuf.push_back(ii->index(1));
+        dbuf.push_back(ii->value());
+    }
+
+    head.push_back(in.wE1.size());
+    for (auto ii(in.wE1.begin()); ii != in.wE1.end(); ++ii) {
+        lbuf.push_back(ii->index(0));
+        dbuf.push_back(ii->value());
+    }
+
+    head.push_back(in.E1vE0c.shape()[0]);
+    head.push_back(in.E1vE0c.shape()[1]);
+    head.push_back(in.wE1.shape()[0]);
+}
+
+/** Size of the buffers pack() produces, given its header */
+static void packed_size(int const *head, std::vector<int> const &nvar,
+    int &nlong, int &ndouble)
+{
+    size_t const nseg = nvar.size();
+    nlong = 0;
+    ndouble = 0;
+    for (size_t k=0; k<nseg; ++k) {
+        nlong += head[k];
+        ndouble += head[k] * (1 + nvar[k]);
+    }
+    nlong += 2*head[nseg] + head[nseg+1];
+    ndouble += head[nseg] + head[nseg+1];
+}
+
+static void unpack(int const *head,
+    long const *lbuf, double const *dbuf,
+    GCMInput &out)
+{
+    size_t const nseg = out.gcm_ivalss_s.size();
+    for (size_t k=0; k<nseg; ++k) {
+        VectorMultivec &vm(out.gcm_ivalss_s[k]);
+        size_t const n = head[k];
+        vm.index.assign(lbuf, lbuf+n);  lbuf += n;
+        vm.weights.assign(dbuf, dbuf+n);  dbuf += n;
+        vm.vals.assign(dbuf, dbuf+n*vm.nvar);  dbuf += n*vm.nvar;
+    }
+
+    out.E1vE0c.clear();
+    out.E1vE0c.set_shape(std::array<long,2>{head[nseg+2], head[nseg+3]});
+    out.E1vE0c.tuples.reserve(head[nseg]);
+    for (int i=0; i<head[nseg]; ++i) {
+        out.E1vE0c.add({(int)lbuf[0], (int)lbuf[1]}, *dbuf);
+        lbuf += 2;
+        dbuf += 1;
+    }
+
+    out.wE1.clear();
+    out.wE1.set_shape(std::array<long,1>{head[nseg+4]});
+    out.wE1.tuples.reserve(head[nseg+1]);
+    for (int i=0; i<head[nseg+1]; ++i) {
+        out.wE1.add({(int)lbuf[0]}, *dbuf);
+        lbuf += 1;
+        dbuf += 1;
+    }
+}
+
+void scatter(
+    boost::mpi::communicator const &comm,
+    std::vector<GCMInput> const &every_outs,
+    GCMInput &out,
+    int root)
+{
+    bool const am_root = (comm.rank() == root);
+    std::vector<int> const nvar(out.nvar());
+    int const nhead = nvar.size() + 5;    // See pack()
+
+    // Pack everything on root, one rank after the next
+    std::vector<int> heads;
+    std::vector<long> lbuf;
+    std::vector<double> dbuf;
+    VTable lvt, dvt;
+    if (am_root) {
+        if ((int)every_outs.size() != comm.size()) (*icebin_error)(-1,
+            "every_outs has %ld entries, expected %d", (long)every_outs.size(), comm.size());
+        lvt.counts.reserve(comm.size());
+        dvt.counts.reserve(comm.size());
+        for (GCMInput const &o : every_outs) {
+            if (o.nvar() != nvar) (*icebin_error)(-1,
+                "GCMInput to scatter has inconsistent nvar");
+            size_t const nl0 = lbuf.size();
+            size_t const nd0 = dbuf.size();
+            pack(o, heads, lbuf, dbuf);
+            lvt.counts.push_back(lbuf.size() - nl0);
+            dvt.counts.push_back(dbuf.size() - nd0);
+        }
+        lvt.set_displs();
+        dvt.set_displs();
+    }
+
+    // Everyone learns their own sizes
+    std::vector<int> head(nhead);
+    MPI_Scatter(am_root ? heads.data() : nullptr, nhead, MPI_INT,
+        head.data(), nhead, MPI_INT, root, comm);
+    int nlong, ndouble;
+    packed_size(&head[0], nvar, nlong, ndouble);
+
+    std::vector<long> my_lbuf(nlong);
+    std::vector<double> my_dbuf(ndouble);
+    MPI_Scatterv(
+        am_root ? lbuf.data() : nullptr,
+        am_root ? &lvt.counts[0] : nullptr,
+        am_root ? &lvt.displs[0] : nullptr, MPI_LONG,
+        my_lbuf.data(), nlong, MPI_LONG, root, comm);
+    MPI_Scatterv(
+        am_root ? dbuf.data() : nullptr,
+        am_root ? &dvt.counts[0] : nullptr,
+        am_root ? &dvt.displs[0] : nullptr, MPI_DOUBLE,
+        my_dbuf.data(), ndouble, MPI_DOUBLE, root, comm);
+
+    unpack(&head[0], my_lbuf.data(), my_dbuf.data(), out);
+}
+
+}}    // namespace
@@ -0,0 +1,45 @@
+#ifndef ICEBIN_TRANSPORT_HPP
+#define ICEBIN_TRANSPORT_HPP
+
+#include <vector>
+#include <boost/mpi.hpp>
+#include <icebin/multivec.hpp>
+#include <icebin/GCMCoupler.hpp>
+
+/** Moves coupler data between MPI ranks as contiguous typed buffers
+(MPI_Gatherv / MPI_Scatterv), instead of through boost::serialization.
+Results are the same as the corresponding boost::mpi collectives. */
+
+namespace icebin {
+namespace transport {
+
+/** Count / displacement tables for a v-collective, one entry per rank. */
+struct VTable {
+    std::vector<int> counts;
+    std::vector<int> displs;
+
+    /** Sets displs from counts
+    @return Total count */
+    int set_displs();
+};
+
+/** Gathers a VectorMultivec from every rank onto root, concatenated
+in rank order.  Same as boost::mpi::gather() followed by concatenate().
+@param out Result (only set on root) */
+extern void gather(
+    boost::mpi::communicator const &comm,
+    VectorMultivec const &in,
+    VectorMultivec &out,
+    int root);
+
+/** Scatters one GCMInput to each rank.  Same as boost::mpi::scatter().
+@param every_outs GCMInput for each rank (only used on root)
+@param out Result; must be constructed with the correct nvar() */
+extern void scatter(
+    boost::mpi::communicator const &comm,
+    std::vector<GCMInput> const &every_outs,
+    GCMInput &out,
+    int root);
+
+}}    // namespace
+#endif    // guard
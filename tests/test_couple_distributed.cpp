@@ -0,0 +1,308 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+// Run on 1 rank (sheets regridded on gcm_root) and on 2 ranks (sheets
+// regridded on rank 1, outputs sent back through merge_by_domain()).
+
+#include <mpi.h>        // Must be first
+#include <cmath>
+#include <map>
+#include <gtest/gtest.h>
+#include <boost/mpi/collectives.hpp>
+#include <ibmisc/VarTransformer.hpp>
+#include <icebin/GCMCoupler.hpp>
+#include <icebin/contracts/contracts.hpp>
+#include <icebin/gridgen/GridGen_XY.hpp>
+#include <icebin/gridgen/GridGen_Exchange.hpp>
+
+using namespace ibmisc;
+using namespace icebin;
+
+static double const nan = std::numeric_limits<double>::quiet_NaN();
+static auto const &UNIT(VarTransformer::UNIT);
+static double const dt = 86400.;
+static int const ny = 20;    // Ice grids are (nx x 20)
+
+// Two ice sheets; both overlap the GCM cells at 20 < x < 30
+static std::vector<std::array<double,2>> const sheet_xb {{0,24}, {24,40}};
+
+static std::string sheet_name(size_t sheetix)
+    { return "sheet" + std::to_string(sheetix); }
+
+// -------------------------------------------------------------
+class StubGCMCoupler : public GCMCoupler {
+public:
+    StubGCMCoupler() : GCMCoupler(GCMCoupler::Type::MODELE, GCMParams(MPI_COMM_WORLD, 0))
+    {
+        gcm_params.icebin_logging = false;
+        timespan = {0., 0.};
+    }
+
+protected:
+    int _read_nhc_gcm()
+        { return gcm_regridder->nhc(); }
+
+public:
+    std::string locate_input_file(
+        std::string const &sheet_name,
+        std::string const &file_name)
+        { return file_name; }
+};
+
+/** Ice model whose output depends only on time_s.  Sheet 0 retreats
+and thickens each step; sheet 1 never changes after initialization,
+so its part of E1vE0c is skipped. */
+class StubIceCoupler : public IceCoupler {
+public:
+    bool moving;
+
+    StubIceCoupler(bool _moving) :
+        IceCoupler(IceCoupler::Type::DISMAL, IceCoupler::Params()),
+        moving(_moving)
+        { regrids_dump = RegridsDump::NEVER; }
+
+    void icemodel_rsf(std::string const &fname, char rw) {}
+
+    void _model_start(
+        bool cold_start,
+        ibmisc::Datetime const &time_base,
+        double time_start_s) {}
+
+    void run_timestep(double time_s,
+        blitz::Array<double,2> const &ice_ivalsI,
+        blitz::Array<double,2> &ice_ovalsI,
+        bool run_ice)
+    {
+        // Like DISMAL: run on gcm_root only, outputs are sent to the sheet root
+        if (!gcm_coupler->am_i_root()) return;
+
+        long const step = (moving ? std::lround(time_s / dt) : 0);
+        int const nx = nI() / ny;
+        for (int ix=0; ix<nx; ++ix) {
+        for (int iy=0; iy<ny; ++iy) {
+            long const iI = ix*ny + iy;
+            double const elev = 100. + 60.*ix + 25.*iy + 7.*step;
+            ice_ovalsI(0, iI) = (ix < 4 - step ? nan : elev);    // elevmask_ice
+            ice_ovalsI(1, iI) = elev;                            // elevmask_land
+            ice_ovalsI(2, iI) = 1e-3 * (iI % 7) + std::lround(time_s / dt);    // smb
+        }}
+    }
+};
+
+// -------------------------------------------------------------
+/** A GCMInput, merged over ice sheets and MPI ranks, in a form that
+does not depend on the order things were concatenated. */
+struct CoupleResult {
+    /** Per index: {sum(w), sum(w*val_0), sum(w*val_1), ...} */
+    std::array<std::map<long, std::vector<double>>, (int)IndexAE::COUNT> ivalss;
+    std::map<std::array<int,2>, double> E1vE0c;
+    std::array<long,2> E1vE0c_shape;
+    size_t wE1_size;
+
+    CoupleResult(GCMInput const &in)
+    {
+        for (int iAE=0; iAE < (int)IndexAE::COUNT; ++iAE) {
+            VectorMultivec const &vv(in.gcm_ivalss_s[iAE]);
+            for (size_t i=0; i<vv.size(); ++i) {
+                std::vector<double> &sums(ivalss[iAE][vv.index[i]]);
+                sums.resize(vv.nvar + 1, 0.);
+                sums[0] += vv.weights[i];
+                for (int ivar=0; ivar<vv.nvar; ++ivar)
+                    sums[ivar+1] += vv.weights[i] * vv.val(ivar, i);
+            }
+        }
+        for (auto &tp : in.E1vE0c.tuples)
+            E1vE0c[std::array<int,2>{tp.index(0), tp.index(1)}] += tp.value();
+        E1vE0c_shape = in.E1vE0c.shape();
+        wE1_size = in.wE1.tuples.size();
+    }
+};
+
+static void expect_near(double a, double b, std::string const &what)
+    { EXPECT_NEAR(a, b, 1e-10 * std::max(1., std::abs(a))) << what; }
+
+// The fixture for testing GCMCoupler::distribute_sheets
+class CoupleDistributedTest : public ::testing::Test {
+protected:
+    std::unique_ptr<Grid> gridA;
+    std::vector<std::unique_ptr<Grid>> gridIs, exgrids;
+    std::shared_ptr<GCMRegridder_Standard> gcmr;
+
+    virtual void SetUp()
+    {
+        // 4x4 GCM grid, overlaid by two ice grids
+        gridA.reset(new Grid(make_grid("gridA",
+            GridSpec_XY::make_with_boundaries("", {0,1}, 0,40,10, 0,40,10))));
+
+        std::vector<double> hcdefs {0., 500., 1000., 1500., 2000.};
+        long const nhc = hcdefs.size();
+        gcmr.reset(new GCMRegridder_Standard);
+        gcmr->init(
+            AbbrGrid(*gridA),
+            std::move(hcdefs),
+            Indexing({"A", "HC"}, {0,0}, {(long)gridA->ndata(), nhc}, {1,0}),
+            true);
+
+        for (size_t sheetix=0; sheetix < sheet_xb.size(); ++sheetix) {
+            gridIs.push_back(std::unique_ptr<Grid>(new Grid(make_grid(
+                "grid" + sheet_name(sheetix),
+                GridSpec_XY::make_with_boundaries("", {0,1},
+                    sheet_xb[sheetix][0], sheet_xb[sheetix][1], 2, 0,40,2)))));
+            exgrids.push_back(std::unique_ptr<Grid>(new Grid(
+                make_exchange_grid(&*gridA, &*gridIs.back()))));
+
+            auto sheet(new_ice_regridder(gridIs.back()->parameterization));
+            sheet->init(sheet_name(sheetix), *gcmr->agridA, &*gridA,
+                AbbrGrid(*gridIs.back()), ExchangeGrid(*exgrids.back()),
+                InterpStyle::Z_INTERP);
+            gcmr->add_sheet(std::move(sheet));
+        }
+    }
+
+    /** Couples nstep times (after initialization).
+    @return On gcm_root: the full GCMInput of each step. */
+    std::vector<CoupleResult> run(bool distribute_sheets, int nstep)
+    {
+        StubGCMCoupler gcm;
+        gcm.gcm_regridder = gcmr;
+        gcm.distribute_sheets = distribute_sheets;
+
+        gcm.gcm_outputsE.add("massxfer", 0., "kg m-2 s-1", "", 0);
+        gcm.gcm_inputs.resize((int)IndexAE::COUNT);
+        gcm.gcm_inputs_grid = {'A', 'E', 'A', 'E'};
+        gcm.gcm_inputs[(int)IndexAE::A].add("smb", 0., "kg m-2 s-1", "", 0);
+        gcm.gcm_inputs[(int)IndexAE::E].add("elev", 0., "m", "", 0);
+        gcm.scalars.add("by_dt", nan, "s-1", "", 0);
+
+        for (size_t sheetix=0; sheetix < sheet_xb.size(); ++sheetix) {
+            std::unique_ptr<StubIceCoupler> ice(new StubIceCoupler(sheetix == 0));
+            ice->_name = sheet_name(sheetix);
+            ice->gcm_coupler = &gcm;
+            ice->ice_regridder = &*gcmr->ice_regridders().at(ice->_name);
+            ice->sigma = {0., 0., 0.};
+
+            ice->contract[IceCoupler::INPUT].add("massxfer", 0., "kg m-2 s-1", "", 0);
+            VarSet &ice_output(ice->contract[IceCoupler::OUTPUT]);
+            ice->standard_names[IceCoupler::OUTPUT]["elevmask_ice"] =
+                ice_output.add("elevmask_ice", nan, "m", "", contracts::INITIAL | contracts::ALLOW_NAN);
+            ice->standard_names[IceCoupler::OUTPUT]["elevmask_land"] =
+                ice_output.add("elevmask_land", nan, "m", "", contracts::INITIAL | contracts::ALLOW_NAN);
+            ice_output.add("smb", nan, "kg m-2 s-1", "", 0);
+
+            bool ok = true;
+            ice->var_trans_inE.set_dims(
+                ice->contract[IceCoupler::INPUT].keys(),
+                gcm.gcm_outputsE.keys(),
+                gcm.scalars.keys());
+            ok = ok && ice->var_trans_inE.set("massxfer", "massxfer", UNIT, 1.0);
+            for (int iAE=0; iAE<GridAE::count; ++iAE) ice->var_trans_outAE[iAE].set_dims(
+                gcm.gcm_inputs[iAE].keys(),
+                ice_output.keys(),
+                gcm.scalars.keys());
+            ok = ok && ice->var_trans_outAE[GridAE::A].set("smb", "smb", UNIT, 1.0);
+            ok = ok && ice->var_trans_outAE[GridAE::E].set("elev", "elevmask_land", UNIT, 1.0);
+            EXPECT_TRUE(ok);
+
+            ice->ice_ovalsI.reference(blitz::Array<double,2>(ice_output.size(), ice->nI()));
+            ice->ice_ovalsI = 0;
+            ice->emI_ice.reference(blitz::Array<double,1>(ice->nI()));
+            ice->emI_land.reference(blitz::Array<double,1>(ice->nI()));
+
+            gcm.ice_couplers.push_back(std::move(ice));
+        }
+        gcm.init_sheet_roots();    // Collective
+
+        std::vector<CoupleResult> ret;
+        VectorMultivec const gcm_ovalsE_s(gcm.gcm_outputsE.size());
+        for (int step=0; step <= nstep; ++step) {
+            GCMInput out(gcm.couple(step * dt, gcm_ovalsE_s, step > 0));
+
+            if (!distribute_sheets) {
+                if (gcm.am_i_root()) ret.push_back(CoupleResult(out));
+                continue;
+            }
+
+            // Every rank's output belongs to the one MPI domain, on gcm_root
+            std::vector<GCMInput> ins;
+            boost::mpi::gather(gcm.gcm_params.world, out, ins, gcm.gcm_params.gcm_root);
+            if (gcm.am_i_root()) ret.push_back(CoupleResult(merge_by_domain(ins)));
+        }
+        return ret;
+    }
+};
+
+TEST_F(CoupleDistributedTest, matches_root_only)
+{
+    int const nstep = 3;
+    auto root_only(run(false, nstep));
+    auto distributed(run(true, nstep));
+
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank != 0) return;
+
+    ASSERT_EQ(root_only.size(), distributed.size());
+    for (int step=0; step <= nstep; ++step) {
+        CoupleResult const &a(root_only[step]);
+        CoupleResult const &b(distributed[step]);
+        std::string const sstep("step " + std::to_string(step));
+
+        // ------- gcm_ivalss_s
+        for (int iAE=0; iAE < (int)IndexAE::COUNT; ++iAE) {
+            EXPECT_EQ(a.ivalss[iAE].size(), b.ivalss[iAE].size()) << sstep << " iAE=" << iAE;
+            for (auto &ii : a.ivalss[iAE]) {
+                auto jj(b.ivalss[iAE].find(ii.first));
+                ASSERT_TRUE(jj != b.ivalss[iAE].end())
+                    << sstep << " iAE=" << iAE << " index " << ii.first;
+                ASSERT_EQ(ii.second.size(), jj->second.size());
+                for (size_t k=0; k<ii.second.size(); ++k) expect_near(ii.second[k], jj->second[k],
+                    sstep + " iAE=" + std::to_string(iAE) + " index " + std::to_string(ii.first));
+            }
+        }
+
+        // ------- E1vE0c: same shape and (scaled) values; no weights left over
+        EXPECT_EQ(a.E1vE0c_shape, b.E1vE0c_shape) << sstep;
+        EXPECT_EQ(step > 0 ? gcmr->nE() : -1, b.E1vE0c_shape[0]) << sstep;
+        std::map<std::array<int,2>, double> all(a.E1vE0c);
+        for (auto &ii : b.E1vE0c) all[ii.first];
+        for (auto &ii : all) {
+            auto ja(a.E1vE0c.find(ii.first));
+            auto jb(b.E1vE0c.find(ii.first));
+            expect_near(ja == a.E1vE0c.end() ? 0. : ja->second,
+                jb == b.E1vE0c.end() ? 0. : jb->second,
+                sstep + " E1vE0c(" + std::to_string(ii.first[0]) + ","
+                    + std::to_string(ii.first[1]) + ")");
+        }
+        EXPECT_EQ(0, a.wE1_size) << sstep;
+        EXPECT_EQ(0, b.wE1_size) << sstep;
+    }
+
+    // ...and the test is not vacuous
+    EXPECT_NE(0, root_only[1].ivalss[(int)IndexAE::A].size());
+    EXPECT_NE(0, root_only[1].E1vE0c.size());
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int const ret = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,250 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <mpi.h>        // Must be first
+#include <cmath>
+#include <map>
+#include <gtest/gtest.h>
+#include <ibmisc/VarTransformer.hpp>
+#include <icebin/GCMCoupler.hpp>
+#include <icebin/contracts/contracts.hpp>
+#include <icebin/gridgen/GridGen_XY.hpp>
+#include <icebin/gridgen/GridGen_Exchange.hpp>
+
+using namespace ibmisc;
+using namespace icebin;
+
+static double const nan = std::numeric_limits<double>::quiet_NaN();
+static auto const &UNIT(VarTransformer::UNIT);
+static double const dt = 86400.;
+static int const nx = 20, ny = 20;    // Ice grid
+
+// -------------------------------------------------------------
+/** Minimal GCMCoupler: a single ice sheet, regridded on this rank */
+class StubGCMCoupler : public GCMCoupler {
+public:
+    StubGCMCoupler() : GCMCoupler(GCMCoupler::Type::MODELE, GCMParams(MPI_COMM_WORLD, 0)) {}
+
+protected:
+    int _read_nhc_gcm()
+        { return gcm_regridder->nhc(); }
+
+public:
+    std::string locate_input_file(
+        std::string const &sheet_name,
+        std::string const &file_name)
+        { return file_name; }
+};
+
+/** Ice model whose output depends only on time_s; so lagged and
+unlagged runs can be compared. */
+class StubIceCoupler : public IceCoupler {
+public:
+    StubIceCoupler() : IceCoupler(IceCoupler::Type::DISMAL, IceCoupler::Params())
+        { regrids_dump = RegridsDump::NEVER; }
+
+    void icemodel_rsf(std::string const &fname, char rw) {}
+
+    void _model_start(
+        bool cold_start,
+        ibmisc::Datetime const &time_base,
+        double time_start_s) {}
+
+    void run_timestep(double time_s,
+        blitz::Array<double,2> const &ice_ivalsI,
+        blitz::Array<double,2> &ice_ovalsI,
+        bool run_ice)
+    {
+        // Sloping ice sheet; the front (ix == step) advances each step
+        long const step = std::lround(time_s / dt);
+        for (int ix=0; ix<nx; ++ix) {
+        for (int iy=0; iy<ny; ++iy) {
+            long const iI = ix*ny + iy;
+            double const elev = 100. + 60.*ix + 25.*iy + 7.*step;
+            ice_ovalsI(0, iI) = (ix < 4 - step ? nan : elev);    // elevmask_ice
+            ice_ovalsI(1, iI) = elev;                            // elevmask_land
+            ice_ovalsI(2, iI) = 1e-3 * (iI % 7) + step;          // smb
+        }}
+    }
+};
+
+// -------------------------------------------------------------
+/** Outputs of one coupling timestep, in sparse indexing */
+struct CoupleResult {
+    std::array<std::map<long, std::vector<double>>, 2> ivalsAE;    // A, E
+    blitz::Array<double,1> emI_ice;
+};
+
+// The fixture for testing GCMCoupler::coupling_lag
+class CouplingLagTest : public ::testing::Test {
+protected:
+    std::unique_ptr<Grid> gridA, gridI, exgrid;
+    std::shared_ptr<GCMRegridder_Standard> gcmr;
+
+    virtual void SetUp()
+    {
+        // 4x4 GCM grid, overlaid by a 20x20 ice grid
+        gridA.reset(new Grid(make_grid("gridA",
+            GridSpec_XY::make_with_boundaries("", {0,1}, 0,40,10, 0,40,10))));
+        gridI.reset(new Grid(make_grid("gridI",
+            GridSpec_XY::make_with_boundaries("", {0,1}, 0,40,2, 0,40,2))));
+        exgrid.reset(new Grid(make_exchange_grid(&*gridA, &*gridI)));
+
+        std::vector<double> hcdefs {0., 500., 1000., 1500., 2000.};
+        long const nhc = hcdefs.size();
+        gcmr.reset(new GCMRegridder_Standard);
+        gcmr->init(
+            AbbrGrid(*gridA),
+            std::move(hcdefs),
+            Indexing({"A", "HC"}, {0,0}, {(long)gridA->ndata(), nhc}, {1,0}),
+            true);
+
+        auto sheet(new_ice_regridder(gridI->parameterization));
+        sheet->init("sheet", *gcmr->agridA, &*gridA,
+            AbbrGrid(*gridI), ExchangeGrid(*exgrid),
+            InterpStyle::Z_INTERP);
+        gcmr->add_sheet(std::move(sheet));
+    }
+
+    /** Couples nstep times (after initialization) with the given lag */
+    std::vector<CoupleResult> run(int coupling_lag, int nstep)
+    {
+        StubGCMCoupler gcm;
+        gcm.gcm_regridder = gcmr;
+        gcm.coupling_lag = coupling_lag;
+        gcm.sheet_roots = {gcm.gcm_params.gcm_root};
+        gcm.sheet_comms.push_back(boost::mpi::communicator(
+            MPI_COMM_NULL, boost::mpi::comm_attach));
+
+        gcm.gcm_outputsE.add("massxfer", 0., "kg m-2 s-1", "", 0);
+        gcm.gcm_inputs.resize(2);
+        gcm.gcm_inputs[(int)IndexAE::A].add("smb", 0., "kg m-2 s-1", "", 0);
+        gcm.gcm_inputs[(int)IndexAE::E].add("elev", 0., "m", "", 0);
+        gcm.scalars.add("by_dt", nan, "s-1", "", 0);
+
+        StubIceCoupler ice;
+        ice._name = "sheet";
+        ice.gcm_coupler = &gcm;
+        ice.ice_regridder = &*gcmr->ice_regridders().at("sheet");
+        ice.sigma = {0., 0., 0.};
+
+        ice.contract[IceCoupler::INPUT].add("massxfer", 0., "kg m-2 s-1", "", 0);
+        VarSet &ice_output(ice.contract[IceCoupler::OUTPUT]);
+        ice.standard_names[IceCoupler::OUTPUT]["elevmask_ice"] =
+            ice_output.add("elevmask_ice", nan, "m", "", contracts::INITIAL | contracts::ALLOW_NAN);
+        ice.standard_names[IceCoupler::OUTPUT]["elevmask_land"] =
+            ice_output.add("elevmask_land", nan, "m", "", contracts::INITIAL | contracts::ALLOW_NAN);
+        ice_output.add("smb", nan, "kg m-2 s-1", "", 0);
+
+        bool ok = true;
+        ice.var_trans_inE.set_dims(
+            ice.contract[IceCoupler::INPUT].keys(),
+            gcm.gcm_outputsE.keys(),
+            gcm.scalars.keys());
+        ok = ok && ice.var_trans_inE.set("massxfer", "massxfer", UNIT, 1.0);
+        for (int iAE=0; iAE<2; ++iAE) ice.var_trans_outAE[iAE].set_dims(
+            gcm.gcm_inputs[iAE].keys(),
+            ice_output.keys(),
+            gcm.scalars.keys());
+        ok = ok && ice.var_trans_outAE[GridAE::A].set("smb", "smb", UNIT, 1.0);
+        ok = ok && ice.var_trans_outAE[GridAE::E].set("elev", "elevmask_land", UNIT, 1.0);
+        EXPECT_TRUE(ok);
+
+        ice.ice_ovalsI.reference(blitz::Array<double,2>(ice_output.size(), ice.nI()));
+        ice.emI_ice.reference(blitz::Array<double,1>(ice.nI()));
+        ice.emI_land.reference(blitz::Array<double,1>(ice.nI()));
+
+        std::vector<CoupleResult> ret;
+        VectorMultivec const gcm_ovalsE_s(gcm.gcm_outputsE.size());
+        for (int step=0; step <= nstep; ++step) {
+            std::vector<VectorMultivec> gcm_ivalss_s {
+                VectorMultivec(gcm.gcm_inputs[0].size()),
+                VectorMultivec(gcm.gcm_inputs[1].size())};
+            double const time_s = step * dt;
+            ice.couple({step == 0 ? time_s : time_s - dt, time_s},
+                gcm_ovalsE_s, gcm_ivalss_s, step > 0);
+
+            CoupleResult res;
+            for (int iAE=0; iAE<2; ++iAE) {
+                VectorMultivec const &vv(gcm_ivalss_s[iAE]);
+                for (size_t i=0; i<vv.size(); ++i) {
+                    std::vector<double> &vals(res.ivalsAE[iAE][vv.index[i]]);
+                    vals.push_back(vv.weights[i]);
+                    for (int ivar=0; ivar<vv.nvar; ++ivar) vals.push_back(vv.val(ivar, i));
+                }
+            }
+            res.emI_ice.reference(ice.emI_ice.copy());
+            ret.push_back(std::move(res));
+        }
+        return ret;
+    }
+
+    static void expect_near(CoupleResult const &a, CoupleResult const &b, int step)
+    {
+        for (int iAE=0; iAE<2; ++iAE) {
+            EXPECT_EQ(a.ivalsAE[iAE].size(), b.ivalsAE[iAE].size())
+                << "step " << step << " iAE=" << iAE;
+            for (auto &ii : a.ivalsAE[iAE]) {
+                auto jj(b.ivalsAE[iAE].find(ii.first));
+                ASSERT_TRUE(jj != b.ivalsAE[iAE].end())
+                    << "step " << step << " iAE=" << iAE << " index " << ii.first;
+                ASSERT_EQ(ii.second.size(), jj->second.size());
+                for (size_t k=0; k<ii.second.size(); ++k) {
+                    EXPECT_NEAR(ii.second[k], jj->second[k], 1e-10 * std::max(1., std::abs(ii.second[k])))
+                        << "step " << step << " iAE=" << iAE << " index " << ii.first;
+                }
+            }
+        }
+
+        ASSERT_EQ(a.emI_ice.extent(0), b.emI_ice.extent(0));
+        for (int i=0; i<a.emI_ice.extent(0); ++i) {
+            if (std::isnan(a.emI_ice(i))) EXPECT_TRUE(std::isnan(b.emI_ice(i)))
+                << "step " << step << " emI_ice(" << i << ")";
+            else EXPECT_EQ(a.emI_ice(i), b.emI_ice(i))
+                << "step " << step << " emI_ice(" << i << ")";
+        }
+    }
+};
+
+TEST_F(CouplingLagTest, lag1_is_lag0_shifted)
+{
+    int const nstep = 4;
+    auto lag0(run(0, nstep));
+    auto lag1(run(1, nstep));
+
+    // Initialization is never lagged
+    expect_near(lag0[0], lag1[0], 0);
+
+    // Afterwards, the GCM sees ice output one coupling timestep late
+    for (int step=1; step <= nstep; ++step) {
+        expect_near(lag0[step-1], lag1[step], step);
+    }
+
+    // ...and the ice sheet is changing, so the lag is visible
+    EXPECT_NE(lag0[1].ivalsAE[(int)IndexAE::A], lag0[2].ivalsAE[(int)IndexAE::A]);
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int const ret = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,134 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <cmath>
+#include <random>
+#include <limits>
+#include <gtest/gtest.h>
+#include <icebin/eigen_types.hpp>
+#include <icebin/fused_regrid.hpp>
+
+using namespace icebin;
+
+// The fixture for testing fused_regrid_transform()
+class FusedRegridTest : public ::testing::Test {
+protected:
+    // Big enough that fused_regrid_transform() uses several threads
+    long const nA = 30000;
+    long const nB = 45000;
+    int const nl = 3;    // Input variables
+    int const nk = 4;    // Output variables
+
+    // Values are O(1e4); the two methods add in different orders
+    double const tol = 1e-8;
+
+    Eigen::SparseMatrix<double, Eigen::RowMajor> BvA;
+    blitz::Array<double,2> valsA;    // valsA(l,j)
+    EigenSparseMatrixT M;            // M(l,k)
+    EigenDenseMatrixT b;             // b(0,k)
+
+    // Random regrid matrix, values and variable transformation
+    virtual void SetUp()
+    {
+        std::mt19937 gen(17);
+        std::uniform_real_distribution<double> uniform(0.,1.);
+
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (long i=0; i<nB; ++i) {
+            if (uniform(gen) < .1) continue;    // Empty row
+            int const n = 1 + (int)(6*uniform(gen));
+            for (int k=0; k<n; ++k) triplets.push_back(Eigen::Triplet<double>(
+                i, (long)(nA*uniform(gen)), uniform(gen)));
+        }
+        BvA.resize(nB, nA);
+        BvA.setFromTriplets(triplets.begin(), triplets.end());
+
+        valsA.reference(blitz::Array<double,2>(nl, nA));
+        for (int l=0; l<nl; ++l)
+        for (long j=0; j<nA; ++j) valsA(l,j) = 1000. * (uniform(gen) - .5);
+
+        // Sparse: some output variables don't depend on some inputs
+        std::vector<Eigen::Triplet<double>> mtriplets {
+            {0,0, 1.}, {1,1, 2.5}, {2,1, -.3}, {0,3, 1e-3}, {2,3, 7.}};
+        M.resize(nl, nk);
+        M.setFromTriplets(mtriplets.begin(), mtriplets.end());
+
+        b.resize(1, nk);
+        b << 0., 273.15, -1., 0.5;
+    }
+
+    /** @return valsB(k,i), computed with the Eigen expression
+    fused_regrid_transform() replaces */
+    blitz::Array<double,2> eigen_regrid() const
+    {
+        // Switch from row-major (Blitz++) to col-major (Eigen) indexing
+        Eigen::Map<EigenDenseMatrixT const> valsA_e(valsA.data(), nA, nl);
+        EigenDenseMatrixT const valsB_e(BvA * (valsA_e * M + b.replicate(nA,1)));
+
+        blitz::Array<double,2> valsB(nk, nB);
+        for (int k=0; k<nk; ++k)
+        for (long i=0; i<nB; ++i) valsB(k,i) = valsB_e(i,k);
+        return valsB;
+    }
+
+    blitz::Array<double,2> fused_regrid(int nthreads) const
+    {
+        blitz::Array<double,2> valsB(nk, nB);
+        valsB = std::numeric_limits<double>::quiet_NaN();
+        fused_regrid_transform(BvA, valsA, M, b, valsB, nthreads);
+        return valsB;
+    }
+};
+
+TEST_F(FusedRegridTest, matches_eigen)
+{
+    auto const expected(eigen_regrid());
+    auto const valsB(fused_regrid(1));
+
+    for (int k=0; k<nk; ++k)
+    for (long i=0; i<nB; ++i) {
+        EXPECT_NEAR(expected(k,i), valsB(k,i), tol)
+            << "valsB(" << k << "," << i << ")";
+    }
+}
+
+TEST_F(FusedRegridTest, threads)
+{
+    // Result must be the same (bit for bit) for any number of threads
+    auto const valsB1(fused_regrid(1));
+    for (int nthreads : {2, 4, 0}) {
+        auto const valsBn(fused_regrid(nthreads));
+        long ndiff = 0;
+        for (int k=0; k<nk; ++k)
+        for (long i=0; i<nB; ++i) if (valsB1(k,i) != valsBn(k,i)) ++ndiff;
+        EXPECT_EQ(0, ndiff) << "nthreads=" << nthreads;
+    }
+
+    // ...and also match the Eigen expression
+    auto const expected(eigen_regrid());
+    for (long i=0; i<nB; i += 97) {
+        EXPECT_NEAR(expected(1,i), valsB1(1,i), tol);
+    }
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -24,6 +24,8 @@
 #include <gtest/gtest.h>
 #include <icebin/Grid.hpp>
 #include <icebin/GridSpec.hpp>
+#include <icebin/AbbrGrid.hpp>
+#include <icebin/snapshot.hpp>
 #include <icebin/gridgen/GridGen_LonLat.hpp>
 #ifdef BUILD_MODELE
 #include <icebin/modele/clippers.hpp>
@@ -226,6 +228,148 @@ TEST_F(GridTest, create_grid)
 
 }
 
+TEST_F(GridTest, filter_cells)
+{
+    Grid grid;
+    grid.spec.reset(new GridSpec_XY("", {1,0}, {}, {}));
+    grid.name = "Test Grid";
+    grid.coordinates = GridCoordinates::XY;
+    grid.parameterization = GridParameterization::L0;
+
+    // A row of 3 cells; vertices and cells added out of order
+    auto &vertices(grid.vertices);
+    for (int i=3; i>=0; --i) {
+        vertices.add(Vertex(i,0, 2*i));
+        vertices.add(Vertex(i,1, 2*i+1));
+    }
+    auto &cells(grid.cells);
+    for (int i : {2, 0, 1}) {
+        Cell cell({vertices.at(2*i), vertices.at(2*i+2), vertices.at(2*i+3), vertices.at(2*i+1)});
+        cell.index = i;
+        cell.native_area = 10. + i;
+        cells.add(std::move(cell));
+    }
+    for (int i=0; i<3; ++i) EXPECT_EQ(10. + i, cells.at(i)->native_area);
+    EXPECT_EQ(3, cells.sorted().size());
+    EXPECT_EQ(1, cells.sorted()[1]->index);
+
+    size_t const cbytes0 = cells.memory_bytes();
+    grid.filter_cells([](long index) { return index != 1; });
+
+    // Counts don't change; but erased items are gone
+    EXPECT_EQ(3, cells.nfull());
+    EXPECT_EQ(8, vertices.nfull());
+    EXPECT_EQ(2, cells.nrealized());
+    EXPECT_EQ(8, vertices.nrealized());    // All still used
+    EXPECT_LT(cells.memory_bytes(), cbytes0);
+    ASSERT_EQ(2, cells.sorted().size());
+    EXPECT_EQ(2, cells.sorted()[1]->index);
+
+    // Cells point to the (moved) vertices
+    for (int i : {0, 2}) {
+        Cell const *cell(cells.at(i));
+        EXPECT_EQ(10. + i, cell->native_area);
+        ASSERT_EQ(4, cell->size());
+        EXPECT_EQ(vertices.at(2*i), &*cell->begin());
+        EXPECT_EQ(2*i+1, cell->begin(3)->index);
+        EXPECT_DOUBLE_EQ(1., cell->proj_area(NULL));
+    }
+    int n = 0;
+    for (auto &cell : cells) {
+        EXPECT_EQ(n == 0 ? 2 : 0, cell.index);    // In order added
+        ++n;
+    }
+    EXPECT_EQ(2, n);
+}
+
+TEST_F(GridTest, abbr_grid_snapshot)
+{
+    Grid grid;
+    grid.spec.reset(new GridSpec_XY("", {1,0}, {}, {}));
+    grid.name = "Test Grid";
+    grid.coordinates = GridCoordinates::XY;
+    grid.parameterization = GridParameterization::L0;
+
+    auto &vertices(grid.vertices);
+    vertices.add(Vertex(0,0));
+    vertices.add(Vertex(1,0));
+    vertices.add(Vertex(2,0));
+    vertices.add(Vertex(0,1));
+    vertices.add(Vertex(1,1));
+    vertices.add(Vertex(2,1));
+
+    auto &cells(grid.cells);
+    Cell *cell;
+    cell = cells.add(Cell({vertices.at(0), vertices.at(1), vertices.at(4), vertices.at(3)}));
+        cell->i = 0;
+        cell->j = 0;
+        cell->native_area = 2.;
+    cell = cells.add(Cell({vertices.at(1), vertices.at(2), vertices.at(5), vertices.at(4)}));
+        cell->i = 1;
+        cell->j = 0;
+        cell->native_area = 1./3.;
+
+    AbbrGrid agrid(grid);
+    ExchangeGrid exgrid;
+    exgrid.add({0,17}, 0.1);
+    exgrid.add({1,4}, 1./7.);
+
+    // ---------------- Write to NetCDF
+    std::string fname("__snapshot_test.nc");
+    std::string snap_fname("__snapshot_test.snap");
+    tmpfiles.push_back(fname);
+    tmpfiles.push_back(snap_fname);
+    ::remove(fname.c_str());
+    {
+        ibmisc::NcIO ncio(fname, NcFile::replace);
+        agrid.ncio(ncio, "agrid");
+        exgrid.ncio(ncio, "exgrid");
+        ncio.close();
+    }
+
+    // ---------------- Snapshot what we read from NetCDF
+    {
+        AbbrGrid agrid1;
+        ExchangeGrid exgrid1;
+        {ibmisc::NcIO ncio(fname, NcFile::read);
+            agrid1.ncio(ncio, "agrid");
+            exgrid1.ncio(ncio, "exgrid");
+        }
+
+        SnapshotIO snap(snap_fname, 'w', fname);
+        agrid1.snapshot(snap, "agrid");
+        exgrid1.snapshot(snap, "exgrid");
+        snap.close();
+    }
+    EXPECT_TRUE(SnapshotIO::is_current(snap_fname, fname));
+
+    // ---------------- Read back with the snapshot; must be exact
+    SnapshotIO snap(snap_fname, 'r');
+    AbbrGrid agrid2;
+    ExchangeGrid exgrid2;
+    {ibmisc::NcIO ncio(fname, NcFile::read);
+        agrid2.ncio(ncio, "agrid", &snap);
+        exgrid2.ncio(ncio, "exgrid", &snap);
+    }
+
+    EXPECT_EQ(agrid.name, agrid2.name);
+    EXPECT_EQ(agrid.dim.sparse_extent(), agrid2.dim.sparse_extent());
+    ASSERT_EQ(agrid.dim.dense_extent(), agrid2.dim.dense_extent());
+    for (int id=0; id<agrid.dim.dense_extent(); ++id) {
+        EXPECT_EQ(agrid.dim.to_sparse(id), agrid2.dim.to_sparse(id));
+        for (int k=0; k<3; ++k) EXPECT_EQ(agrid.ijk(id,k), agrid2.ijk(id,k));
+        EXPECT_EQ(agrid.native_area(id), agrid2.native_area(id));
+        for (int k=0; k<2; ++k) EXPECT_EQ(agrid.centroid_xy(id,k), agrid2.centroid_xy(id,k));
+    }
+
+    ASSERT_EQ(exgrid.dense_extent(), exgrid2.dense_extent());
+    for (int id=0; id<exgrid.dense_extent(); ++id) {
+        EXPECT_EQ(exgrid.ijk(id,0), exgrid2.ijk(id,0));
+        EXPECT_EQ(exgrid.ijk(id,1), exgrid2.ijk(id,1));
+        EXPECT_EQ(exgrid.native_area(id), exgrid2.native_area(id));
+    }
+}
+
 TEST_F(GridTest, centroid)
 {
     std::vector<Vertex> vertices;
@@ -0,0 +1,163 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <cmath>
+#include <random>
+#include <gtest/gtest.h>
+#include <icebin/gridgen/cgal.hpp>
+#include <icebin/gridgen/overlap_fp.hpp>
+
+using namespace icebin;
+using namespace icebin::overlap_fp;
+
+typedef overlap_fp::Result Result;
+
+static PolygonD rectangle(double x0, double y0, double x1, double y1)
+    { return {{x0,y0}, {x1,y0}, {x1,y1}, {x0,y1}}; }
+
+/** Regular n-gon (counter-clockwise) */
+static PolygonD ngon(int n, double cx, double cy, double r, double theta0)
+{
+    PolygonD ret;
+    for (int i=0; i<n; ++i) {
+        double const theta = theta0 + 2*M_PI*i/n;
+        ret.push_back({cx + r*std::cos(theta), cy + r*std::sin(theta)});
+    }
+    return ret;
+}
+
+/** Area of overlap, computed with the exact (CGAL) kernel */
+static double exact_area(PolygonD const &P, PolygonD const &Q)
+{
+    gc::Polygon_2 cP, cQ;
+    for (auto &p : P) cP.push_back(gc::Point_2(p[0], p[1]));
+    for (auto &q : Q) cQ.push_back(gc::Point_2(q[0], q[1]));
+    gc::Polygon_2 const ov(poly_overlap(cP, cQ));
+    return (ov.size() == 0 ? 0. : CGAL::to_double(ov.area()));
+}
+
+/** Checks the fast overlap against CGAL (if not FALLBACK)
+@return Result of overlap_fp::overlap() */
+static Result expect_matches_exact(PolygonD const &P, PolygonD const &Q)
+{
+    PolygonD out;
+    Result const res = overlap(P, Q, out);
+    if (res == Result::FALLBACK) return res;
+
+    double const exact = exact_area(P, Q);
+    double const fast = (res == Result::OK ? area(out) : 0.);
+    EXPECT_NEAR(exact, fast, 1e-12 * std::max(std::abs(area(P)), std::abs(area(Q))));
+    if (res == Result::OK) EXPECT_GT(fast, 0.);    // Counter-clockwise
+    return res;
+}
+
+// -----------------------------------------------------------
+TEST(OverlapFpTest, rect_vs_rect)
+{
+    PolygonD const R(rectangle(0,0, 10,5));
+
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, rectangle(5,2, 15,8)));    // Corner
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, rectangle(2,1, 3,2)));     // Inside
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, rectangle(-1,-1, 11,6)));  // Around
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, R));                       // Same
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, rectangle(0,0, 10,2.5)));  // Shared edges
+    EXPECT_EQ(Result::EMPTY, expect_matches_exact(R, rectangle(10,0, 20,5)));    // Touching
+    EXPECT_EQ(Result::EMPTY, expect_matches_exact(R, rectangle(20,20, 30,30)));  // Disjoint
+
+    // Same rectangle, starting at another corner
+    PolygonD const R2 {{10,5}, {0,5}, {0,0}, {10,0}};
+    EXPECT_EQ(Result::OK, expect_matches_exact(R2, rectangle(5,2, 15,8)));
+}
+
+TEST(OverlapFpTest, rect_vs_convex)
+{
+    PolygonD const R(rectangle(-1,-1, 1,1.5));
+
+    // Fixed cases, with the rectangle as either argument
+    PolygonD const tri {{-2,-0.5}, {2,-0.3}, {0.1,3}};
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, tri));
+    EXPECT_EQ(Result::OK, expect_matches_exact(tri, R));
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, ngon(6, 0.3, 0.2, 0.5, 0.1)));     // Inside
+    EXPECT_EQ(Result::OK, expect_matches_exact(R, ngon(8, 0.05, 0.1, 5., 0.2)));     // Around
+    EXPECT_EQ(Result::EMPTY, expect_matches_exact(R, ngon(5, 10., 10., 1., 0.3)));  // Disjoint
+
+    // Many random (convex) polygons, roughly the size of the rectangle
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<double> U(0., 1.);
+    int nok = 0, nempty = 0;
+    for (int i=0; i<2000; ++i) {
+        int const n = 3 + (i % 6);
+        PolygonD const poly(ngon(n,
+            -3. + 6.*U(gen), -3. + 6.*U(gen), 0.2 + 2.*U(gen), 2*M_PI*U(gen)));
+        switch(expect_matches_exact(R, poly)) {
+            case Result::OK : ++nok; break;
+            case Result::EMPTY : ++nempty; break;
+            default : break;
+        }
+    }
+    // The fast path should handle (nearly) all of them
+    EXPECT_GT(nok, 500);
+    EXPECT_GT(nempty, 100);
+    EXPECT_GT(nok + nempty, 1990);
+}
+
+TEST(OverlapFpTest, degenerate_fallback)
+{
+    PolygonD const R(rectangle(0,0, 2,2));
+    PolygonD out;
+
+    // Neither polygon is a rectangle
+    EXPECT_EQ(Result::FALLBACK, overlap(
+        ngon(5, 1, 1, 1, 0.1), ngon(6, 1.5, 1, 1, 0.2), out));
+
+    // Subject vertex exactly on a rectangle edge
+    PolygonD const on_edge {{1,0}, {3,1}, {1,3}, {-0.5,1}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, on_edge, out));
+    EXPECT_NEAR(exact_area(R, on_edge), exact_area(on_edge, R), 1e-12);
+
+    // Rectangle corner on a subject edge
+    PolygonD const through_corner {{-1,1}, {1,-1}, {3,1}, {1,3}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, through_corner, out));
+
+    // ...and just within the tolerance of it
+    PolygonD const near_corner {{-1,1+1e-12}, {1+1e-12,-1}, {3,1}, {1,3}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, near_corner, out));
+
+    // Not convex
+    PolygonD const notch {{-1,-1}, {3,-1}, {1,1}, {3,3}, {-1,3}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, notch, out));
+
+    // Clockwise
+    PolygonD const cw {{0.5,0.5}, {0.5,3}, {3,0.7}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, cw, out));
+
+    // Repeated vertex
+    PolygonD const rep {{0.5,0.5}, {3,0.7}, {3,0.7}, {0.5,3}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, rep, out));
+
+    // Not enough vertices
+    PolygonD const line {{0.5,0.5}, {3,0.7}};
+    EXPECT_EQ(Result::FALLBACK, overlap(R, line, out));
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <cmath>
+#include <map>
+#include <gtest/gtest.h>
+#include <icebin/RegridCache.hpp>
+#include <icebin/gridgen/GridGen_XY.hpp>
+#include <icebin/gridgen/GridGen_Exchange.hpp>
+
+using namespace ibmisc;
+using namespace icebin;
+
+static double const nan = std::numeric_limits<double>::quiet_NaN();
+
+// The fixture for testing RegridCache
+class RegridCacheTest : public ::testing::Test {
+protected:
+    std::unique_ptr<Grid> gridA, gridI, exgrid;
+    GCMRegridder_Standard gcm;
+    blitz::Array<double,1> emI0, emI1;    // elevmaskI before and after
+
+    virtual void SetUp()
+    {
+        // 4x4 GCM grid, overlaid by a 20x20 ice grid
+        gridA.reset(new Grid(make_grid("gridA",
+            GridSpec_XY::make_with_boundaries("", {0,1}, 0,40,10, 0,40,10))));
+        gridI.reset(new Grid(make_grid("gridI",
+            GridSpec_XY::make_with_boundaries("", {0,1}, 0,40,2, 0,40,2))));
+        exgrid.reset(new Grid(make_exchange_grid(&*gridA, &*gridI)));
+
+        std::vector<double> hcdefs {0., 500., 1000., 1500., 2000.};
+        long const nhc = hcdefs.size();
+        gcm.init(
+            AbbrGrid(*gridA),
+            std::move(hcdefs),
+            Indexing({"A", "HC"}, {0,0}, {(long)gridA->ndata(), nhc}, {1,0}),
+            true);
+
+        auto sheet(new_ice_regridder(gridI->parameterization));
+        sheet->init("sheet", *gcm.agridA, &*gridA,
+            AbbrGrid(*gridI), ExchangeGrid(*exgrid),
+            InterpStyle::Z_INTERP);
+        gcm.add_sheet(std::move(sheet));
+
+        // Sloping ice sheet; no ice in the first column (ix == 0)
+        // index = ix*ny + iy
+        int const nx = 20, ny = 20;
+        emI0.reference(blitz::Array<double,1>(nx*ny));
+        for (int ix=0; ix<nx; ++ix) {
+        for (int iy=0; iy<ny; ++iy) {
+            emI0(ix*ny + iy) = (ix == 0 ? nan : 100. + 60.*ix + 25.*iy);
+        }}
+
+        // A few scattered changes
+        emI1.reference(blitz::Array<double,1>(emI0.copy()));
+        emI1(45) += 10.;      // Change elevation
+        emI1(46) -= 300.;
+        emI1(210) = 1950.;    // Move to a different elevation class
+        emI1(300) = nan;      // Ice retreats
+        emI1(5) = 150.;       // Ice advances
+    }
+
+    typedef std::map<std::array<long,2>, double> SparseMap;
+
+    /** Converts a matrix to sparse indexing, for comparison between
+    caches with different dense indexing. */
+    static SparseMap to_map(EigenSparseMatrixT const &M,
+        std::array<SparseSetT *,2> const &dims)
+    {
+        SparseMap ret;
+        for (int k=0; k<M.outerSize(); ++k) {
+        for (EigenSparseMatrixT::InnerIterator ii(M, k); ii; ++ii) {
+            if (ii.value() == 0) continue;
+            ret[{dims[0]->to_sparse(ii.row()), dims[1]->to_sparse(ii.col())}] += ii.value();
+        }}
+        return ret;
+    }
+
+    static SparseMap to_map(blitz::Array<double,1> const &w, SparseSetT const *dim)
+    {
+        SparseMap ret;
+        for (int i=0; i<w.extent(0); ++i) {
+            if (w(i) == 0) continue;
+            ret[{dim->to_sparse(i), 0}] = w(i);
+        }
+        return ret;
+    }
+
+    /** Expects two sparse maps to agree within round-off.
+    Missing entries count as zero. */
+    static void expect_near(SparseMap const &a, SparseMap const &b, std::string const &name)
+    {
+        for (auto &ii : a) {
+            auto jj(b.find(ii.first));
+            double const bval = (jj == b.end() ? 0. : jj->second);
+            EXPECT_NEAR(ii.second, bval, 1e-10 * std::max(1., std::abs(ii.second)))
+                << name << "(" << ii.first[0] << ", " << ii.first[1] << ")";
+        }
+        for (auto &jj : b) {
+            if (a.find(jj.first) != a.end()) continue;
+            EXPECT_NEAR(0., jj.second, 1e-10 * std::max(1., std::abs(jj.second)))
+                << name << "(" << jj.first[0] << ", " << jj.first[1] << ")";
+        }
+    }
+
+    static void expect_near(
+        linear::Weighted_Eigen const &a, linear::Weighted_Eigen const &b,
+        std::string const &name)
+    {
+        expect_near(to_map(*a.M, a.dims), to_map(*b.M, b.dims), name + ".M");
+        expect_near(to_map(a.wM, a.dims[0]), to_map(b.wM, b.dims[0]), name + ".wM");
+        expect_near(to_map(a.Mw, a.dims[1]), to_map(b.Mw, b.dims[1]), name + ".Mw");
+    }
+
+    /** Expects the patched cache to agree with one recomputed from scratch */
+    void expect_near(RegridCache &patched, RegridCache &full)
+    {
+        expect_near(*patched.EuI_nc, *full.EuI_nc, "EuI_nc");
+        expect_near(*patched.AuI, *full.AuI, "AuI");
+        expect_near(*patched.XuE, *full.XuE, "XuE");
+        expect_near(
+            to_map(*patched.IvE, {&patched.dimI, &*patched.dimE}),
+            to_map(*full.IvE, {&full.dimI, &*full.dimE}), "IvE");
+    }
+
+    void check_patch(std::array<double,3> const &sigma)
+    {
+        std::unique_ptr<RegridCache> rc;
+        EXPECT_EQ(RegridCache::Update::RECOMPUTED,
+            RegridCache::update(rc, &gcm, 0, emI0, sigma, 1.));
+        EXPECT_EQ(RegridCache::Update::REUSED,
+            RegridCache::update(rc, &gcm, 0, emI0, sigma, 1.));
+        EXPECT_EQ(RegridCache::Update::PATCHED,
+            RegridCache::update(rc, &gcm, 0, emI1, sigma, 1.));
+
+        std::unique_ptr<RegridCache> full;
+        RegridCache::update(full, &gcm, 0, emI1, sigma, 1.);
+        expect_near(*rc, *full);
+
+        // Patch back again
+        EXPECT_EQ(RegridCache::Update::PATCHED,
+            RegridCache::update(rc, &gcm, 0, emI0, sigma, 1.));
+        full.reset();
+        RegridCache::update(full, &gcm, 0, emI0, sigma, 1.);
+        expect_near(*rc, *full);
+    }
+};
+
+TEST_F(RegridCacheTest, patch)
+{
+    check_patch({0., 0., 0.});
+}
+
+TEST_F(RegridCacheTest, patch_smoothed)
+{
+    check_patch({3., 3., 400.});
+}
+
+TEST_F(RegridCacheTest, recompute)
+{
+    std::unique_ptr<RegridCache> rc;
+    RegridCache::update(rc, &gcm, 0, emI0, {0.,0.,0.}, 0.);
+    EXPECT_EQ(RegridCache::Update::RECOMPUTED,
+        RegridCache::update(rc, &gcm, 0, emI1, {0.,0.,0.}, 0.));
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
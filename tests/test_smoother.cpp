@@ -0,0 +1,152 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <map>
+#include <random>
+#include <limits>
+#include <gtest/gtest.h>
+#include <icebin/smoother.hpp>
+
+using namespace icebin;
+
+// The fixture for testing the smoothers
+class SmootherTest : public ::testing::Test {
+protected:
+    int const nx = 80;
+    int const ny = 60;
+    double const dx = 5000.;
+    double const dy = 5000.;
+
+    std::vector<Smoother::Tuple> tuples;
+    std::vector<std::array<int,2>> ijs;
+
+    // Random grid cells, elevations and areas on a uniform grid
+    virtual void SetUp()
+    {
+        std::mt19937 gen(17);
+        std::uniform_real_distribution<double> uniform(0.,1.);
+
+        int iX_d = 0;
+        for (int i=0; i<nx; ++i) {
+        for (int j=0; j<ny; ++j) {
+            if (uniform(gen) < .2) continue;    // Masked out
+            tuples.push_back(Smoother::Tuple(iX_d++,
+                {(i+.5)*dx, (j+.5)*dy},
+                2000. * uniform(gen), dx*dy * (.5 + uniform(gen))));
+            ijs.push_back({i,j});
+        }}
+    }
+
+    typedef std::map<std::array<long,2>, double> MatrixMap;
+    static MatrixMap to_map(TupleListT<2> const &M)
+    {
+        MatrixMap ret;
+        for (auto ii=M.begin(); ii != M.end(); ++ii)
+            ret[{(long)ii->index(0), (long)ii->index(1)}] += ii->value();
+        return ret;
+    }
+
+    /** Checks two matrices are the same, bit for bit and in the same order */
+    static void expect_identical(TupleListT<2> const &M1, TupleListT<2> const &M4)
+    {
+        EXPECT_EQ(M1.size(), M4.size());
+        if (M1.size() != M4.size()) return;
+        for (auto ii1=M1.begin(), ii4=M4.begin(); ii1 != M1.end(); ++ii1, ++ii4) {
+            EXPECT_EQ(ii1->index(0), ii4->index(0));
+            EXPECT_EQ(ii1->index(1), ii4->index(1));
+            EXPECT_EQ(ii1->value(), ii4->value());
+        }
+    }
+
+    void expect_same(std::array<double,3> const &sigma)
+    {
+        long const n = tuples.size();
+
+        TupleListT<2> M0({n,n});
+        Smoother(std::vector<Smoother::Tuple>(tuples), sigma).matrix(M0);
+
+        TupleListT<2> M1({n,n});
+        Smoother_UniformXY(
+            std::vector<Smoother::Tuple>(tuples),
+            std::vector<std::array<int,2>>(ijs),
+            {nx, ny}, {dx, dy}, sigma).matrix(M1);
+
+        auto map0(to_map(M0));
+        auto map1(to_map(M1));
+        EXPECT_EQ(map0.size(), map1.size());
+        for (auto ii0=map0.begin(); ii0 != map0.end(); ++ii0) {
+            auto ii1(map1.find(ii0->first));
+            EXPECT_TRUE(ii1 != map1.end());
+            if (ii1 == map1.end()) continue;
+            EXPECT_NEAR(ii0->second, ii1->second, 1e-12);
+        }
+    }
+};
+
+TEST_F(SmootherTest, uniform_xy_horizontal)
+{
+    // Smoothing IvA: no smoothing in elevation
+    expect_same({1.3*dx, 1.7*dy, std::numeric_limits<double>::infinity()});
+}
+
+TEST_F(SmootherTest, uniform_xy_elevation)
+{
+    // Smoothing IvE
+    expect_same({2.3*dx, 2.3*dy, 300.});
+}
+
+TEST_F(SmootherTest, threads)
+{
+    // Result must be the same (bit for bit) for any number of threads
+    std::array<double,3> const sigma{2.3*dx, 2.3*dy, 300.};
+    long const n = tuples.size();
+
+    TupleListT<2> M1({n,n});
+    Smoother(std::vector<Smoother::Tuple>(tuples), sigma).matrix(M1, 1);
+    TupleListT<2> M4({n,n});
+    Smoother(std::vector<Smoother::Tuple>(tuples), sigma).matrix(M4, 4);
+
+    expect_identical(M1, M4);
+}
+
+TEST_F(SmootherTest, uniform_xy_threads)
+{
+    // Smoother_UniformXY partitions rows on its own; same requirement
+    std::array<double,3> const sigma{2.3*dx, 2.3*dy, 300.};
+    long const n = tuples.size();
+
+    TupleListT<2> M1({n,n});
+    Smoother_UniformXY(
+        std::vector<Smoother::Tuple>(tuples),
+        std::vector<std::array<int,2>>(ijs),
+        {nx, ny}, {dx, dy}, sigma).matrix(M1, 1);
+    TupleListT<2> M4({n,n});
+    Smoother_UniformXY(
+        std::vector<Smoother::Tuple>(tuples),
+        std::vector<std::array<int,2>>(ijs),
+        {nx, ny}, {dx, dy}, sigma).matrix(M4, 4);
+
+    expect_identical(M1, M4);
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
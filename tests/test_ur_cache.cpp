@@ -0,0 +1,112 @@
+/*
+ * IceBin: A Coupling Library for Ice Models and GCMs
+ * Copyright (c) 2013-2016 by Elizabeth Fischer
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// https://github.com/google/googletest/blob/master/googletest/docs/Primer.md
+
+#include <gtest/gtest.h>
+#include <icebin/RegridMatrices_Dynamic.hpp>
+
+using namespace icebin;
+
+// The fixture for testing UrCache
+class UrCacheTest : public ::testing::Test {
+protected:
+    UrCache cache;
+    SparseSetT dimA, dimB;
+    int ncomputed = 0;
+
+    virtual void SetUp()
+    {
+        dimA.set_sparse_extent(100);
+        dimB.set_sparse_extent(100);
+        for (long i : {3, 17, 42}) dimA.add_dense(i);
+        for (long i : {5, 8}) dimB.add_dense(i);
+    }
+
+    /** Looks up the test matrix, counting how often it is computed */
+    EigenSparseMatrixT const &lookup(std::string const &key = "BvA")
+    {
+        return cache.matrix(key, {&dimB, &dimA}, [&]() {
+            ++ncomputed;
+            EigenSparseMatrixT M(dimB.dense_extent(), dimA.dense_extent());
+            M.insert(0,0) = (double)ncomputed;
+            M.makeCompressed();
+            return M;
+        });
+    }
+};
+
+TEST_F(UrCacheTest, hit)
+{
+    EigenSparseMatrixT const *M0 = &lookup();
+    EigenSparseMatrixT const *M1 = &lookup();
+    EXPECT_EQ(1, ncomputed);
+    EXPECT_EQ(M0, M1);
+    EXPECT_EQ(1, cache.hits);
+    EXPECT_EQ(1, cache.misses);
+    EXPECT_EQ(1., M1->coeff(0,0));
+
+    // Different key is a different entry
+    lookup("CvA");
+    EXPECT_EQ(2, ncomputed);
+    EXPECT_EQ(2, cache.misses);
+}
+
+TEST_F(UrCacheTest, dims_appended)
+{
+    lookup();
+    dimA.add_dense(77);
+    EigenSparseMatrixT const &M(lookup());
+    EXPECT_EQ(2, ncomputed);
+    EXPECT_EQ(4, M.cols());
+
+    // Adding something already there changes nothing
+    dimA.add_dense(77);
+    lookup();
+    EXPECT_EQ(2, ncomputed);
+
+    dimB.set_sparse_extent(200);
+    lookup();
+    EXPECT_EQ(3, ncomputed);
+}
+
+TEST_F(UrCacheTest, dims_changed)
+{
+    lookup();
+
+    // Same extents, different content: only caught if announced
+    dimB.clear();
+    dimB.set_sparse_extent(100);
+    for (long i : {6, 8}) dimB.add_dense(i);
+    cache.dims_changed();
+    lookup();
+    EXPECT_EQ(2, ncomputed);
+    lookup();
+    EXPECT_EQ(2, ncomputed);
+
+    cache.clear();
+    lookup();
+    EXPECT_EQ(3, ncomputed);
+    EXPECT_EQ(0, cache.hits);
+    EXPECT_EQ(1, cache.misses);
+}
+// ------------------------------------------------------------
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}